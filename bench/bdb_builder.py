@@ -0,0 +1,50 @@
+#!/usr/bin/env python
+# encoding: utf-8
+'''Compare building a B+ tree database with BDBBuilder against storing the
+same records one at a time with BDB.put in random order.
+
+  python bench/bdb_builder.py [records [value_size]]
+
+Prints the time taken and the resulting file size of both ways.
+'''
+import os, sys, time, random
+import tc
+
+DBNAME = 'bench.bdb'
+
+def records(n, value_size):
+  value = 'x' * value_size
+  keys = ['key%010d' % i for i in range(n)]
+  random.Random(0).shuffle(keys)
+  return [(key, value) for key in keys]
+
+def put(items):
+  db = tc.BDB()
+  db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT | tc.BDBOTRUNC)
+  for key, value in items:
+    db.put(key, value)
+  db.close()
+
+def build(items):
+  with tc.BDBBuilder(DBNAME) as builder:
+    builder.addmany(items)
+
+def measure(name, func, items):
+  start = time.time()
+  func(items)
+  elapsed = time.time() - start
+  sys.stdout.write('%-8s records=%d seconds=%.2f records/s=%.0f fsiz=%d\n' %
+                   (name, len(items), elapsed, len(items) / elapsed,
+                    os.path.getsize(DBNAME)))
+  sys.stdout.flush()
+  os.remove(DBNAME)
+
+def main(argv):
+  n = len(argv) > 1 and int(argv[1]) or 1000000
+  value_size = len(argv) > 2 and int(argv[2]) or 100
+  items = records(n, value_size)
+  measure('put', put, items)
+  measure('builder', build, items)
+
+if __name__ == '__main__':
+  main(sys.argv)
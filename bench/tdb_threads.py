@@ -0,0 +1,68 @@
+#!/usr/bin/env python
+# encoding: utf-8
+'''Measure TDB read throughput with an increasing number of threads sharing
+one handle.
+
+  python bench/tdb_threads.py [records [seconds [max_threads]]]
+
+With the GIL released around tctdbget, ops/s should grow with the number of
+threads until the cores (or the disk) are saturated.
+'''
+import os, sys, time, random, threading
+import tc
+
+DBNAME = 'bench.tdb'
+
+def populate(db, records):
+  for i in range(records):
+    db.put('user%08d' % i, {'name': 'User %d' % i, 'age': str(i % 90),
+                            'city': 'City %d' % (i % 1000)})
+
+def reader(db, records, deadline, counts, idx):
+  rnd = random.Random(idx)
+  n = 0
+  while time.time() < deadline:
+    for i in range(100):
+      db.get('user%08d' % rnd.randrange(records))
+    n += 100
+  counts[idx] = n
+
+def run(db, records, seconds, nthreads):
+  counts = [0] * nthreads
+  deadline = time.time() + seconds
+  threads = [threading.Thread(target=reader,
+                              args=(db, records, deadline, counts, i))
+             for i in range(nthreads)]
+  start = time.time()
+  for t in threads:
+    t.start()
+  for t in threads:
+    t.join()
+  return sum(counts) / (time.time() - start)
+
+def main(argv):
+  records = len(argv) > 1 and int(argv[1]) or 100000
+  seconds = len(argv) > 2 and float(argv[2]) or 3.0
+  max_threads = len(argv) > 3 and int(argv[3]) or 8
+  if os.path.exists(DBNAME):
+    os.remove(DBNAME)
+  db = tc.TDB()
+  db.setmutex()
+  db.open(DBNAME, tc.TDBOWRITER | tc.TDBOCREAT)
+  try:
+    populate(db, records)
+    nthreads = 1
+    base = None
+    while nthreads <= max_threads:
+      ops = run(db, records, seconds, nthreads)
+      base = base or ops
+      sys.stdout.write('threads=%-3d ops/s=%-12.0f speedup=%.2fx\n' %
+                       (nthreads, ops, ops / base))
+      sys.stdout.flush()
+      nthreads *= 2
+  finally:
+    db.close()
+    os.remove(DBNAME)
+
+if __name__ == '__main__':
+  main(sys.argv)
@@ -3,3 +3,8 @@
 '''
 from tc.release import __version__
 from _tc import *
+try:
+  from tc.builder import BDBBuilder
+except SyntaxError:
+  # the builder needs Python 2.5 or later
+  pass
@@ -0,0 +1,589 @@
+# encoding: utf-8
+'''YCSB-style workload benchmarks.
+
+A database is loaded with records and then runs a mix of operations from
+several threads, and optionally several processes, for a number of
+operations or seconds. The result is printed as JSON::
+
+  python -m tc.bench --db bdb --workload a --threads 4 --records 100000
+
+Workloads follow the core workloads of the Yahoo! Cloud Serving Benchmark:
+
+  a  50% reads, 50% updates
+  b  95% reads, 5% updates
+  c  reads only
+  d  95% reads of recently inserted records, 5% inserts
+  e  95% short scans, 5% inserts
+  f  50% reads, 50% read-modify-writes
+
+Each process works on a database file of its own, since Tokyo Cabinet does
+not let several processes write one file. Threads of a process share one
+handle.
+'''
+import os, sys, time, random, threading, itertools, optparse
+try:
+  import json
+except ImportError:
+  json = None
+from _tc import HDB, BDB, TDB, Error, \
+                HDBOWRITER, HDBOCREAT, HDBOTRUNC, \
+                BDBOWRITER, BDBOCREAT, BDBOTRUNC, \
+                TDBOWRITER, TDBOCREAT, TDBOTRUNC
+
+_clock = getattr(time, 'perf_counter', time.time)
+
+WORKLOADS = {
+  'a': {'read': 0.5, 'update': 0.5},
+  'b': {'read': 0.95, 'update': 0.05},
+  'c': {'read': 1.0},
+  'd': {'read': 0.95, 'insert': 0.05},
+  'e': {'scan': 0.95, 'insert': 0.05},
+  'f': {'read': 0.5, 'rmw': 0.5},
+}
+
+# as in YCSB, workload d reads the latest records and others are zipfian
+DISTRIBUTIONS = {'d': 'latest'}
+
+# -----------------------------------------------------------------------------
+# Keys
+
+_FNV_OFFSET = 0xcbf29ce484222325
+_FNV_PRIME = 0x100000001b3
+_MASK = (1 << 64) - 1
+
+def _fnv(n):
+  '''FNV-1a hash of the 8 bytes of n, spreading neighbouring numbers.'''
+  h = _FNV_OFFSET
+  for i in range(8):
+    h = ((h ^ (n & 0xff)) * _FNV_PRIME) & _MASK
+    n >>= 8
+  return h
+
+def key(n):
+  '''Key of the n-th record. Keys are hashed, as in YCSB, so that records
+  are not inserted in key order.'''
+  return 'user%020d' % _fnv(n)
+
+
+class Uniform(object):
+  '''Every record is equally likely.'''
+  def __init__(self, records, counter):
+    self.counter = counter
+
+  def next(self, rnd):
+    return rnd.randrange(self.counter.value)
+
+
+class Zipfian(object):
+  '''A few records are much more popular than the rest, popular records
+  being scattered over the key space. Uses the method of Gray et al.,
+  "Quickly Generating Billion-Record Synthetic Databases", as YCSB does.'''
+  def __init__(self, records, counter, theta=0.99):
+    self.counter = counter
+    self.items = records
+    self.theta = theta
+    self.zetan = sum(1.0 / (i + 1) ** theta for i in range(records))
+    zeta2 = 1.0 + 0.5 ** theta
+    self.alpha = 1.0 / (1.0 - theta)
+    self.half = 1.0 + 0.5 ** theta
+    self.eta = (1.0 - (2.0 / records) ** (1.0 - theta)) / \
+               (1.0 - zeta2 / self.zetan)
+
+  def rank(self, rnd):
+    u = rnd.random()
+    uz = u * self.zetan
+    if uz < 1.0:
+      return 0
+    if uz < self.half:
+      return 1
+    return int(self.items * (self.eta * u - self.eta + 1.0) ** self.alpha)
+
+  def next(self, rnd):
+    return _fnv(self.rank(rnd)) % self.counter.value
+
+
+class Latest(Zipfian):
+  '''Recently inserted records are the most popular.'''
+  def next(self, rnd):
+    last = self.counter.value - 1
+    return max(last - self.rank(rnd), 0)
+
+
+GENERATORS = {'uniform': Uniform, 'zipfian': Zipfian, 'latest': Latest}
+
+
+class Counter(object):
+  '''Number of records, shared by the threads of a process. next() hands
+  out the number of a record to insert. value only grows past a number once
+  the insert of it and of every number before it has been acknowledged, so
+  reads never pick a record that is still being inserted, as with the
+  acknowledged counter of YCSB.'''
+  def __init__(self, value):
+    self._count = itertools.count(value)
+    self._lock = threading.Lock()
+    self._acked = set()
+    self.value = value
+
+  def next(self):
+    return next(self._count)
+
+  def acknowledge(self, n):
+    self._lock.acquire()
+    try:
+      self._acked.add(n)
+      value = self.value
+      while value in self._acked:
+        self._acked.remove(value)
+        value += 1
+      self.value = value
+    finally:
+      self._lock.release()
+
+# -----------------------------------------------------------------------------
+# Latencies
+
+SUBBITS = 3
+
+def _bucket(ns):
+  '''Log-linear bucket of a latency, as in Stats.c: 8 buckets per power of
+  two, so a bucket is at most 12.5% wide.'''
+  if ns < (1 << SUBBITS):
+    return ns
+  exp = ns.bit_length() - 1
+  return ((exp - SUBBITS + 1) << SUBBITS) + \
+         ((ns >> (exp - SUBBITS)) & ((1 << SUBBITS) - 1))
+
+def _bucket_upper(i):
+  group = i >> SUBBITS
+  if group == 0:
+    return i + 1
+  shift = group - 1
+  return (((1 << SUBBITS) + (i & ((1 << SUBBITS) - 1))) << shift) + (1 << shift)
+
+
+class Histogram(object):
+  def __init__(self):
+    self.count = 0
+    self.errors = 0
+    self.total = 0
+    self.max = 0
+    self.buckets = {}
+
+  def record(self, seconds):
+    ns = int(seconds * 1e9)
+    i = _bucket(ns)
+    self.buckets[i] = self.buckets.get(i, 0) + 1
+    self.count += 1
+    self.total += ns
+    if ns > self.max:
+      self.max = ns
+
+  def merge(self, other):
+    self.count += other.count
+    self.errors += other.errors
+    self.total += other.total
+    self.max = max(self.max, other.max)
+    for i, n in other.buckets.items():
+      self.buckets[i] = self.buckets.get(i, 0) + n
+
+  def quantile(self, q):
+    '''Upper bound in seconds of the bucket holding quantile q.'''
+    rank = max(int(q * self.count + 0.5), 1)
+    seen = 0
+    for i in sorted(self.buckets):
+      seen += self.buckets[i]
+      if seen >= rank:
+        return _bucket_upper(i) / 1e9
+    return 0.0
+
+  def summary(self, seconds):
+    return {
+      'count': self.count,
+      'errors': self.errors,
+      'ops_per_sec': seconds and self.count / seconds or 0.0,
+      'mean': self.count and self.total / 1e9 / self.count or 0.0,
+      'p50': self.quantile(0.5),
+      'p99': self.quantile(0.99),
+      'p999': self.quantile(0.999),
+      'max': self.max / 1e9,
+    }
+
+# -----------------------------------------------------------------------------
+# Databases
+
+class Store(object):
+  '''Operations of a workload on one kind of database.'''
+  omode = 0
+  tuning = ()
+
+  def __init__(self, path, options):
+    self.value = 'x' * options.value_size
+    self.db = self.cls()
+    if options.threads > 1:
+      self.db.setmutex()
+    self.tune(dict(options.tuning))
+    self.db.open(path, self.omode)
+
+  def tune(self, params):
+    unknown = set(params) - set(self.tuning)
+    if unknown:
+      raise ValueError('unknown tuning parameters for %s: %s' %
+                       (self.name, ', '.join(sorted(unknown))))
+    self.db.tune(*[params.get(name, default)
+                   for name, default in self.tune_defaults])
+    if 'xmsiz' in params:
+      self.db.setxmsiz(params['xmsiz'])
+    if 'dfunit' in params:
+      self.db.setdfunit(params['dfunit'])
+
+  def load(self, keys):
+    self.db.putmany((k, self.value) for k in keys)
+
+  def read(self, k):
+    return self.db.get(k)
+
+  def update(self, k):
+    self.db.put(k, self.value)
+
+  insert = update
+
+  def rmw(self, k):
+    self.db.get(k)
+    self.db.put(k, self.value)
+
+  def scan(self, n, count):
+    '''Read count records from the n-th. Records of hash and table
+    databases have no order, so the records following in insert order are
+    read.'''
+    self.db.getmany([key(i) for i in range(n, n + count)])
+
+  def close(self):
+    self.db.close()
+
+
+class HDBStore(Store):
+  name = 'hdb'
+  cls = HDB
+  omode = HDBOWRITER | HDBOCREAT | HDBOTRUNC
+  tune_defaults = (('bnum', 0), ('apow', -1), ('fpow', -1), ('opts', 0))
+  tuning = ('bnum', 'apow', 'fpow', 'opts', 'rcnum', 'xmsiz', 'dfunit')
+
+  def tune(self, params):
+    if 'rcnum' in params:
+      self.db.setcache(params.pop('rcnum'))
+    Store.tune(self, params)
+
+
+class BDBStore(Store):
+  name = 'bdb'
+  cls = BDB
+  omode = BDBOWRITER | BDBOCREAT | BDBOTRUNC
+  tune_defaults = (('lmemb', 0), ('nmemb', 0), ('bnum', 0), ('apow', -1),
+                   ('fpow', -1), ('opts', 0))
+  tuning = ('lmemb', 'nmemb', 'bnum', 'apow', 'fpow', 'opts', 'lcnum', 'ncnum',
+            'xmsiz', 'dfunit')
+
+  def tune(self, params):
+    if 'lcnum' in params or 'ncnum' in params:
+      self.db.setcache(params.pop('lcnum', 0), params.pop('ncnum', 0))
+    Store.tune(self, params)
+
+  def scan(self, n, count):
+    cur = self.db.curnew(prefetch=count)
+    try:
+      cur.jump(key(n))
+    except KeyError:
+      return
+    for k in itertools.islice(cur, count):
+      pass
+
+
+class TDBStore(Store):
+  '''Records are made of fields columns of value_size bytes.'''
+  name = 'tdb'
+  cls = TDB
+  omode = TDBOWRITER | TDBOCREAT | TDBOTRUNC
+  tune_defaults = (('bnum', 0), ('apow', -1), ('fpow', -1), ('opts', 0))
+  tuning = ('bnum', 'apow', 'fpow', 'opts', 'rcnum', 'lcnum', 'ncnum',
+            'xmsiz', 'dfunit')
+
+  def __init__(self, path, options):
+    Store.__init__(self, path, options)
+    self.value = dict(('field%d' % i, self.value)
+                      for i in range(options.fields))
+
+  def tune(self, params):
+    if 'rcnum' in params or 'lcnum' in params or 'ncnum' in params:
+      self.db.setcache(params.pop('rcnum', 0), params.pop('lcnum', 0),
+                       params.pop('ncnum', 0))
+    Store.tune(self, params)
+
+  def load(self, keys):
+    put = self.db.put
+    for k in keys:
+      put(k, self.value)
+
+  def scan(self, n, count):
+    get = self.db.get
+    for i in range(n, n + count):
+      try:
+        get(key(i))
+      except KeyError:
+        pass
+
+
+STORES = {'hdb': HDBStore, 'bdb': BDBStore, 'tdb': TDBStore}
+
+# -----------------------------------------------------------------------------
+# Running
+
+def _worker(store, options, counter, generator, ops, deadline, seed, results):
+  try:
+    results.append(_work(store, options, counter, generator, ops, deadline,
+                         seed))
+  except Exception:
+    results.append(sys.exc_info()[1])
+
+
+def _work(store, options, counter, generator, ops, deadline, seed):
+  rnd = random.Random(seed)
+  mix = sorted(WORKLOADS[options.workload].items())
+  hists = dict((name, Histogram()) for name, share in mix)
+  done = 0
+  while (ops is None or done < ops) and \
+        (deadline is None or done % 64 or _clock() < deadline):
+    x = rnd.random()
+    for name, share in mix:
+      x -= share
+      if x < 0:
+        break
+    if name == 'insert':
+      n = counter.next()
+      args = (key(n),)
+    elif name == 'scan':
+      args = (generator.next(rnd), rnd.randint(1, options.scan_length))
+    else:
+      args = (key(generator.next(rnd)),)
+    start = _clock()
+    try:
+      getattr(store, name)(*args)
+    except (Error, KeyError):
+      hists[name].errors += 1
+    hists[name].record(_clock() - start)
+    if name == 'insert':
+      # a failed insert is acknowledged too, or value would stop growing
+      counter.acknowledge(n)
+    done += 1
+  return hists
+
+
+def _split(total, parts):
+  return [total // parts + (i < total % parts) for i in range(parts)]
+
+
+def run_process(options, index, ready=None, start=None):
+  '''Load and run the workload in this process, on its own database when
+  there are several processes. Returns a dict of histograms by operation,
+  the load and run times, and the operation stats of the database.'''
+  path = options.path
+  if options.processes > 1:
+    path = '%s.%d' % (path, index)
+  store = STORES[options.db](path, options)
+  try:
+    begin = _clock()
+    store.load(key(i) for i in range(options.records))
+    load_seconds = _clock() - begin
+    store.db.stats(reset=True)
+    counter = Counter(options.records)
+    generator = GENERATORS[options.distribution](options.records, counter)
+    if ready is not None:
+      ready.put(index)
+      start.wait()
+    if options.operations:
+      ops = _split(_split(options.operations, options.processes)[index],
+                   options.threads)
+    else:
+      ops = [None] * options.threads
+    deadline = options.seconds and _clock() + options.seconds or None
+    results = []
+    threads = [threading.Thread(target=_worker,
+                                args=(store, options, counter, generator,
+                                      ops[i], deadline,
+                                      options.seed + index * 1000 + i,
+                                      results))
+               for i in range(options.threads)]
+    begin = _clock()
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    run_seconds = _clock() - begin
+    hists = {}
+    for result in results:
+      if isinstance(result, Exception):
+        raise result
+      for name, hist in result.items():
+        hists.setdefault(name, Histogram()).merge(hist)
+    return {'load_seconds': load_seconds, 'run_seconds': run_seconds,
+            'hists': hists, 'stats': store.db.stats()}
+  finally:
+    store.close()
+    if not options.keep and os.path.exists(path):
+      os.remove(path)
+
+
+def _child(options, index, ready, start, queue):
+  try:
+    queue.put((index, run_process(options, index, ready, start)))
+  except Exception:
+    # exceptions of _tc don't pickle
+    queue.put((index, RuntimeError('process %d: %s' % (index, sys.exc_info()[1]))))
+    ready.put(index)
+
+
+def _merge_stats(stats, other):
+  for op, values in other.items():
+    merged = stats.setdefault(op, {})
+    for name in ('calls', 'errors', 'bytes_in', 'bytes_out', 'tc_seconds',
+                 'gil_seconds'):
+      merged[name] = merged.get(name, 0) + values[name]
+
+
+def run(options):
+  '''Run a benchmark and return its report as a dict.'''
+  if options.processes > 1:
+    import multiprocessing
+    ready = multiprocessing.Queue()
+    queue = multiprocessing.Queue()
+    start = multiprocessing.Event()
+    procs = [multiprocessing.Process(target=_child,
+                                     args=(options, i, ready, start, queue))
+             for i in range(options.processes)]
+    for p in procs:
+      p.start()
+    # processes start running once all of them have loaded their database
+    for p in procs:
+      ready.get()
+    start.set()
+    results = [queue.get() for p in procs]
+    for p in procs:
+      p.join()
+    for index, result in results:
+      if isinstance(result, Exception):
+        raise result
+    results = [result for index, result in sorted(results)]
+  else:
+    results = [run_process(options, 0)]
+
+  hists, stats = {}, {}
+  total = Histogram()
+  for result in results:
+    for name, hist in result['hists'].items():
+      hists.setdefault(name, Histogram()).merge(hist)
+      total.merge(hist)
+    _merge_stats(stats, result['stats'])
+  load_seconds = max(r['load_seconds'] for r in results)
+  run_seconds = max(r['run_seconds'] for r in results)
+  records = options.records * options.processes
+  return {
+    'db': options.db,
+    'workload': options.workload,
+    'distribution': options.distribution,
+    'threads': options.threads,
+    'processes': options.processes,
+    'records': records,
+    'value_size': options.value_size,
+    'tuning': dict(options.tuning),
+    'load': {
+      'seconds': load_seconds,
+      'ops_per_sec': load_seconds and records / load_seconds or 0.0,
+    },
+    'run': dict(total.summary(run_seconds), seconds=run_seconds),
+    'operations': dict((name, hist.summary(run_seconds))
+                       for name, hist in hists.items()),
+    'tc': stats,
+  }
+
+# -----------------------------------------------------------------------------
+# Command line
+
+def _tuning(option, opt, value, parser):
+  try:
+    name, value = value.split('=', 1)
+    value = int(value)
+  except ValueError:
+    raise optparse.OptionValueError('%s takes name=integer' % opt)
+  parser.values.tuning.append((name, value))
+
+
+def parser():
+  p = optparse.OptionParser(usage='%prog [options]',
+                            description='Run a YCSB-style workload against '
+                                        'a Tokyo Cabinet database and print '
+                                        'the results as JSON.')
+  p.add_option('--db', choices=sorted(STORES), default='hdb',
+               help='database type: hdb, bdb or tdb [%default]')
+  p.add_option('-w', '--workload', choices=sorted(WORKLOADS), default='a',
+               help='YCSB workload a to f [%default]')
+  p.add_option('-d', '--distribution', choices=sorted(GENERATORS),
+               help='key distribution: uniform, zipfian or latest '
+                    '[latest for workload d, zipfian otherwise]')
+  p.add_option('-t', '--threads', type='int', default=1,
+               help='threads per process [%default]')
+  p.add_option('-p', '--processes', type='int', default=1,
+               help='processes, each with a database of its own [%default]')
+  p.add_option('-r', '--records', type='int', default=100000,
+               help='records loaded per process [%default]')
+  p.add_option('-n', '--operations', type='int', default=None,
+               help='operations in total [100000 unless --seconds]')
+  p.add_option('-s', '--seconds', type='float', default=None,
+               help='run for this long instead of a number of operations')
+  p.add_option('--value-size', type='int', default=100,
+               help='bytes per value, or per field of tdb [%default]')
+  p.add_option('--fields', type='int', default=10,
+               help='fields per tdb record [%default]')
+  p.add_option('--scan-length', type='int', default=100,
+               help='maximum records per scan [%default]')
+  p.add_option('--tune', action='callback', callback=_tuning, type='string',
+               metavar='NAME=VALUE',
+               help='tuning parameter, e.g. bnum=1000000, lcnum=4096 or '
+                    'xmsiz=268435456; may be repeated')
+  p.add_option('--path', default=None,
+               help='database file [bench.<db> in the current directory]')
+  p.add_option('--keep', action='store_true', default=False,
+               help='keep the database files')
+  p.add_option('--seed', type='int', default=0,
+               help='random seed [%default]')
+  p.add_option('-o', '--output', default=None,
+               help='write the JSON report to a file instead of stdout')
+  p.set_defaults(tuning=[])
+  return p
+
+
+def main(argv=None):
+  options, args = parser().parse_args(argv)
+  if args:
+    parser().error('unexpected arguments: %s' % ' '.join(args))
+  if options.distribution is None:
+    options.distribution = DISTRIBUTIONS.get(options.workload, 'zipfian')
+  if options.operations is None and options.seconds is None:
+    options.operations = 100000
+  if options.path is None:
+    options.path = 'bench.' + options.db
+  if json is None:
+    raise SystemExit('the json module is required')
+  report = run(options)
+  text = json.dumps(report, indent=2, sort_keys=True)
+  if options.output:
+    f = open(options.output, 'w')
+    try:
+      f.write(text + '\n')
+    finally:
+      f.close()
+  else:
+    sys.stdout.write(text + '\n')
+  return report
+
+
+if __name__ == '__main__':
+  main()
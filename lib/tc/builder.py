@@ -0,0 +1,198 @@
+# encoding: utf-8
+'''Bulk loading of B+ tree databases.
+'''
+import os, struct, tempfile, heapq
+from _tc import BDB, BDBOWRITER, BDBOCREAT, BDBOTRUNC
+
+_HEADER = struct.Struct('>II')
+
+try:
+  _merge_runs = heapq.merge
+except AttributeError:
+  def _merge_runs(*iterables):
+    '''heapq.merge, which is new in Python 2.6.'''
+    heap = []
+    for it in map(iter, iterables):
+      for record in it:
+        heap.append((record, it))
+        break
+    heapq.heapify(heap)
+    while heap:
+      record, it = heap[0]
+      yield record
+      for record in it:
+        heapq.heapreplace(heap, (record, it))
+        break
+      else:
+        heapq.heappop(heap)
+
+def _write_run(records, tmpdir):
+  '''Write sorted records to a temporary file and return its name.'''
+  fd, name = tempfile.mkstemp(prefix='tcbuild', dir=tmpdir)
+  f = os.fdopen(fd, 'wb')
+  try:
+    for key, value in records:
+      f.write(_HEADER.pack(len(key), len(value)))
+      f.write(key)
+      f.write(value)
+  finally:
+    f.close()
+  return name
+
+def _read_run(name, order):
+  '''Yield the records of a run as (key, order, value), order breaking ties
+  between runs so that the last value stored for a key wins.'''
+  f = open(name, 'rb')
+  try:
+    while True:
+      header = f.read(_HEADER.size)
+      if not header:
+        break
+      ksiz, vsiz = _HEADER.unpack(header)
+      yield f.read(ksiz), order, f.read(vsiz)
+  finally:
+    f.close()
+
+
+class BDBBuilder(object):
+  '''Build a new B+ tree database from a stream of records.
+
+  Records are added with add() or addmany() and written to the database in
+  key order by finish(), in transactions of batch records. Unless presorted
+  is true, records are sorted in runs of about runsize bytes, which are
+  spilled to temporary files in tmpdir and merged at the end, so the input
+  may be larger than memory. With presorted, records are written as they
+  come and must be added in ascending key order.
+
+  Sorting follows the default lexical order of B+ tree databases. Databases
+  with another comparison function must be fed presorted records.
+
+  lmemb, nmemb, bnum, apow, fpow and opts are passed to BDB.tune() and are
+  stored in the database. The defaults give larger leaves than Tokyo
+  Cabinet, which suits loading in order. lcnum and ncnum set the page
+  caches during the load only.
+
+  Can be used as a context manager, which calls finish() at the end of the
+  block unless the block raised an exception.
+  '''
+  def __init__(self, path, presorted=False, lmemb=256, nmemb=512, bnum=0,
+               apow=-1, fpow=-1, opts=0, lcnum=4096, ncnum=1024,
+               batch=100000, runsize=64 << 20, tmpdir=None):
+    self.presorted = presorted
+    self.batch = batch
+    self.runsize = runsize
+    self.tmpdir = tmpdir
+    self.count = 0
+    self._records = []
+    self._size = 0
+    self._runs = []
+    self._last = None
+    self.db = BDB()
+    self.db.tune(lmemb, nmemb, bnum, apow, fpow, opts)
+    self.db.setcache(lcnum, ncnum)
+    self.db.open(path, BDBOWRITER | BDBOCREAT | BDBOTRUNC)
+
+  def add(self, key, value):
+    '''Add a record.'''
+    if self.presorted:
+      if self._last is not None and key < self._last:
+        raise ValueError('keys must be added in ascending order')
+      self._last = key
+      self._records.append((key, value))
+      if len(self._records) >= self.batch:
+        self._write(self._records)
+        self._records = []
+    else:
+      self._records.append((key, value))
+      self._size += len(key) + len(value)
+      if self._size >= self.runsize:
+        self._spill()
+    self.count += 1
+
+  def addmany(self, items):
+    '''Add records from a mapping or from (key, value) pairs.'''
+    if hasattr(items, 'iteritems'):
+      items = items.iteritems()
+    elif hasattr(items, 'items'):
+      items = items.items()
+    add = self.add
+    for key, value in items:
+      add(key, value)
+
+  def finish(self):
+    '''Write all records, close the database and remove temporary files.
+    Returns the number of records added.'''
+    try:
+      if self.presorted:
+        self._write(self._records)
+      else:
+        self._records.sort(key=lambda record: record[0])
+        if self._runs:
+          self._spill()
+          self._merge()
+        else:
+          self._write(self._records)
+      self._records = []
+      self.db.close()
+    finally:
+      self._cleanup()
+    return self.count
+
+  def abort(self):
+    '''Close the database, left partially built, and remove temporary
+    files.'''
+    try:
+      self.db.close()
+    finally:
+      self._cleanup()
+
+  def __enter__(self):
+    return self
+
+  def __exit__(self, type, value, traceback):
+    if type is None:
+      self.finish()
+    else:
+      self.abort()
+    return False
+
+  def _write(self, records):
+    if records:
+      self.db.tranbegin()
+      try:
+        self.db.putmany(records, transaction=False)
+      except:
+        self.db.tranabort()
+        raise
+      self.db.trancommit()
+
+  def _spill(self):
+    # a stable sort keeps the last value added for a key last
+    self._records.sort(key=lambda record: record[0])
+    self._runs.append(_write_run(self._records, self.tmpdir))
+    self._records = []
+    self._size = 0
+
+  def _merge(self):
+    records = []
+    pending = None
+    runs = [_read_run(name, i) for i, name in enumerate(self._runs)]
+    for key, order, value in _merge_runs(*runs):
+      # of several records with one key, only the last one is kept
+      if pending is not None and key != pending[0]:
+        records.append(pending)
+        if len(records) >= self.batch:
+          self._write(records)
+          records = []
+      pending = (key, value)
+    if pending is not None:
+      records.append(pending)
+    self._write(records)
+
+  def _cleanup(self):
+    for name in self._runs:
+      try:
+        os.remove(name)
+      except OSError:
+        pass
+    self._runs = []
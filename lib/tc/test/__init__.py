@@ -3,10 +3,19 @@ import unittest, sys, os
 
 def suite():
   suites = []
-  import tc.test.hdb, tc.test.bdb, tc.test.tdb
+  import tc.test.hdb, tc.test.bdb, tc.test.tdb, tc.test.fdb, tc.test.adb, \
+    tc.test.memcache, tc.test.writeback, tc.test.builder, \
+    tc.test.defrag, tc.test.bench
   suites.append(tc.test.hdb.suite())
   suites.append(tc.test.bdb.suite())
   suites.append(tc.test.tdb.suite())
+  suites.append(tc.test.fdb.suite())
+  suites.append(tc.test.adb.suite())
+  suites.append(tc.test.memcache.suite())
+  suites.append(tc.test.writeback.suite())
+  suites.append(tc.test.builder.suite())
+  suites.append(tc.test.defrag.suite())
+  suites.append(tc.test.bench.suite())
   return unittest.TestSuite(suites)
 
 def test(*va, **kw):
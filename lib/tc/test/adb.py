@@ -0,0 +1,108 @@
+# encoding: utf-8
+import os, sys
+import unittest
+import tc
+
+DBNAME = 'test.tch'
+
+class TestADB(unittest.TestCase):
+  def setUp(self):
+    if os.path.exists(DBNAME):
+      os.remove(DBNAME)
+  
+  def tearDown(self):
+    if os.path.exists(DBNAME):
+      os.remove(DBNAME)
+  
+  def _testBackend(self, name):
+    db = tc.ADB(name)
+    
+    # put
+    db.put('hamu', 'ju')
+    db.put('moru', 'pui')
+    db['kiki'] = 'nya-'
+    db.putcat('hamu', '-ju')
+    self.assertRaises(tc.Error, db.putkeep, 'hamu', 'x')
+    
+    # get
+    self.assertEqual(db.get('hamu'), 'ju-ju')
+    self.assertEqual(db['kiki'], 'nya-')
+    self.assertRaises(KeyError, db.get, 'nanana')
+    self.assertEqual(db.getmany(['moru', 'nanana']), ['pui', None])
+    self.assertEqual(db.vsiz('moru'), 3)
+    self.assertTrue('moru' in db)
+    self.assertFalse('nanana' in db)
+    self.assertEqual(len(db), 3)
+    self.assertEqual(db.rnum(), 3)
+    
+    # iteration
+    self.assertEqual(sorted(db.keys()), ['hamu', 'kiki', 'moru'])
+    self.assertEqual(sorted(db), ['hamu', 'kiki', 'moru'])
+    self.assertEqual(sorted(db.values()), ['ju-ju', 'nya-', 'pui'])
+    self.assertEqual(sorted(db.iteritems()),
+                     [('hamu', 'ju-ju'), ('kiki', 'nya-'), ('moru', 'pui')])
+    db.iterinit()
+    self.assertTrue(db.iternext() in ('hamu', 'kiki', 'moru'))
+    self.assertEqual(sorted(db.fwmkeys('h')), ['hamu'])
+    
+    # out
+    db.out('moru')
+    del db['kiki']
+    self.assertRaises(KeyError, db.out, 'moru')
+    self.assertEqual(db.keys(), ['hamu'])
+    
+    # addint
+    self.assertEqual(db.addint('int', 3), 3)
+    self.assertEqual(db.addint('int', 2), 5)
+    
+    db.sync()
+    db.vanish()
+    self.assertEqual(len(db), 0)
+    db.close()
+  
+  def testMemory(self):
+    self._testBackend('*')
+  
+  def testTree(self):
+    self._testBackend('+')
+    db = tc.ADB('+')
+    for key in ['b', 'c', 'a']:
+      db[key] = key
+    self.assertEqual(db.keys(), ['a', 'b', 'c'])
+  
+  def testFile(self):
+    self._testBackend(DBNAME + '#bnum=1000')
+    db = tc.ADB()
+    db.open(DBNAME)
+    self.assertEqual(db.path(), DBNAME)
+    # transactions
+    db.tranbegin()
+    db['tmp'] = 'x'
+    db.tranabort()
+    self.assertFalse('tmp' in db)
+    db.close()
+    self.assertRaises(tc.Error, db.put, 'a', 'b')
+  
+  def testCapacity(self):
+    db = tc.ADB('*#capnum=100')
+    for i in range(1000):
+      db[str(i)] = str(i)
+    self.assertTrue(len(db) < 1000)
+    self.assertFalse('0' in db)
+    self.assertEqual(db['999'], '999')
+  
+  def testMisc(self):
+    db = tc.ADB('*')
+    self.assertEqual(db.misc('putlist', ['a', '1', 'b', '2']), [])
+    self.assertEqual(db.misc('getlist', ['a', 'b']), ['a', '1', 'b', '2'])
+    self.assertRaises(tc.Error, db.misc, 'nonexistent')
+    self.assertRaises(TypeError, db.misc, 'putlist', [1, 2])
+
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestADB)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
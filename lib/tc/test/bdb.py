@@ -1,4 +1,5 @@
 # encoding: utf-8
+from __future__ import with_statement
 import os, sys
 import unittest
 import tc
@@ -46,6 +47,8 @@ class TestBDB(unittest.TestCase):
     self.assertEqual(db.get('hamu'), 'ju')
     # vsiz
     self.assertEqual(db.vsiz('hamu'), len('ju'))
+    # getmany
+    self.assertEqual(db.getmany(['moru', 'absence', 'hamu'], ''), ['pui', '', 'ju'])
     
     # putkeep
     self.assertRaises(
@@ -71,6 +74,19 @@ class TestBDB(unittest.TestCase):
       KeyError,
       db.get, 'gunya')
     
+    # putmany
+    self.assertEqual(db.putmany({'gunya': 'gorori', 'moru': 'pui'}, 'keep'), 1)
+    db.out('gunya')
+    
+    # buffers
+    db.put('gunya', bytearray('gorori'))
+    buf = bytearray(8)
+    self.assertEqual(db.get_into('gunya', buf), 6)
+    self.assertEqual(buf[:6], 'gorori')
+    self.assertRaises(ValueError, db.get_into, 'gunya', bytearray(2))
+    self.assertRaises(KeyError, db.get_into, 'absence', buf)
+    db.out('gunya')
+    
     # putlist
     db.putlist('gunya', ['gorori', 'harahetta', 'nikutabetai'])
     self.assertEqual(db.getlist('gunya'), ['gorori', 'harahetta', 'nikutabetai'])
@@ -216,21 +232,197 @@ class TestBDB(unittest.TestCase):
   
   def testCmpFunc(self):
     db = tc.BDB()
-    # setcmpfunc
-    db.setcmpfunc(lambda x,y:len(x) == len(y), 1)
+    # setcmpfunc: order by length, then lexically
+    db.setcmpfunc(lambda x, y, op: cmp((len(x), x), (len(y), y)) * op, 1)
     db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
     
     db['kiki'] = 'nya-'
     db['moru'] = 'pui'
-    self.assertEqual(db.get('kiki'), 'pui')
+    db['hamu-hamu'] = 'ju'
+    db['a'] = 'b'
+    self.assertEqual(db.get('kiki'), 'nya-')
+    self.assertEqual(db.keys(), ['a', 'kiki', 'moru', 'hamu-hamu'])
+    self.assertRaises(TypeError, db.setcmpfunc, 1)
+    db.close()
+    os.remove(DBNAME)
+    
+    # results beyond the range of an int keep their sign
+    db = tc.BDB()
+    db.setcmpfunc(lambda x, y, op: (int(x) - int(y)) << 32, None)
+    db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    for key in ('3', '1', '2'):
+      db[key] = key
+    self.assertEqual(db.keys(), ['1', '2', '3'])
     
     os.remove(DBNAME)
   
+  def testNativeCmp(self):
+    db = tc.BDB()
+    db.setcmpfunc(tc.cmpint64)
+    db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    for n in [5, -3, 100, 0, 1 << 40]:
+      db[struct.pack('q', n)] = str(n)
+    self.assertEqual([struct.unpack('q', k)[0] for k in db.keys()],
+                     [-3, 0, 5, 100, 1 << 40])
+    db.close()
+    os.remove(DBNAME)
+    
+    db = tc.BDB()
+    db.setcmpfunc(tc.cmpdecimal, reverse=True)
+    db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    db.putmany([('9', ''), ('100', ''), ('10', ''), ('-1', '')])
+    self.assertEqual(db.keys(), ['100', '10', '9', '-1'])
+    db.close()
+    os.remove(DBNAME)
+  
+  def testPrefetch(self):
+    db = tc.BDB(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    items = [('k%04d' % i, 'v%d' % i) for i in range(1000)]
+    db.putmany(items)
+    self.assertEqual(list(db.iteritems()), items)
+    self.assertEqual(list(db.itervalues()), [v for k, v in items])
+    cur = db.curnew(prefetch=64)
+    cur.jump('k0500')
+    self.assertEqual(list(cur), [k for k, v in items[500:]])
+    cur = db.curnew(16)
+    cur.first()
+    it = iter(cur)
+    self.assertEqual(next(it), 'k0000')
+    self.assertEqual(next(it), 'k0001')
+    # the cursor is back at the next record of the iteration
+    self.assertEqual(cur.rec(), ('k0002', 'v2'))
+    self.assertEqual(next(it), 'k0002')
+    cur.jump('k0998')
+    self.assertEqual(list(it), ['k0998', 'k0999'])
+    os.remove(DBNAME)
+
+  def testPrefetchDuplicates(self):
+    db = tc.BDB(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    db.putlist('b', ['1', '2', '3'])
+    db.put('a', '0')
+    db.put('c', '4')
+    cur = db.curnew(16)
+    cur.first()
+    it = iter(cur)
+    self.assertEqual(next(it), 'a')
+    self.assertEqual(next(it), 'b')
+    # the second duplicate, not the first one
+    self.assertEqual(cur.rec(), ('b', '2'))
+    cur.out()
+    self.assertEqual(db.getlist('b'), ['1', '3'])
+    self.assertEqual(list(it), ['b', 'c'])
+    it = db.iteritems()
+    self.assertEqual(next(it), ('a', '0'))
+    self.assertEqual(next(it), ('b', '1'))
+    it.put('x', tc.BDBCPCURRENT)
+    self.assertEqual(db.getlist('b'), ['1', 'x'])
+    self.assertEqual(list(it), [('b', 'x'), ('c', '4')])
+    # having read up to the end, the cursor steps back from the last record
+    cur.jump('b')
+    self.assertEqual(next(cur), 'b')
+    self.assertEqual(cur.rec(), ('b', 'x'))
+    cur.jump('a')
+    self.assertEqual(next(cur), 'a')
+    db.putlist('d', ['5', '6'])
+    self.assertRaises(RuntimeError, cur.key)
+    db.close()
+    os.remove(DBNAME)
+  
   def testEmptyIteritems(self):
     db = tc.BDB()
     db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
     self.assertEqual(list(db.iteritems()), [])
 
+  def testTransaction(self):
+    db = tc.BDB()
+    db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    with db.transaction():
+      db['a'] = '1'
+    self.assertEqual(db['a'], '1')
+    try:
+      with db.transaction():
+        db['b'] = '2'
+        raise ValueError
+    except ValueError:
+      pass
+    self.assertFalse('b' in db)
+    # putmany writes into the transaction in progress instead of waiting
+    # for it to end
+    with db.transaction():
+      self.assertEqual(db.putmany([('c', '3'), ('d', '4')]), 2)
+    self.assertEqual(db.getmany(['c', 'd']), ['3', '4'])
+    try:
+      with db.transaction():
+        db.putmany({'e': '5'})
+        raise ValueError
+    except ValueError:
+      pass
+    self.assertFalse('e' in db)
+    db.tranbegin()
+    db.putmany({'e': '5'})
+    db.trancommit()
+    self.assertEqual(db['e'], '5')
+    # nesting would wait forever for the outer transaction to end
+    with db.transaction():
+      self.assertRaises(RuntimeError, db.tranbegin)
+      self.assertRaises(RuntimeError, db.transaction().__enter__)
+    db.close()
+
+  def testTuning(self):
+    db = tc.BDB()
+    db.tune(64, 128, 100, 4, 10, 0)
+    db.setcache(2048, 1024)
+    db.setxmsiz(1 << 28)
+    db.open(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    tuning = db.tuning()
+    self.assertEqual(tuning['lmemb'], 64)
+    self.assertEqual(tuning['nmemb'], 128)
+    self.assertEqual(tuning['lcnum'], 2048)
+    self.assertEqual(tuning['xmsiz'], 1 << 28)
+    self.assertFalse('rcnum' in tuning)
+    db.close()
+
+  def testStats(self):
+    db = tc.BDB(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    db.putmany([('a', '1'), ('b', '2')])
+    cur = db.curnew()
+    cur.first()
+    cur.next()
+    self.assertRaises(KeyError, cur.next)
+    stats = db.stats()
+    self.assertEqual(stats['putmany']['calls'], 1)
+    self.assertEqual(stats['putmany']['bytes_in'], 4)
+    self.assertEqual(stats['cursor']['calls'], 3)
+    self.assertEqual(stats['cursor']['errors'], 1)
+    db.stats(reset=True)
+    db.putlist('c', ['3', '4'])
+    self.assertEqual(db.getlist('c'), ['3', '4'])
+    db.get_into('a', bytearray(8))
+    db.values()
+    stats = db.stats()
+    self.assertEqual(stats['put']['bytes_in'], 3)
+    self.assertEqual(stats['get']['calls'], 2)
+    self.assertEqual(stats['get']['bytes_out'], 3)
+    self.assertEqual(stats['iter']['calls'], 4)
+    db.close()
+
+  def testCodec(self):
+    db = tc.BDB(DBNAME, tc.BDBOWRITER | tc.BDBOCREAT, codec='tc')
+    db.putlist('a', [1, (2, 3)])
+    db['b'] = {'x': 1.5}
+    self.assertEqual(db.getlist('a'), [1, (2, 3)])
+    self.assertEqual(db.range('a', True, 'b', True, -1), ['a', 'a', 'b'])
+    self.assertEqual(db.values(), [1, (2, 3), {'x': 1.5}])
+    self.assertEqual(db.items()[2], ('b', {'x': 1.5}))
+    cur = db.curnew()
+    cur.jump('b')
+    self.assertEqual(cur.val(), {'x': 1.5})
+    cur.put([None], tc.BDBCPCURRENT)
+    self.assertEqual(cur.rec(), ('b', [None]))
+    self.assertEqual(list(db.itervalues())[2], [None])
+    self.assertRaises(ValueError, db.get_into, 'b', bytearray(16))
+    db.close()
+
 def suite():
   return unittest.TestSuite([
     unittest.makeSuite(TestBDB)
@@ -0,0 +1,78 @@
+# encoding: utf-8
+import os, sys
+import unittest
+import random
+from tc import bench
+
+DBNAME = 'test.bench'
+
+class TestBench(unittest.TestCase):
+  def setUp(self):
+    for name in (DBNAME, DBNAME + '.0', DBNAME + '.1'):
+      if os.path.exists(name):
+        os.remove(name)
+  
+  tearDown = setUp
+  
+  def testHistogram(self):
+    hist = bench.Histogram()
+    for i in range(1, 1001):
+      hist.record(i * 1e-6)
+    self.assertEqual(hist.count, 1000)
+    # buckets are at most 12.5% wide
+    for q in (0.5, 0.99, 0.999):
+      self.assertTrue(q * 1e-3 <= hist.quantile(q) <= q * 1e-3 * 1.126)
+    other = bench.Histogram()
+    other.record(1.0)
+    hist.merge(other)
+    self.assertEqual(hist.count, 1001)
+    self.assertEqual(hist.max, 10 ** 9)
+  
+  def testDistributions(self):
+    rnd = random.Random(0)
+    counter = bench.Counter(1000)
+    for name, cls in bench.GENERATORS.items():
+      gen = cls(1000, counter)
+      values = [gen.next(rnd) for i in range(5000)]
+      self.assertTrue(0 <= min(values) and max(values) < 1000, name)
+    zipf = bench.Zipfian(1000, counter)
+    ranks = [zipf.rank(rnd) for i in range(5000)]
+    self.assertTrue(ranks.count(0) > ranks.count(999) + 100)
+    # value only covers acknowledged inserts, in order
+    self.assertEqual(counter.next(), 1000)
+    self.assertEqual(counter.next(), 1001)
+    self.assertEqual(counter.value, 1000)
+    counter.acknowledge(1001)
+    self.assertEqual(counter.value, 1000)
+    counter.acknowledge(1000)
+    self.assertEqual(counter.value, 1002)
+  
+  def _run(self, *args):
+    args = ['--path', DBNAME, '-r', '200', '-n', '400', '-o', os.devnull] + \
+           list(args)
+    return bench.main(args)
+  
+  def testWorkloads(self):
+    for db in sorted(bench.STORES):
+      for workload in sorted(bench.WORKLOADS):
+        report = self._run('--db', db, '-w', workload, '-t', '2',
+                           '--fields', '2', '--scan-length', '5')
+        self.assertEqual(report['run']['count'], 400)
+        self.assertEqual(report['run']['errors'], 0)
+        self.assertTrue(report['run']['p50'] <= report['run']['p999'])
+        self.assertFalse(os.path.exists(DBNAME))
+  
+  def testProcesses(self):
+    report = self._run('-p', '2', '--tune', 'bnum=1000')
+    self.assertEqual(report['records'], 400)
+    self.assertEqual(report['run']['count'], 400)
+    self.assertEqual(report['tuning'], {'bnum': 1000})
+    self.assertRaises(ValueError, self._run, '--tune', 'lmemb=1')
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestBench)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
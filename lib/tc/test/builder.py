@@ -0,0 +1,48 @@
+# encoding: utf-8
+from __future__ import with_statement
+import os, sys
+import unittest
+import random
+import tc
+
+DBNAME = 'test.builder.bdb'
+
+class TestBDBBuilder(unittest.TestCase):
+  def setUp(self):
+    if os.path.exists(DBNAME):
+      os.remove(DBNAME)
+  
+  tearDown = setUp
+  
+  def _check(self, expected):
+    db = tc.BDB()
+    db.open(DBNAME, tc.BDBOREADER)
+    self.assertEqual(db.items(), sorted(expected.items()))
+    db.close()
+  
+  def testUnsorted(self):
+    rnd = random.Random(0)
+    items = [('%04d' % rnd.randrange(500), str(i)) for i in range(2000)]
+    # small runs to exercise spilling and merging
+    with tc.BDBBuilder(DBNAME, runsize=1024, batch=100) as builder:
+      builder.add(*items[0])
+      builder.addmany(items[1:])
+    self.assertEqual(builder.count, 2000)
+    self._check(dict(items))
+  
+  def testPresorted(self):
+    items = dict(('%04d' % i, str(i)) for i in range(1000))
+    builder = tc.BDBBuilder(DBNAME, presorted=True, batch=100)
+    builder.addmany(sorted(items.items()))
+    self.assertRaises(ValueError, builder.add, '0000', 'x')
+    self.assertEqual(builder.finish(), 1000)
+    self._check(items)
+
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestBDBBuilder)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
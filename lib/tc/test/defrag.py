@@ -0,0 +1,67 @@
+# encoding: utf-8
+import os, sys
+import unittest
+import time
+import tc
+
+DBNAME = 'test.defrag.hdb'
+
+class TestDefrag(unittest.TestCase):
+  def setUp(self):
+    if os.path.exists(DBNAME):
+      os.remove(DBNAME)
+  
+  tearDown = setUp
+  
+  def _fragment(self, db):
+    for i in range(2000):
+      db.put('%d' % i, 'x' * (i % 100))
+    for i in range(0, 2000, 2):
+      db.out('%d' % i)
+  
+  def testDefrag(self):
+    db = tc.HDB()
+    db.open(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    self._fragment(db)
+    db.defrag(100)
+    db.defrag()
+    self.assertEqual(len(db), 1000)
+    self.assertEqual(db['1'], 'x')
+    # the thread needs setmutex
+    self.assertRaises(ValueError, tc.Defrag, db)
+    self.assertRaises(TypeError, tc.Defrag, {})
+    db.close()
+  
+  def testBackground(self):
+    db = tc.HDB()
+    db.setmutex()
+    db.open(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    self._fragment(db)
+    defrag = tc.Defrag(db, step=16, steps=4, interval=0.01, maxlat=1.0)
+    time.sleep(0.2)
+    status = defrag.status()
+    self.assertTrue(status['running'])
+    self.assertTrue(status['calls'] > 0)
+    self.assertTrue(0 <= status['progress'] <= 1)
+    defrag.pause()
+    self.assertFalse(defrag.status()['running'])
+    # a call in progress may still finish
+    time.sleep(0.05)
+    calls = defrag.status()['calls']
+    time.sleep(0.05)
+    self.assertEqual(defrag.status()['calls'], calls)
+    defrag.resume()
+    self.assertTrue(defrag.status()['running'])
+    defrag.stop()
+    self.assertFalse(defrag.status()['running'])
+    self.assertEqual(len(db), 1000)
+    db.close()
+
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestDefrag)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
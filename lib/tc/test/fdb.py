@@ -0,0 +1,152 @@
+# encoding: utf-8
+import os, sys
+import unittest
+import tc
+import struct
+
+DBNAME = 'test.fdb'
+DBNAME2 = 'test.fdb.copy'
+
+class TestFDB(unittest.TestCase):
+  def setUp(self):
+    if os.path.exists(DBNAME):
+      os.remove(DBNAME)
+  
+  def tearDown(self):
+    if os.path.exists(DBNAME):
+      os.remove(DBNAME)
+  
+  def testAll(self):
+    # new
+    db = tc.FDB()
+    # tune
+    db.tune(8, 1 << 20)
+    # open
+    db.open(DBNAME2, tc.FDBOWRITER | tc.FDBOCREAT)
+    # copy
+    db.copy(DBNAME)
+    db.close()
+    os.remove(DBNAME2)
+    
+    db = tc.FDB(DBNAME, tc.FDBOWRITER)
+    self.assertEqual(db.width(), 8)
+    
+    # put
+    db.put(1, 'hamu')
+    db.put(3, 'kiki')
+    db[2] = 'moru'
+    db.putcat(1, '-ju')
+    self.assertRaises(tc.Error, db.putkeep, 1, 'x')
+    db.put(tc.FDBIDNEXT, 'nya-')
+    
+    # get
+    self.assertEqual(db.get(1), 'hamu-ju')
+    self.assertEqual(db[2], 'moru')
+    self.assertEqual(db[4], 'nya-')
+    self.assertRaises(KeyError, db.get, 5)
+    self.assertRaises(TypeError, db.get, '1')
+    self.assertRaises(TypeError, db.__getitem__, '1')
+    self.assertEqual(db.vsiz(3), 4)
+    buf = bytearray(8)
+    self.assertEqual(db.get_into(1, buf), 7)
+    self.assertEqual(buf[:7], bytearray('hamu-ju'))
+    small = bytearray('xy')
+    self.assertRaises(ValueError, db.get_into, 1, small)
+    self.assertEqual(small, bytearray('ha'))
+    self.assertEqual(db.get_into(1, bytearray(7)), 7)
+    
+    # stats
+    self.assertEqual(len(db), 4)
+    self.assertEqual(db.rnum(), 4)
+    self.assertEqual(db.min(), 1)
+    self.assertEqual(db.max(), 4)
+    self.assertTrue(2 in db)
+    self.assertFalse(5 in db)
+    
+    # range
+    self.assertEqual(db.range(), [1, 2, 3, 4])
+    self.assertEqual(db.range(2, 3), [2, 3])
+    self.assertEqual(db.range(max=2), [1, 2])
+    
+    # iteration
+    self.assertEqual(db.keys(), [1, 2, 3, 4])
+    self.assertEqual(list(db), [1, 2, 3, 4])
+    self.assertEqual(db.values(), ['hamu-ju', 'moru', 'kiki', 'nya-'])
+    self.assertEqual(db.items()[0], (1, 'hamu-ju'))
+    it1, it2 = db.iterkeys(), db.iteritems()
+    self.assertEqual(next(it1), 1)
+    self.assertEqual(next(it1), 2)
+    self.assertEqual(next(it2), (1, 'hamu-ju'))
+    self.assertEqual(list(it1), [3, 4])
+    db.iterinit()
+    self.assertEqual(db.iternext(), 1)
+    
+    # out
+    del db[2]
+    db.out(3)
+    self.assertFalse(2 in db)
+    self.assertRaises(KeyError, db.out, 3)
+    self.assertEqual(list(db.itervalues()), ['hamu-ju', 'nya-'])
+    
+    # addint
+    self.assertEqual(db.addint(10, 3), 3)
+    self.assertEqual(db.addint(10, 5), 8)
+    
+    # vanish
+    db.vanish()
+    self.assertEqual(len(db), 0)
+    self.assertEqual(db.keys(), [])
+  
+  def testGetRange(self):
+    db = tc.FDB()
+    db.tune(4)
+    db.open(DBNAME, tc.FDBOWRITER | tc.FDBOCREAT)
+    for i in (1, 2, 4):
+      db[i] = struct.pack('i', i * 10)
+    
+    data = db.getrange(1, 5)
+    self.assertEqual(len(data), 20)
+    self.assertEqual(struct.unpack('5i', data), (10, 20, 0, 40, 0))
+    db[3] = 'ab'
+    self.assertEqual(db.getrange(3, 4, 2), 'ab' + struct.pack('i', 40)[:2])
+    
+    buf = bytearray(14)
+    self.assertEqual(db.getrange_into(2, buf), 3)
+    self.assertEqual(str(buf), struct.pack('i', 20) + 'ab\0\0' + struct.pack('i', 40) + '\0\0')
+    buf = bytearray(8)
+    self.assertEqual(db.getrange_into(4, memoryview(buf)), 1)
+    self.assertEqual(struct.unpack('2i', str(buf)), (40, 0))
+    
+    self.assertRaises(ValueError, db.getrange, 3, 2)
+    self.assertRaises(ValueError, db.getrange, 0, 2)
+    self.assertRaises(TypeError, db.getrange_into, 1, 'abcd')
+  
+  def testStats(self):
+    db = tc.FDB(DBNAME, tc.FDBOWRITER | tc.FDBOCREAT)
+    db.put(1, 'abc')
+    db[2] = 'de'
+    db.get(1)
+    self.assertRaises(KeyError, db.get, 3)
+    db.getrange(1, 2, 4)
+    self.assertEqual(list(db), [1, 2])
+    stats = db.stats()
+    self.assertEqual(stats['put']['calls'], 2)
+    self.assertEqual(stats['put']['bytes_in'], 5)
+    self.assertEqual(stats['get']['calls'], 2)
+    self.assertEqual(stats['get']['errors'], 1)
+    self.assertEqual(stats['get']['bytes_out'], 3)
+    self.assertEqual(stats['getmany']['bytes_out'], 8)
+    self.assertEqual(stats['iter']['calls'], 1)
+    self.assertTrue('op="put"' in db.prometheus())
+    self.assertEqual(db.stats(reset=True), stats)
+    self.assertEqual(db.stats(), {})
+    db.close()
+
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestFDB)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
@@ -1,4 +1,5 @@
 # encoding: utf-8
+from __future__ import with_statement
 import os, sys
 import unittest
 import tc
@@ -141,11 +142,292 @@ class TestHDB(unittest.TestCase):
     # remove
     os.remove(DBNAME)
   
+  def testGetmany(self):
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    db.put('hamu', 'ju')
+    db.put('moru', 'pui')
+    self.assertEqual(db.getmany(['moru', 'hamu']), ['pui', 'ju'])
+    # missing keys are replaced by default rather than raising KeyError
+    self.assertEqual(db.getmany(['hamu', 'kiki']), ['ju', None])
+    self.assertEqual(db.getmany(iter(['kiki', 'moru']), 'nya-'), ['nya-', 'pui'])
+    self.assertEqual(db.getmany([]), [])
+    self.assertRaises(TypeError, db.getmany, [1, 2])
+    # keys are converted as get() converts them
+    db.put(u'moru', 'nyan')
+    self.assertEqual(db.getmany([u'moru']), [db.get(u'moru')])
+  
+  def testPutmany(self):
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    self.assertEqual(db.putmany({'hamu': 'ju', 'moru': 'pui'}), 2)
+    self.assertEqual(db.putmany([('kiki', 'nya-'), ('moru', 'puipui')]), 2)
+    self.assertEqual(db.get('moru'), 'puipui')
+    # keep skips existing records
+    self.assertEqual(db.putmany([('kiki', 'x'), ('gunya', 'darari')], 'keep'), 1)
+    self.assertEqual(db.get('kiki'), 'nya-')
+    self.assertEqual(db.putmany(iter([('kiki', 'nya-')]), mode='cat',
+                                transaction=False), 1)
+    self.assertEqual(db.get('kiki'), 'nya-nya-')
+    self.assertEqual(db.putmany(('k%d' % i, 'v%d' % i) for i in range(3000)), 3000)
+    self.assertEqual(db.rnum(), 3004)
+    self.assertRaises(ValueError, db.putmany, [], 'dup')
+    self.assertRaises(TypeError, db.putmany, [('hamu',)])
+    # keys are converted as put() and get() convert them
+    self.assertEqual(db.putmany([(u'nyan', 'x')]), 1)
+    self.assertEqual(db.get(u'nyan'), 'x')
+    # chunks written before an error stay, and the exception tells how many
+    # records they hold; the chunk of the bad pair is not written
+    items = [('p%d' % i, 'x') for i in range(1500)] + [('bad', object())]
+    try:
+      db.putmany(items)
+    except TypeError, e:
+      self.assertEqual(e.stored, 1024)
+    else:
+      self.fail()
+    self.assertEqual(db.get('p1023'), 'x')
+    self.assertRaises(KeyError, db.get, 'p1024')
+  
+  def testScan(self):
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    # spans several chunks, with a value too large to share one
+    items = [('k%d' % i, 'v%d' % i) for i in range(10000)]
+    items.append(('big', 'x' * (5 << 20)))
+    db.putmany(items)
+    items.sort()
+    self.assertEqual(sorted(db.keys()), [k for k, v in items])
+    self.assertEqual(sorted(db.values()), sorted(v for k, v in items))
+    self.assertEqual(sorted(db.items()), items)
+  
+  def testIterators(self):
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    db.setmutex()
+    items = dict(('k%d' % i, 'v%d' % i) for i in range(1000))
+    db.putmany(items)
+    # iterators don't disturb each other, nor tc's own iterator
+    db.iterinit()
+    first = db.iternext()
+    keys, values = iter(db), db.itervalues()
+    self.assertTrue(isinstance(keys, tc.HDBIterator))
+    seen = [(next(keys), next(values)) for i in range(500)]
+    self.assertEqual(len(db.keys()), 1000)
+    seen += zip(keys, values)
+    self.assertEqual(sorted(k for k, v in seen), sorted(items))
+    self.assertEqual(sorted(v for k, v in seen), sorted(items.values()))
+    self.assertNotEqual(db.iternext(), first)
+    # removing records while iterating
+    it = db.iteritems()
+    for k, v in it:
+      self.assertEqual(items.pop(k), v)
+      del db[k]
+    self.assertEqual(items, {})
+    self.assertEqual(db.rnum(), 0)
+    # threads scanning one handle
+    import threading
+    db.putmany(('k%d' % i, 'v%d' % i) for i in range(1000))
+    results = []
+    def scan():
+      results.append(sorted(db.iterkeys()))
+    threads = [threading.Thread(target=scan) for i in range(4)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    self.assertEqual(results, [sorted(db.keys())] * 4)
+
+  def testIteratorsDefrag(self):
+    db = tc.HDB()
+    db.tune(16, -1, -1, 0)
+    db.open(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    db.putmany(('k%04d' % i, 'v' * (i % 97)) for i in range(2000))
+    # records move and free blocks are reused between chunks: iterators
+    # resume by key, never by a file offset
+    seen = set()
+    it = db.iterkeys()
+    for i, k in enumerate(it):
+      self.assertFalse(k in seen)
+      seen.add(k)
+      del db[k]
+      if i % 100 == 0:
+        db['new%d' % i] = 'x' * (i % 50)
+        db.defrag(0)
+    self.assertTrue(set('k%04d' % i for i in range(2000)) <= seen)
+    # tc's iterator as well, one key at a time
+    db.putmany(('k%04d' % i, 'v' * (i % 97)) for i in range(200))
+    db.iterinit()
+    first = db.iternext()
+    del db[first]
+    db.defrag(0)
+    rest = [db.iternext() for i in range(db.rnum())]
+    self.assertFalse(first in rest)
+    self.assertRaises(KeyError, db.iternext)
+    db.close()
+  
+  def testBuffers(self):
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    # values may be any buffer
+    db.put('hamu', bytearray('ju'))
+    db.putcat('hamu', buffer('ju'))
+    db['moru'] = bytearray('pui')
+    db.putmany([('kiki', bytearray('nya-'))])
+    self.assertEqual(db.getmany(['hamu', 'moru', 'kiki']), ['juju', 'pui', 'nya-'])
+    self.assertRaises(TypeError, db.put, 'hamu', 1)
+    # get_into
+    buf = bytearray(8)
+    self.assertEqual(db.get_into('hamu', buf), 4)
+    self.assertEqual(buf[:4], 'juju')
+    self.assertEqual(db.get_into('kiki', memoryview(buf)[4:]), 4)
+    self.assertEqual(str(buf), 'jujunya-')
+    small = bytearray('xy')
+    self.assertRaises(ValueError, db.get_into, 'hamu', small)
+    # like recv_into, what fits has been written
+    self.assertEqual(small, bytearray('ju'))
+    self.assertEqual(db.get_into('hamu', bytearray(4)), 4)
+    self.assertRaises(KeyError, db.get_into, 'gunya', buf)
+    self.assertRaises(TypeError, db.get_into, 'hamu', 'readonly')
+  
   def testEmptyIteritems(self):
     db = tc.HDB()
     db.open(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
     self.assertEqual(list(db.iteritems()), [])
 
+  def testTransaction(self):
+    db = tc.HDB()
+    db.open(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    db.tranbegin()
+    db['a'] = '1'
+    db.tranabort()
+    self.assertFalse('a' in db)
+    with db.transaction():
+      db['a'] = '1'
+    self.assertEqual(db['a'], '1')
+    try:
+      with db.transaction() as txdb:
+        self.assertTrue(txdb is db)
+        db['b'] = '2'
+        raise ValueError
+    except ValueError:
+      pass
+    self.assertFalse('b' in db)
+    # putmany writes into the transaction in progress instead of waiting
+    # for it to end
+    with db.transaction():
+      self.assertEqual(db.putmany([('c', '3'), ('d', '4')]), 2)
+    self.assertEqual(db.getmany(['c', 'd']), ['3', '4'])
+    try:
+      with db.transaction():
+        db.putmany({'e': '5'})
+        raise ValueError
+    except ValueError:
+      pass
+    self.assertFalse('e' in db)
+    db.tranbegin()
+    db.putmany({'e': '5'})
+    db.trancommit()
+    self.assertEqual(db['e'], '5')
+    # nesting would wait forever for the outer transaction to end
+    with db.transaction():
+      self.assertRaises(RuntimeError, db.tranbegin)
+      self.assertRaises(RuntimeError, db.transaction().__enter__)
+    db.close()
+
+  def testTuning(self):
+    db = tc.HDB()
+    # Tokyo Cabinet's defaults
+    self.assertEqual(db.tuning()['xmsiz'], 64 << 20)
+    db.tune(100, 4, 10, 0)
+    db.setcache(1000)
+    db.setxmsiz(1 << 28)
+    db.setdfunit(8)
+    # 32-bit parameters are not truncated
+    self.assertRaises(OverflowError, db.setcache, 1 << 32)
+    self.assertRaises(OverflowError, db.setdfunit, 1 << 32)
+    db.open(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    tuning = db.tuning()
+    self.assertTrue(tuning['bnum'] >= 100)
+    self.assertEqual(tuning['apow'], 4)
+    self.assertEqual(tuning['rcnum'], 1000)
+    self.assertEqual(tuning['xmsiz'], 1 << 28)
+    self.assertEqual(tuning['dfunit'], 8)
+    # too late once open
+    self.assertRaises(tc.Error, db.setxmsiz, 1 << 20)
+    db.close()
+
+  def testStats(self):
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    self.assertEqual(db.stats(), {})
+    db.put('a', 'hello')
+    db['b'] = 'world'
+    self.assertEqual(db.get('a'), 'hello')
+    self.assertRaises(KeyError, db.get, 'c')
+    db.getmany(['a', 'b', 'c'])
+    list(db.iteritems())
+    stats = db.stats()
+    self.assertEqual(stats['put']['calls'], 2)
+    self.assertEqual(stats['put']['bytes_in'], 12)
+    self.assertEqual(stats['get']['calls'], 2)
+    self.assertEqual(stats['get']['errors'], 1)
+    self.assertEqual(stats['get']['bytes_out'], 5)
+    self.assertEqual(stats['getmany']['calls'], 1)
+    self.assertEqual(stats['getmany']['bytes_out'], 10)
+    self.assertTrue(stats['iter']['calls'] >= 1)
+    get = stats['get']
+    self.assertTrue(0 < get['p50'] <= get['p99'] <= get['p999'])
+    self.assertEqual(sum(n for upper, n in get['histogram']), 2)
+    text = db.prometheus(name='test')
+    self.assertTrue('tc_calls_total{db="test",op="put"} 2\n' in text)
+    self.assertTrue('tc_latency_seconds_count{db="test",op="get"} 2\n' in text)
+    self.assertRaises(ValueError, db.prometheus, None, 'te"st')
+    path = DBNAME + '.prom'
+    try:
+      db.prometheus(path, 'test')
+      self.assertEqual(open(path, 'rb').read(), text)
+    finally:
+      if os.path.exists(path):
+        os.remove(path)
+    self.assertEqual(db.stats(reset=True), stats)
+    self.assertEqual(db.stats(), {})
+    # get_into and the list scans are counted too
+    db.get_into('a', bytearray(8))
+    db.keys()
+    stats = db.stats()
+    self.assertEqual(stats['get']['bytes_out'], 5)
+    self.assertTrue(stats['iter']['calls'] >= 1)
+    db.close()
+
+  def testCodec(self):
+    self.assertRaises(ValueError, tc.HDB, codec='pickle')
+    db = tc.HDB(DBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    db.put('raw', 'hello')
+    db.setcodec('tc')
+    record = {'id': 1, 'score': 0.5, 'tags': ('a', 'b'), 'next': None,
+              'big': 2 ** 80, 'neg': -3, 'ok': True}
+    db.put('a', record)
+    db['b'] = [1, 2.5, 'x']
+    db.putmany([('c', (1, 2)), ('d', 42)])
+    self.assertEqual(db.get('a'), record)
+    self.assertEqual(db['b'], [1, 2.5, 'x'])
+    self.assertEqual(db.getmany(['c', 'd', 'e'], None), [(1, 2), 42, None])
+    # values stored before the codec was set are returned raw
+    self.assertEqual(db.get('raw'), 'hello')
+    self.assertEqual(dict(db.iteritems())['d'], 42)
+    self.assertEqual(sorted(db.itervalues(), key=repr)[0], (1, 2))
+    self.assertRaises(ValueError, db.putcat, 'd', 'x')
+    self.assertRaises(ValueError, db.putmany, [('d', 'x')], 'cat')
+    self.assertRaises(TypeError, db.put, 'f', object())
+    self.assertRaises(ValueError, db.get_into, 'd', bytearray(16))
+    # raw values that start like the old one-byte header stay raw
+    db.setcodec(None)
+    db.put('fe', '\xfe\x01N')
+    db.setcodec('tc')
+    self.assertEqual(db.get('fe'), '\xfe\x01N')
+    db.setcodec(None)
+    self.assertEqual(db.get('d'), tc.encode(42))
+    self.assertEqual(tc.decode(db.get('a')), record)
+    db.close()
+    self.assertEqual(tc.decode(tc.encode(record)), record)
+    self.assertEqual(tc.decode('hello'), 'hello')
+    self.assertEqual(tc.encode(None)[:5], '\xfetc\x00' + chr(tc.TC_CODEC_VERSION))
+    self.assertRaises(ValueError, tc.decode, tc.encode(record)[:-1])
+
 def suite():
   return unittest.TestSuite([
     unittest.makeSuite(TestHDB)
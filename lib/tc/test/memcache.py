@@ -0,0 +1,81 @@
+# encoding: utf-8
+import os, sys
+import unittest
+import tc
+
+class TestMemCache(unittest.TestCase):
+  def _testAll(self, cache):
+    # put
+    cache.put('hamu', 'ju')
+    cache['moru'] = 'pui'
+    cache['kiki'] = bytearray('nya-')
+    self.assertTrue(cache.putkeep('nanana', 'na'))
+    self.assertFalse(cache.putkeep('hamu', 'x'))
+    self.assertEqual(cache.putmany({'a': '1', 'b': '2'}), 2)
+    
+    # get
+    self.assertEqual(cache.get('hamu'), 'ju')
+    self.assertEqual(cache['kiki'], 'nya-')
+    self.assertEqual(cache[u'moru'], 'pui')
+    # every method converts keys as get() does, with the default encoding
+    self.assertRaises(UnicodeEncodeError, cache.get, u'\xe9')
+    self.assertRaises(UnicodeEncodeError, cache.__getitem__, u'\xe9')
+    self.assertRaises(UnicodeEncodeError, cache.__contains__, u'\xe9')
+    self.assertRaises(UnicodeEncodeError, cache.getmany, [u'\xe9'])
+    self.assertRaises(KeyError, cache.get, 'nothing')
+    self.assertEqual(cache.getmany(['a', 'nothing', 'b'], ''), ['1', '', '2'])
+    self.assertEqual(cache.vsiz('kiki'), 4)
+    self.assertTrue('a' in cache)
+    self.assertFalse('nothing' in cache)
+    self.assertEqual(len(cache), 6)
+    self.assertEqual(cache.rnum(), 6)
+    self.assertTrue(cache.msiz() > 0)
+    self.assertEqual(sorted(cache), ['a', 'b', 'hamu', 'kiki', 'moru', 'nanana'])
+    
+    # out
+    cache.out('a')
+    del cache['b']
+    self.assertRaises(KeyError, cache.out, 'a')
+    self.assertEqual(len(cache), 4)
+    cache.vanish()
+    self.assertEqual(len(cache), 0)
+  
+  def testHash(self):
+    self._testAll(tc.MemCache())
+  
+  def testOrdered(self):
+    cache = tc.MemCache(ordered=True)
+    self._testAll(cache)
+    cache.putmany([('c', ''), ('a', ''), ('b', '')])
+    self.assertEqual(cache.keys(), ['a', 'b', 'c'])
+  
+  def testCapacity(self):
+    for ordered in (False, True):
+      cache = tc.MemCache(capnum=100, ordered=ordered)
+      for i in range(1000):
+        cache[str(i)] = str(i)
+      self.assertTrue(len(cache) <= 100)
+      self.assertEqual(cache['999'], '999')
+      if not ordered:
+        # the hash variant drops the least recently used records first
+        self.assertFalse('0' in cache)
+    
+    cache = tc.MemCache(capnum=100)
+    for i in range(1000):
+      cache[str(i)] = str(i)
+      self.assertEqual(cache['0'], '0')
+    self.assertFalse('1' in cache)
+    
+    cache = tc.MemCache(capsiz=1 << 16)
+    cache.putmany(('%d' % i, 'x' * 1024) for i in range(1000))
+    self.assertTrue(cache.msiz() < 1 << 17)
+    self.assertTrue(len(cache) < 1000)
+
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestMemCache)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
@@ -19,6 +19,8 @@ class TestTDB(unittest.TestCase):
     #db = tc.TDB(DBNAME, tc.TDBOWRITER | tc.TDBOCREAT)
     #db.open(DBNAME2, tc.HDBOWRITER | tc.HDBOCREAT)
     db = tc.TDB()
+    # setmutex
+    db.setmutex()
     # tune
     db.tune(100, 32, 64, tc.TDBTTCBS)
     # open
@@ -142,7 +144,129 @@ class TestTDB(unittest.TestCase):
     pks = q.keys()
     self.assertEquals(pks[0], 'rosa')
     self.assertEquals(len(pks), 1)
+    
+    # iteration yields the same keys as keys(), in order
+    q = db.query()
+    q.order('age', tc.TDBQONUMDESC)
+    self.assertEquals(list(q), ['jdoe', 'torgny', 'rosa'])
+    it = iter(q)
+    self.assertEquals(it.next(), 'jdoe')
+    # a new iteration runs the query again
+    self.assertEquals(list(q), ['jdoe', 'torgny', 'rosa'])
+    # iterations of one query don't disturb each other
+    it1, it2 = iter(q), iter(q)
+    self.assertTrue(it1 is not it2 and it1 is not q)
+    self.assertTrue(isinstance(it1, tc.TDBQueryIterator))
+    self.assertEquals(it1.next(), 'jdoe')
+    self.assertEquals(list(it2), ['jdoe', 'torgny', 'rosa'])
+    self.assertEquals(list(it1), ['torgny', 'rosa'])
+    pairs = [(a, b) for a in q for b in q]
+    self.assertEquals(len(pairs), 9)
+    self.assertEquals(pairs[-1], ('rosa', 'rosa'))
+    q.filter('age', tc.TDBQCNUMGT, '100')
+    self.assertEquals(list(q), [])
+    
+    # records
+    q = db.query()
+    q.order('age', tc.TDBQONUMASC)
+    recs = q.records()
+    self.assertEquals([pk for pk, cols in recs], ['rosa', 'torgny', 'jdoe'])
+    self.assertEquals(recs[0][1], db.get('rosa'))
+    recs = q.records(columns=['name', 'nonexistent'])
+    self.assertEquals(recs[2], ('jdoe', {'name': 'John Doe'}))
+    self.assertEquals(q.records([])[0], ('rosa', {}))
+    
+    # limit and count
+    q = db.query()
+    self.assertEquals(q.count(), 3)
+    q.order('age', tc.TDBQONUMDESC).limit(2)
+    self.assertEquals(q.keys(), ['jdoe', 'torgny'])
+    self.assertEquals(q.count(), 2)
+    q.limit(2, skip=1)
+    self.assertEquals(q.keys(), ['torgny', 'rosa'])
+    q.limit(-1, 2)
+    self.assertEquals(list(q), ['rosa'])
+    q.filter('age', tc.TDBQCNUMGT, '100')
+    self.assertEquals(q.count(), 0)
+    
+    # metasearch
+    q1 = db.query().filter('age', tc.TDBQCNUMLT, '30').order('age', tc.TDBQONUMDESC)
+    q2 = db.query().filter('colors', tc.TDBQCSTRINC, 'blue')
+    self.assertEquals(q1.metasearch([q2]), ['torgny', 'rosa'])
+    self.assertEquals(q1.metasearch([q2], tc.TDBMSISECT), ['rosa'])
+    self.assertEquals(q2.metasearch([q1], tc.TDBMSDIFF), ['torgny'])
+    self.assertEquals(q1.limit(1).metasearch([q2]), ['torgny'])
+    self.assertRaises(TypeError, q1.metasearch, [db])
+    # a query listed more than once is locked once
+    self.assertEquals(q2.metasearch([q2, q1], tc.TDBMSISECT), ['rosa'])
+    
+    # threads sharing queries
+    import threading
+    results = []
+    def search():
+      for i in range(50):
+        results.append((q1.keys(), sorted(q2), q1.metasearch([q2], tc.TDBMSISECT)))
+    threads = [threading.Thread(target=search) for i in range(4)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+    self.assertEquals(results, [(['rosa'], ['rosa', 'torgny'], ['rosa'])] * 200)
+    
+    # update and delete
+    db.put('old1', {'age': '90', 'visits': '1', 'score': '0.5'})
+    db.put('old2', {'age': '95', 'visits': '7'})
+    q = db.query().filter('age', tc.TDBQCNUMGE, '90')
+    self.assertEquals(q.update(set={'state': 'stale'}, incr={'visits': 2, 'score': 0.25}), 2)
+    self.assertEquals(db.get('old1'), {'age': '90', 'visits': '3', 'score': '0.75', 'state': 'stale'})
+    self.assertEquals(db.get('old2'), {'age': '95', 'visits': '9', 'score': '0.25', 'state': 'stale'})
+    self.assertEquals(q.update(set={'state': None}), 2)
+    # an integer added to a fraction keeps the fraction
+    self.assertEquals(q.update(incr={'score': 1}), 2)
+    self.assertEquals(db.get('old1')['score'], '1.75')
+    self.assertEquals(db.get('old2')['score'], '1.25')
+    self.assertFalse('state' in db.get('old1'))
+    self.assertRaises(TypeError, q.update, incr={'visits': 'x'})
+    q.delete()
+    self.assertRaises(KeyError, db.get, 'old1')
+    self.assertRaises(KeyError, db.get, 'old2')
+    self.assertEquals(q.update(incr={'visits': 1}), 0)
+    
+    # indexes
+    self.assertEquals(db.indexes(), [])
+    db.setindex('age', tc.TDBITDECIMAL)
+    db.setindex('colors', tc.TDBITTOKEN)
+    self.assertEquals(db.indexes(), [('age', tc.TDBITDECIMAL), ('colors', tc.TDBITTOKEN)])
+    self.assertRaises(tc.Error, db.setindex, 'age', tc.TDBITLEXICAL | tc.TDBITKEEP)
+    db.setindex('age', tc.TDBITOPT)
+    q = db.query()
+    q.order('age', tc.TDBQONUMDESC)
+    q.filter('age', tc.TDBQCNUMLE, '40')
+    self.assertEquals(q.keys(), ['torgny', 'rosa'])
+    db.setindex('colors', tc.TDBITVOID)
+    self.assertEquals(db.indexes(), [('age', tc.TDBITDECIMAL)])
+    # listing indexes while another thread adds and removes them
+    import threading
+    # db is passed in, a closure over it could not be deleted below
+    def churn(db):
+      for i in range(20):
+        db.setindex('c%d' % i, tc.TDBITLEXICAL)
+      for i in range(20):
+        db.setindex('c%d' % i, tc.TDBITVOID)
+    t = threading.Thread(target=churn, args=(db,))
+    t.start()
+    while t.isAlive():
+      self.assertEquals(db.indexes()[0], ('age', tc.TDBITDECIMAL))
+    t.join()
+    self.assertEquals(db.indexes(), [('age', tc.TDBITDECIMAL)])
 
+    # a query keeps its table alive
+    q = db.query()
+    del db
+    self.assertEqual(sorted(q.keys()), ['jdoe', 'rosa', 'torgny'])
+    del q
+    
+    db = tc.TDB(DBNAME, tc.TDBOWRITER)
     db.close()
     # operations after a close will fail
     try:
@@ -153,6 +277,54 @@ class TestTDB(unittest.TestCase):
       self.fail()
 
 
+  def testTransaction(self):
+    db = tc.TDB()
+    db.open(DBNAME, tc.TDBOWRITER | tc.TDBOCREAT)
+    db.tranbegin()
+    db.put('a', {'name': 'a'})
+    db.trancommit()
+    self.assertEqual(db.get('a'), {'name': 'a'})
+    with db.transaction():
+      db.put('b', {'name': 'b'})
+    self.assertEqual(db.get('b'), {'name': 'b'})
+    try:
+      with db.transaction():
+        db.put('c', {'name': 'c'})
+        raise ValueError
+    except ValueError:
+      pass
+    self.assertRaises(KeyError, db.get, 'c')
+    db.close()
+
+  def testStats(self):
+    db = tc.TDB(DBNAME, tc.TDBOWRITER | tc.TDBOCREAT)
+    db.put('a', {'name': 'a'})
+    db.get('a')
+    q = db.query()
+    q.keys()
+    q.count()
+    q.update(set={'seen': '1'})
+    stats = db.stats()
+    self.assertEqual(stats['put']['calls'], 1)
+    self.assertEqual(stats['get']['bytes_out'], 5)
+    self.assertEqual(stats['query']['calls'], 3)
+    self.assertTrue('op="query"' in db.prometheus())
+    db.close()
+
+  def testTuning(self):
+    db = tc.TDB()
+    db.setcache(1000, 2048, 1024)
+    db.setxmsiz(1 << 28)
+    db.setinvcache(1 << 24, 0.5)
+    db.open(DBNAME, tc.TDBOWRITER | tc.TDBOCREAT)
+    tuning = db.tuning()
+    self.assertEqual(tuning['rcnum'], 1000)
+    self.assertEqual(tuning['lcnum'], 2048)
+    self.assertEqual(tuning['xmsiz'], 1 << 28)
+    self.assertEqual(tuning['iccmax'], 1 << 24)
+    self.assertEqual(tuning['iccsync'], 0.5)
+    db.close()
+
 def suite():
   return unittest.TestSuite([
     unittest.makeSuite(TestTDB)
@@ -0,0 +1,96 @@
+# encoding: utf-8
+import os, sys
+import unittest
+import tc
+
+HDBNAME = 'test.writeback.hdb'
+BDBNAME = 'test.writeback.bdb'
+
+class TestWriteBack(unittest.TestCase):
+  def setUp(self):
+    for name in (HDBNAME, BDBNAME):
+      if os.path.exists(name):
+        os.remove(name)
+  
+  tearDown = setUp
+  
+  def _testAll(self, db):
+    wb = tc.WriteBack(db, interval=60.0)
+    
+    # reads see their own writes
+    wb.put('hamu', 'ju')
+    wb['moru'] = bytearray('pui')
+    self.assertEqual(wb.get('hamu'), 'ju')
+    self.assertEqual(wb['moru'], 'pui')
+    self.assertTrue('hamu' in wb)
+    self.assertRaises(KeyError, wb.get, 'nothing')
+    self.assertEqual(wb.pending(), 2)
+    # [] parses keys as get() and the database do
+    self.assertEqual(wb[u'hamu'], wb.get(u'hamu'))
+    self.assertRaises(UnicodeEncodeError, wb.__getitem__, u'\xe9')
+    self.assertRaises(UnicodeEncodeError, wb.__setitem__, u'\xe9', 'x')
+    
+    # flush is a barrier
+    wb.flush()
+    self.assertEqual(wb.pending(), 0)
+    self.assertEqual(db.get('hamu'), 'ju')
+    self.assertEqual(db.get('moru'), 'pui')
+    
+    # removals hide records of the database until flushed
+    wb.out('hamu')
+    del wb['nothing']
+    self.assertRaises(KeyError, wb.get, 'hamu')
+    self.assertEqual(db.get('hamu'), 'ju')
+    wb.flush(sync=True)
+    self.assertRaises(KeyError, db.get, 'hamu')
+    
+    # values go through the codec of the database
+    db.setcodec('tc')
+    wb.put('obj', {'n': 1})
+    wb['lst'] = [1.5, None]
+    self.assertEqual(wb.get('obj'), {'n': 1})
+    self.assertEqual(wb['lst'], [1.5, None])
+    wb.flush()
+    self.assertEqual(db.get('obj'), {'n': 1})
+    self.assertEqual(wb['moru'], 'pui')
+    db.setcodec(None)
+    self.assertEqual(wb.get('obj'), tc.encode({'n': 1}))
+    
+    # writers wait for the flusher once the memtable is full
+    wb = tc.WriteBack(db, interval=60.0, bufsiz=1 << 12, maxsiz=1 << 13)
+    for i in range(1000):
+      wb.put('%d' % i, 'x' * 100)
+    self.assertTrue(wb.pending() < 1000)
+    wb.close()
+    self.assertEqual(db.get('999'), 'x' * 100)
+    self.assertRaises(tc.Error, wb.put, 'a', 'b')
+  
+  def testHDB(self):
+    db = tc.HDB()
+    db.setmutex()
+    db.open(HDBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    self._testAll(db)
+    db.close()
+  
+  def testBDB(self):
+    db = tc.BDB()
+    db.setmutex()
+    db.open(BDBNAME, tc.BDBOWRITER | tc.BDBOCREAT)
+    self._testAll(db)
+    db.close()
+  
+  def testNoMutex(self):
+    db = tc.HDB()
+    db.open(HDBNAME, tc.HDBOWRITER | tc.HDBOCREAT)
+    self.assertRaises(ValueError, tc.WriteBack, db)
+    self.assertRaises(TypeError, tc.WriteBack, {})
+    db.close()
+
+
+def suite():
+  return unittest.TestSuite([
+    unittest.makeSuite(TestWriteBack)
+  ])
+
+if __name__=='__main__':
+  unittest.main()
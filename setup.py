@@ -22,10 +22,21 @@ sources = [
   'src/__init__.c',
   'src/util.c',
   'src/HDB.c',
+  'src/HDBIterator.c',
   'src/BDB.c',
   'src/BDBCursor.c',
   'src/TDB.c',
-  'src/TDBQuery.c'
+  'src/TDBQuery.c',
+  'src/TDBQueryIterator.c',
+  'src/FDB.c',
+  'src/FDBIterator.c',
+  'src/ADB.c',
+  'src/MemCache.c',
+  'src/WriteBack.c',
+  'src/Transaction.c',
+  'src/Defrag.c',
+  'src/Stats.c',
+  'src/Codec.c'
 ]
 
 # -----------------------------------------------------------------------------
@@ -290,6 +301,48 @@ class sphinx_build(Command):
       log.info('Sphinx not installed -- skipping documentation. (%s)', sys.exc_info()[1])
   
 
+class bench(Command):
+  description = 'build in place and run a workload benchmark (see tc/bench.py)'
+  user_options = [
+    ('db=', None, 'database type: hdb, bdb or tdb (default: hdb)'),
+    ('workload=', 'w', 'YCSB workload a to f (default: a)'),
+    ('distribution=', 'd', 'key distribution: uniform, zipfian or latest'),
+    ('threads=', 't', 'threads per process (default: 1)'),
+    ('processes=', 'p', 'processes, each with a database of its own (default: 1)'),
+    ('records=', 'r', 'records loaded per process (default: 100000)'),
+    ('operations=', 'n', 'operations in total (default: 100000)'),
+    ('seconds=', 's', 'run for this long instead of a number of operations'),
+    ('value-size=', None, 'bytes per value (default: 100)'),
+    ('tune=', None, 'comma separated tuning parameters, e.g. bnum=1000000,xmsiz=0'),
+    ('output=', 'o', 'write the JSON report to a file instead of stdout'),
+  ]
+  
+  def initialize_options(self):
+    for option in self.user_options:
+      setattr(self, option[0].rstrip('=').replace('-', '_'), None)
+  
+  def finalize_options(self):
+    self.bench_args = []
+    for option in self.user_options:
+      name = option[0].rstrip('=')
+      value = getattr(self, name.replace('-', '_'))
+      if value is None:
+        continue
+      if name == 'tune':
+        for param in value.split(','):
+          self.bench_args.extend(['--tune', param.strip()])
+      else:
+        self.bench_args.extend(['--' + name, value])
+  
+  def run(self):
+    build_ext = self.reinitialize_command('build_ext')
+    build_ext.inplace = True
+    self.run_command('build_ext')
+    sys.path.insert(0, os.path.abspath('lib'))
+    from tc import bench
+    bench.main(self.bench_args)
+  
+
 from distutils.command.clean import clean as _clean
 class clean(_clean):
   def run(self):
@@ -326,6 +379,7 @@ class TCDistribution(Distribution):
       'build_ext': build_ext,
       'sdist': sdist,
       'docs': sphinx_build,
+      'bench': bench,
       'clean': clean,
     }
     #try:
@@ -0,0 +1,565 @@
+#include "ADB.h"
+#include "Transaction.h"
+#include "util.h"
+#include <tchdb.h>
+#include <tcbdb.h>
+#include <tcfdb.h>
+#include <tctdb.h>
+
+/* Private --------------------------------------------------------------- */
+
+/* tcadb keeps no error code of its own. The concrete database of a file
+   backend has one; the on-memory backends only fail on missing records
+   (or on existing ones with putkeep), so `dflt` stands in for them. */
+static int _ecode(TCADB *adb, int dflt) {
+  switch (tcadbomode(adb)) {
+    case ADBOVOID:
+      return TCEINVALID;
+    case ADBOHDB:
+      return tchdbecode((TCHDB *)tcadbreveal(adb));
+    case ADBOBDB:
+      return tcbdbecode((TCBDB *)tcadbreveal(adb));
+    case ADBOFDB:
+      return tcfdbecode((TCFDB *)tcadbreveal(adb));
+    case ADBOTDB:
+      return tctdbecode((TCTDB *)tcadbreveal(adb));
+    default:
+      return dflt;
+  }
+}
+
+static void _set_error(TCADB *adb, int dflt) {
+  int ecode = _ecode(adb, dflt);
+  if (ecode == TCENOREC) {
+    PyErr_SetString(PyExc_KeyError, tchdberrmsg(ecode));
+  } else {
+    tc_Error_SetCodeAndString(ecode, tchdberrmsg(ecode));
+  }
+}
+
+static int _ecode_norec(TCADB *adb) {
+  return _ecode(adb, TCENOREC);
+}
+
+static void _error_keep(TCADB *adb) {
+  _set_error(adb, TCEKEEP);
+}
+
+static void _error_misc(TCADB *adb) {
+  _set_error(adb, TCEMISC);
+}
+
+/* codec is the one of the handle for lists of values, TC_CODEC_RAW
+   otherwise */
+static PyObject *_list_from_tclist(TCLIST *list, tc_codec_t codec) {
+  PyObject *ret, *value;
+  const char *buf;
+  int i, n = tclistnum(list), size;
+
+  if ((ret = PyList_New(n))) {
+    for (i = 0; i < n; i++) {
+      buf = tclistval(list, i, &size);
+      if (!(value = tc_Codec_Value(codec, buf, size))) {
+        Py_CLEAR(ret);
+        break;
+      }
+      PyList_SET_ITEM(ret, i, value);
+    }
+  }
+  return ret;
+}
+
+/* Public --------------------------------------------------------------- */
+
+/* Errors of lookups: missing records raise KeyError */
+void tc_Error_SetADB(TCADB *adb) {
+  log_trace("ENTER");
+  _set_error(adb, TCENOREC);
+}
+
+static long tc_ADB_Hash(PyObject *self) {
+  log_trace("ENTER");
+  PyErr_SetString(PyExc_TypeError, "ADB objects are unhashable");
+  return -1L;
+}
+
+static void tc_ADB_dealloc(tc_ADB *self) {
+  log_trace("ENTER");
+  /* NOTE: tcadbdel closes adb implicitly */
+  if (self->adb) {
+    Py_BEGIN_ALLOW_THREADS
+    tcadbdel(self->adb);
+    Py_END_ALLOW_THREADS
+  }
+  if (self->iterlock) {
+    PyThread_free_lock(self->iterlock);
+  }
+  tc_Stats_del(self->stats);
+  PyObject_Del(self);
+}
+
+static PyObject *tc_ADB_new(PyTypeObject *type, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  tc_ADB *self;
+  if (!(self = (tc_ADB *)type->tp_alloc(type, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_ADB instance");
+    return NULL;
+  }
+  if (!(self->iterlock = PyThread_allocate_lock())) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc iterator lock");
+  } else if (!(self->stats = tc_Stats_new())) {
+    /* exception set by tc_Stats_new */
+  } else if ((self->adb = tcadbnew())) {
+    char *name = NULL;
+    PyObject *codec = NULL;
+    static char *kwlist[] = {"name", "codec", NULL};
+
+    if (PyArg_ParseTupleAndKeywords(args, keywds, "|sO:open", kwlist,
+                                    &name, &codec) &&
+        tc_Codec_FromObject(codec, &self->codec) == 0) {
+      if (name) {
+        bool result;
+        Py_BEGIN_ALLOW_THREADS
+        result = tcadbopen(self->adb, name);
+        Py_END_ALLOW_THREADS
+        if (result) {
+          return (PyObject *)self;
+        }
+      } else {
+        return (PyObject *)self;
+      }
+      _error_misc(self->adb);
+    }
+  } else {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc TCADB instance");
+  }
+  tc_ADB_dealloc(self);
+  return NULL;
+}
+
+static PyObject *tc_ADB_open(tc_ADB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *name;
+  bool result;
+  static char *kwlist[] = {"name", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s:open", kwlist, &name)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  result = tcadbopen(self->adb, name);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    _error_misc(self->adb);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+TC_BOOL_NOARGS(tc_ADB_close,tc_ADB,tcadbclose,adb,_error_misc,adb);
+TC_XDB_PUT(tc_ADB_put, tc_ADB, put, tcadbput, adb, _error_misc, false);
+TC_XDB_PUT(tc_ADB_putkeep, tc_ADB, putkeep, tcadbputkeep, adb, _error_keep, false);
+TC_XDB_PUT(tc_ADB_putcat, tc_ADB, putcat, tcadbputcat, adb, _error_misc, true);
+TC_BOOL_KEYARGS(tc_ADB_out,tc_ADB,out,tcadbout,adb,tc_Error_SetADB,adb,TC_OP_OUT);
+TC_STRINGL_KEYARGS(tc_ADB_get,tc_ADB,get,tcadbget,adb,tc_Error_SetADB,TC_OP_GET);
+TC_XDB_getmany(tc_ADB_getmany,tc_ADB,getmany,tcadbget,_ecode_norec,adb,tc_Error_SetADB);
+TC_INT_KEYARGS(tc_ADB_vsiz,tc_ADB,vsiz,tcadbvsiz,adb,tc_Error_SetADB);
+
+/* tc's own iterator, shared by everyone calling iterinit() and iternext() */
+static PyObject *tc_ADB_iterinit(tc_ADB *self) {
+  log_trace("ENTER");
+  bool result;
+
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->iterlock, WAIT_LOCK);
+  result = tcadbiterinit(self->adb);
+  PyThread_release_lock(self->iterlock);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    _error_misc(self->adb);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_ADB_iternext(tc_ADB *self) {
+  log_trace("ENTER");
+  PyObject *ret;
+  void *key;
+  int key_len;
+
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->iterlock, WAIT_LOCK);
+  key = tcadbiternext(self->adb, &key_len);
+  PyThread_release_lock(self->iterlock);
+  Py_END_ALLOW_THREADS
+
+  if (!key) {
+    tc_Error_SetADB(self->adb);
+    return NULL;
+  }
+  ret = PyBytes_FromStringAndSize(key, key_len);
+  free(key);
+  return ret;
+}
+
+static PyObject *tc_ADB_fwmkeys(tc_ADB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *ret;
+  char *prefix;
+  int prefix_len, max = -1;
+  TCLIST *list;
+  static char *kwlist[] = {"prefix", "max", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#|i:fwmkeys", kwlist,
+                                   &prefix, &prefix_len, &max)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  list = tcadbfwmkeys(self->adb, prefix, prefix_len, max);
+  Py_END_ALLOW_THREADS
+
+  ret = _list_from_tclist(list, TC_CODEC_RAW);
+  tclistdel(list);
+  return ret;
+}
+
+/* Call a backend specific function, e.g. "putlist", "getlist" or
+   "setindex", and return its result as a list */
+static PyObject *tc_ADB_misc(tc_ADB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *ret, *_margs = NULL;
+  char *name;
+  TCLIST *margs, *list;
+  static char *kwlist[] = {"name", "args", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s|O:misc", kwlist,
+                                   &name, &_margs)) {
+    return NULL;
+  }
+  if (_margs) {
+    if (!(margs = tc_TCLIST_FromStrings(_margs, "arguments"))) {
+      return NULL;
+    }
+  } else {
+    margs = tclistnew();
+  }
+  Py_BEGIN_ALLOW_THREADS
+  list = tcadbmisc(self->adb, name, margs);
+  Py_END_ALLOW_THREADS
+  tclistdel(margs);
+
+  if (!list) {
+    _error_misc(self->adb);
+    return NULL;
+  }
+  ret = _list_from_tclist(list, TC_CODEC_RAW);
+  tclistdel(list);
+  return ret;
+}
+
+/* Snapshot of all keys, values or items, read with tc's iterator in one
+   GIL release */
+static PyObject *tc_ADB_scan(tc_ADB *self, tc_itertype_t itype) {
+  log_trace("ENTER");
+  PyObject *ret, *key, *value, *item;
+  TCLIST *keys, *values = NULL;
+  bool result;
+  int i, n;
+
+  keys = tclistnew();
+  if (itype != tc_iter_key_t) {
+    values = tclistnew();
+  }
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->iterlock, WAIT_LOCK);
+  if ((result = tcadbiterinit(self->adb))) {
+    void *kbuf, *vbuf;
+    int ksiz, vsiz;
+    while ((kbuf = tcadbiternext(self->adb, &ksiz))) {
+      if (values) {
+        if (!(vbuf = tcadbget(self->adb, kbuf, ksiz, &vsiz))) {
+          free(kbuf);
+          continue;
+        }
+        tclistpush(values, vbuf, vsiz);
+        free(vbuf);
+      }
+      tclistpush(keys, kbuf, ksiz);
+      free(kbuf);
+    }
+  }
+  PyThread_release_lock(self->iterlock);
+  Py_END_ALLOW_THREADS
+
+  ret = NULL;
+  if (!result) {
+    _error_misc(self->adb);
+  } else if (itype == tc_iter_key_t) {
+    ret = _list_from_tclist(keys, TC_CODEC_RAW);
+  } else if (itype == tc_iter_value_t) {
+    ret = _list_from_tclist(values, self->codec);
+  } else if ((ret = PyList_New(n = tclistnum(keys)))) {
+    for (i = 0; i < n; i++) {
+      const char *kbuf, *vbuf;
+      int ksiz, vsiz;
+      kbuf = tclistval(keys, i, &ksiz);
+      vbuf = tclistval(values, i, &vsiz);
+      key = PyBytes_FromStringAndSize(kbuf, ksiz);
+      value = tc_Codec_Value(self->codec, vbuf, vsiz);
+      if (!key || !value || !(item = PyTuple_New(2))) {
+        Py_XDECREF(key);
+        Py_XDECREF(value);
+        Py_CLEAR(ret);
+        break;
+      }
+      PyTuple_SET_ITEM(item, 0, key);
+      PyTuple_SET_ITEM(item, 1, value);
+      PyList_SET_ITEM(ret, i, item);
+    }
+  }
+  tclistdel(keys);
+  if (values) {
+    tclistdel(values);
+  }
+  return ret;
+}
+
+static PyObject *tc_ADB_keys(tc_ADB *self) {
+  return tc_ADB_scan(self, tc_iter_key_t);
+}
+
+static PyObject *tc_ADB_items(tc_ADB *self) {
+  return tc_ADB_scan(self, tc_iter_item_t);
+}
+
+static PyObject *tc_ADB_values(tc_ADB *self) {
+  return tc_ADB_scan(self, tc_iter_value_t);
+}
+
+/* Iterators run over a snapshot, so they don't compete for tc's iterator */
+static PyObject *tc_ADB_GetIter(tc_ADB *self, tc_itertype_t itype) {
+  log_trace("ENTER");
+  PyObject *list, *ret;
+
+  if (!(list = tc_ADB_scan(self, itype))) {
+    return NULL;
+  }
+  ret = PyObject_GetIter(list);
+  Py_DECREF(list);
+  return ret;
+}
+
+TC_XDB_iters(tc_ADB,tc_ADB_GetIter_keys,tc_ADB_GetIter_values,tc_ADB_GetIter_items,tc_ADB_GetIter);
+
+static PyObject *tc_ADB_optimize(tc_ADB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *params = NULL;
+  bool result;
+  static char *kwlist[] = {"params", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|z:optimize", kwlist, &params)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  result = tcadboptimize(self->adb, params);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    _error_misc(self->adb);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+TC_BOOL_NOARGS(tc_ADB_sync,tc_ADB,tcadbsync,adb,_error_misc,adb);
+TC_BOOL_NOARGS(tc_ADB_vanish,tc_ADB,tcadbvanish,adb,_error_misc,adb);
+TC_BOOL_PATHARGS(tc_ADB_copy, tc_ADB, copy, tcadbcopy, adb, _error_misc);
+TC_BOOL_NOARGS(tc_ADB_tranbegin,tc_ADB,tcadbtranbegin,adb,_error_misc,adb);
+TC_BOOL_NOARGS(tc_ADB_trancommit,tc_ADB,tcadbtrancommit,adb,_error_misc,adb);
+TC_BOOL_NOARGS(tc_ADB_tranabort,tc_ADB,tcadbtranabort,adb,_error_misc,adb);
+TC_XDB_transaction(tc_ADB_transaction,tc_ADB);
+TC_XDB_stats(tc_ADB_stats,tc_ADB);
+TC_XDB_prometheus(tc_ADB_prometheus,tc_ADB);
+TC_XDB_setcodec(tc_ADB_setcodec,tc_ADB);
+TC_STRING_NOARGS(tc_ADB_path,tc_ADB,tcadbpath,adb,_error_misc);
+TC_XDB_rnum(TCADB_rnum,TCADB,tcadbrnum);
+TC_XDB_rnum(TCADB_size,TCADB,tcadbsize);
+
+static PyObject *tc_ADB_rnum(tc_ADB *self) {
+  return PyLong_FromUnsignedLongLong(TCADB_rnum(self->adb));
+}
+
+static PyObject *tc_ADB_size(tc_ADB *self) {
+  return PyLong_FromUnsignedLongLong(TCADB_size(self->adb));
+}
+
+TC_XDB_Contains(tc_ADB_Contains,tc_ADB,tcadbvsiz,adb);
+TC_XDB___contains__(tc_ADB___contains__,tc_ADB,tc_ADB_Contains);
+TC_XDB___getitem__(tc_ADB___getitem__,tc_ADB,tcadbget,adb,tc_Error_SetADB);
+TC_XDB_length(tc_ADB_length,tc_ADB,TCADB_rnum,adb);
+TC_XDB_subscript(tc_ADB_subscript,tc_ADB,tcadbget,adb,tc_Error_SetADB);
+TC_XDB_DelItem(tc_ADB_DelItem,tc_ADB,tcadbout,adb,tc_Error_SetADB);
+TC_XDB_SetItem(tc_ADB_SetItem,tc_ADB,tcadbput,adb,_error_misc);
+TC_XDB_ass_sub(tc_ADB_ass_sub,tc_ADB,tc_ADB_SetItem,tc_ADB_DelItem);
+
+TC_XDB_addint(tc_ADB_addint,tc_ADB,addint,tcadbaddint,adb,_error_misc);
+TC_XDB_adddouble(tc_ADB_adddouble,tc_ADB,adddouble,tcadbadddouble,adb,_error_misc);
+
+/* methods of classes */
+static PyMethodDef tc_ADB_methods[] = {
+  {"setcodec", (PyCFunction)tc_ADB_setcodec, METH_VARARGS | METH_KEYWORDS,
+    "Set the codec of the values of an abstract database object, None or 'raw' for bytes, 'tc' for Python objects."},
+  {"open", (PyCFunction)tc_ADB_open, METH_VARARGS | METH_KEYWORDS,
+    "Open an abstract database object by name, e.g. \"*\", \"+\" or \"casket.tch#bnum=1000\"."},
+  {"close", (PyCFunction)tc_ADB_close, METH_NOARGS,
+    "Close an abstract database object."},
+  {"put", (PyCFunction)tc_ADB_put, METH_VARARGS | METH_KEYWORDS,
+    "Store a record into an abstract database object."},
+  {"putkeep", (PyCFunction)tc_ADB_putkeep, METH_VARARGS | METH_KEYWORDS,
+    "Store a new record into an abstract database object."},
+  {"putcat", (PyCFunction)tc_ADB_putcat, METH_VARARGS | METH_KEYWORDS,
+    "Concatenate a value at the end of the existing record in an abstract database object."},
+  {"out", (PyCFunction)tc_ADB_out, METH_VARARGS | METH_KEYWORDS,
+    "Remove a record of an abstract database object."},
+  {"get", (PyCFunction)tc_ADB_get, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record in an abstract database object."},
+  {"getmany", (PyCFunction)tc_ADB_getmany, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve the records of several keys in an abstract database object.\n"
+   "Returns a list of values in the order of the keys, missing records being replaced by default."},
+  {"vsiz", (PyCFunction)tc_ADB_vsiz, METH_VARARGS | METH_KEYWORDS,
+    "Get the size of the value of a record in an abstract database object."},
+  {"iterinit", (PyCFunction)tc_ADB_iterinit, METH_NOARGS,
+    "Initialize the iterator of an abstract database object."},
+  {"iternext", (PyCFunction)tc_ADB_iternext, METH_NOARGS,
+    "Get the next key of the iterator of an abstract database object."},
+  {"fwmkeys", (PyCFunction)tc_ADB_fwmkeys, METH_VARARGS | METH_KEYWORDS,
+    "Get forward matching keys in an abstract database object."},
+  {"misc", (PyCFunction)tc_ADB_misc, METH_VARARGS | METH_KEYWORDS,
+    "Call a versatile function for miscellaneous operations of an abstract database object."},
+  {"sync", (PyCFunction)tc_ADB_sync, METH_NOARGS,
+    "Synchronize updated contents of an abstract database object with the file and the device."},
+  {"optimize", (PyCFunction)tc_ADB_optimize, METH_VARARGS | METH_KEYWORDS,
+    "Optimize the storage of an abstract database object."},
+  {"vanish", (PyCFunction)tc_ADB_vanish, METH_NOARGS,
+    "Remove all records of an abstract database object."},
+  {"copy", (PyCFunction)tc_ADB_copy, METH_VARARGS | METH_KEYWORDS,
+    "Copy the database file of an abstract database object."},
+  {"tranbegin", (PyCFunction)tc_ADB_tranbegin, METH_NOARGS,
+    "Begin the transaction of an abstract database object."},
+  {"trancommit", (PyCFunction)tc_ADB_trancommit, METH_NOARGS,
+    "Commit the transaction of an abstract database object."},
+  {"tranabort", (PyCFunction)tc_ADB_tranabort, METH_NOARGS,
+    "Abort the transaction of an abstract database object."},
+  {"transaction", (PyCFunction)tc_ADB_transaction, METH_NOARGS,
+    "Get a context manager running a block in a transaction of an abstract database object."},
+  {"stats", (PyCFunction)tc_ADB_stats, METH_VARARGS | METH_KEYWORDS,
+    "Get a dict of the operation counters and latencies of an abstract database object."},
+  {"prometheus", (PyCFunction)tc_ADB_prometheus, METH_VARARGS | METH_KEYWORDS,
+    "Dump the operation counters and latencies of an abstract database object in the Prometheus text format."},
+  {"path", (PyCFunction)tc_ADB_path, METH_NOARGS,
+    "Get the file path of an abstract database object."},
+  {"rnum", (PyCFunction)tc_ADB_rnum, METH_NOARGS,
+    "Get the number of records of an abstract database object."},
+  {"size", (PyCFunction)tc_ADB_size, METH_NOARGS,
+    "Get the size of the database of an abstract database object."},
+  {"__contains__", (PyCFunction)tc_ADB___contains__, METH_O | METH_COEXIST,
+    NULL},
+  {"__getitem__", (PyCFunction)tc_ADB___getitem__, METH_O | METH_COEXIST,
+    NULL},
+  {"has_key", (PyCFunction)tc_ADB___contains__, METH_O,
+    NULL},
+  {"keys", (PyCFunction)tc_ADB_keys, METH_NOARGS,
+    NULL},
+  {"items", (PyCFunction)tc_ADB_items, METH_NOARGS,
+    NULL},
+  {"values", (PyCFunction)tc_ADB_values, METH_NOARGS,
+    NULL},
+  {"iteritems", (PyCFunction)tc_ADB_GetIter_items, METH_NOARGS,
+    NULL},
+  {"iterkeys", (PyCFunction)tc_ADB_GetIter_keys, METH_NOARGS,
+    NULL},
+  {"itervalues", (PyCFunction)tc_ADB_GetIter_values, METH_NOARGS,
+    NULL},
+  {"addint", (PyCFunction)tc_ADB_addint, METH_VARARGS | METH_KEYWORDS,
+    "Add an integer to a record in an abstract database object."},
+  {"adddouble", (PyCFunction)tc_ADB_adddouble, METH_VARARGS | METH_KEYWORDS,
+    "Add a real number to a record in an abstract database object."},
+  {NULL, NULL, 0, NULL}
+};
+
+
+/* Hack to implement "key in dict" */
+static PySequenceMethods tc_ADB_as_sequence = {
+  0,                             /* sq_length */
+  0,                             /* sq_concat */
+  0,                             /* sq_repeat */
+  0,                             /* sq_item */
+  0,                             /* sq_slice */
+  0,                             /* sq_ass_item */
+  0,                             /* sq_ass_slice */
+  (objobjproc)tc_ADB_Contains,   /* sq_contains */
+  0,                             /* sq_inplace_concat */
+  0,                             /* sq_inplace_repeat */
+};
+
+static PyMappingMethods tc_ADB_as_mapping = {
+  (lenfunc)tc_ADB_length, /* mp_length (inquiry/lenfunc )*/
+  (binaryfunc)tc_ADB_subscript, /* mp_subscript */
+  (objobjargproc)tc_ADB_ass_sub, /* mp_ass_subscript */
+};
+
+PyTypeObject tc_ADBType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.ADB",                                    /* tp_name */
+  sizeof(tc_ADB),                              /* tp_basicsize */
+  0,                                           /* tp_itemsize */
+  (destructor)tc_ADB_dealloc,                  /* tp_dealloc */
+  0,                                           /* tp_print */
+  0,                                           /* tp_getattr */
+  0,                                           /* tp_setattr */
+  0,                                           /* tp_compare */
+  0,                                           /* tp_repr */
+  0,                                           /* tp_as_number */
+  &tc_ADB_as_sequence,                         /* tp_as_sequence */
+  &tc_ADB_as_mapping,                          /* tp_as_mapping */
+  tc_ADB_Hash,                                 /* tp_hash  */
+  0,                                           /* tp_call */
+  0,                                           /* tp_str */
+  0,                                           /* tp_getattro */
+  0,                                           /* tp_setattro */
+  0,                                           /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,    /* tp_flags */
+  "Tokyo Cabinet Abstract database",           /* tp_doc */
+  0,                                           /* tp_traverse */
+  0,                                           /* tp_clear */
+  0,                                           /* tp_richcompare */
+  0,                                           /* tp_weaklistoffset */
+  (getiterfunc)tc_ADB_GetIter_keys,            /* tp_iter */
+  0,                                           /* tp_iternext */
+  tc_ADB_methods,                              /* tp_methods */
+  0,                                           /* tp_members */
+  0,                                           /* tp_getset */
+  0,                                           /* tp_base */
+  0,                                           /* tp_dict */
+  0,                                           /* tp_descr_get */
+  0,                                           /* tp_descr_set */
+  0,                                           /* tp_dictoffset */
+  0,                                           /* tp_init */
+  0,                                           /* tp_alloc */
+  tc_ADB_new,                                  /* tp_new */
+};
+
+int tc_ADB_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_ADBType) == 0)
+    return PyModule_AddObject(module, "ADB", (PyObject *)&tc_ADBType);
+  return -1;
+}
@@ -0,0 +1,24 @@
+#ifndef PYTC_ADB_H
+#define PYTC_ADB_H
+
+#include "_base.h"
+#include <pythread.h>
+#include <tcadb.h>
+#include "Stats.h"
+#include "Codec.h"
+
+typedef struct {
+  PyObject_HEAD
+  TCADB *adb;
+  PyThread_type_lock iterlock; /* serializes use of tc's iterator */
+  tc_Stats *stats;
+  tc_codec_t codec;             /* encoding of values */
+} tc_ADB;
+
+extern PyTypeObject tc_ADBType;
+
+void tc_Error_SetADB(TCADB *adb);
+
+int tc_ADB_register(PyObject *module);
+
+#endif
@@ -1,5 +1,7 @@
 #include "BDB.h"
+#include "HDB.h"
 #include "BDBCursor.h"
+#include "Transaction.h"
 #include "util.h"
 
 /* Private --------------------------------------------------------------- */
@@ -35,7 +37,9 @@
   }
 
 
-#define TCLIST2PyList() \
+/* codec is the one of the handle for lists of values, TC_CODEC_RAW for
+   lists of keys */
+#define TCLIST2PyList(codec) \
   if (!list) { \
     tc_Error_SetBDB(self->bdb); \
     return NULL; \
@@ -48,7 +52,10 @@
         PyObject *_value; \
         const char *value; \
         value = tclistval(list, i, &value_len); \
-        _value = PyBytes_FromStringAndSize(value, value_len); \
+        if (!(_value = tc_Codec_Value(codec, value, value_len))) { \
+          Py_CLEAR(ret); \
+          break; \
+        } \
         PyList_SET_ITEM(ret, i, _value); \
       } \
     } \
@@ -57,6 +64,19 @@
   }
 
 
+/* Total size of the values of a list, for stats */
+static uint64_t _tclist_size(const TCLIST *list) {
+  uint64_t size = 0;
+  int i, value_len;
+
+  for (i = 0; i < tclistnum(list); i++) {
+    tclistval(list, i, &value_len);
+    size += value_len;
+  }
+  return size;
+}
+
+
 /* Public --------------------------------------------------------------- */
 
 void tc_Error_SetBDB(TCBDB *bdb) {
@@ -104,6 +124,7 @@ static void tc_BDB_dealloc(tc_BDB *self) {
     tcbdbdel(self->bdb);
     Py_END_ALLOW_THREADS
   }
+  tc_Stats_del(self->stats);
   PyObject_Del(self);
 }
 
@@ -116,13 +137,17 @@ static PyObject *tc_BDB_new(PyTypeObject *type, PyObject *args, PyObject *keywds
   }
   /* NOTE: initialize member implicitly */
   self->cmp = self->cmpop = NULL;
-  if ((self->bdb = tcbdbnew())) {
+  if (!(self->stats = tc_Stats_new())) {
+    /* exception set by tc_Stats_new */
+  } else if ((self->bdb = tcbdbnew())) {
     int omode = 0;
     char *path = NULL;
-    static char *kwlist[] = {"path", "omode", NULL};
+    PyObject *codec = NULL;
+    static char *kwlist[] = {"path", "omode", "codec", NULL};
 
-    if (PyArg_ParseTupleAndKeywords(args, keywds, "|si:open", kwlist,
-                                    &path, &omode)) {
+    if (PyArg_ParseTupleAndKeywords(args, keywds, "|siO:open", kwlist,
+                                    &path, &omode, &codec) &&
+        tc_Codec_FromObject(codec, &self->codec) == 0) {
       if (path && omode) {
         bool result;
         Py_BEGIN_ALLOW_THREADS
@@ -150,58 +175,124 @@ static PyObject *tc_BDB_ecode(tc_BDB *self) {
 
 TC_BOOL_NOARGS(tc_BDB_setmutex,tc_BDB,tcbdbsetmutex,bdb,tc_Error_SetBDB,bdb);
 
+/* Calls the Python comparator. tc calls this with or without the GIL, and
+   can't take errors, so they are reported as unraisable and the keys are
+   taken as equal. */
 static int TCBDB_cmpfunc(const char *aptr, int asiz,
               const char *bptr, int bsiz, tc_BDB *self)
 {
   log_trace("ENTER");
   int ret = 0;
-  PyObject *args, *result;
+  PyObject *args, *result = NULL;
   PyGILState_STATE gstate;
 
+  gstate = PyGILState_Ensure();
   if ((args = Py_BuildValue("(s#s#O)", aptr, asiz, bptr, bsiz, self->cmpop))) {
-    /* TODO: set error */
-    return 0;
+    result = PyEval_CallObject(self->cmp, args);
+    Py_DECREF(args);
   }
-  gstate = PyGILState_Ensure();
-  result = PyEval_CallObject(self->cmp, args);
-  Py_DECREF(args);
-  if (!result) {
-    /* TODO: set error */
-    goto exit;
+  if (result) {
+    /* only the sign matters; casting to int would truncate a long such as
+       1 << 32 to 0 */
+    long value = PyLong_AsLong(result);
+    if (value == -1 && PyErr_Occurred() &&
+        PyErr_ExceptionMatches(PyExc_OverflowError)) {
+      PyObject *zero = PyLong_FromLong(0);
+      PyErr_Clear();
+      if (zero) {
+        int lt = PyObject_RichCompareBool(result, zero, Py_LT);
+        value = (lt > 0) ? -1 : 1;
+        Py_DECREF(zero);
+      }
+    }
+    ret = (value > 0) - (value < 0);
+    Py_DECREF(result);
+  }
+  if (PyErr_Occurred()) {
+    PyErr_WriteUnraisable(self->cmp);
+    ret = 0;
   }
-  ret = PyLong_AsLong(result);
-  Py_DECREF(result);
-exit:
   PyGILState_Release(gstate);
   return ret;
 }
 
+static int TCBDB_cmpreverse(const char *aptr, int asiz,
+              const char *bptr, int bsiz, tc_BDB *self)
+{
+  return self->cmpfn(bptr, bsiz, aptr, asiz, self->cmpfnop);
+}
+
+#if (PY_VERSION_HEX >= 0x02070000)
+  #define TC_HAVE_CAPSULE
+#endif
+
+static PyObject *_cmp_capsule(BDBCMP cmp) {
+#ifdef TC_HAVE_CAPSULE
+  return PyCapsule_New((void *)cmp, TC_BDBCMP_CAPSULE, NULL);
+#else
+  return PyCObject_FromVoidPtr((void *)cmp, NULL);
+#endif
+}
+
+/* Get the comparator and its cmpop out of a capsule. Returns false if obj
+   isn't one. */
+static bool _cmp_from_capsule(PyObject *obj, BDBCMP *cmp, void **op) {
+#ifdef TC_HAVE_CAPSULE
+  if (PyCapsule_IsValid(obj, TC_BDBCMP_CAPSULE)) {
+    *cmp = (BDBCMP)PyCapsule_GetPointer(obj, TC_BDBCMP_CAPSULE);
+    *op = PyCapsule_GetContext(obj);
+    return true;
+  }
+#else
+  if (PyCObject_Check(obj)) {
+    *cmp = (BDBCMP)PyCObject_AsVoidPtr(obj);
+    *op = PyCObject_GetDesc(obj);
+    return true;
+  }
+#endif
+  return false;
+}
+
+/* cmp is a Python callable, called with two keys and cmpop, or a native
+   comparator such as tc.cmpint64. With reverse, the order is inverted. */
 static PyObject *tc_BDB_setcmpfunc(tc_BDB *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
   bool result;
-  PyObject *cmp, *cmpop = NULL;
-  static char *kwlist[] = {"cmp", "cmpop", NULL};
-
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|O:setcmpfunc", kwlist,
-                                   &cmp, &cmpop)
-      || !PyCallable_Check(cmp)) {
+  PyObject *cmp, *cmpop = Py_None;
+  BDBCMP cmpfn;
+  void *cmpfnop;
+  int reverse = 0;
+  static char *kwlist[] = {"cmp", "cmpop", "reverse", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|Oi:setcmpfunc", kwlist,
+                                   &cmp, &cmpop, &reverse)) {
     return NULL;
   }
-  if (!cmpop) {
-    Py_INCREF(Py_None);
-    cmpop = Py_None;
+  if (_cmp_from_capsule(cmp, &cmpfn, &cmpfnop)) {
+    /* runs without the GIL */
+  } else if (PyCallable_Check(cmp)) {
+    cmpfn = (BDBCMP)TCBDB_cmpfunc;
+    cmpfnop = self;
+  } else {
+    PyErr_SetString(PyExc_TypeError, "cmp must be callable or a native comparator");
+    return NULL;
   }
 
   Py_INCREF(cmp);
-  Py_XINCREF(cmpop);
+  Py_INCREF(cmpop);
   Py_XDECREF(self->cmp);
   Py_XDECREF(self->cmpop);
   self->cmp = cmp;
   self->cmpop = cmpop;
+  self->cmpfn = cmpfn;
+  self->cmpfnop = cmpfnop;
 
   Py_BEGIN_ALLOW_THREADS
-  result = tcbdbsetcmpfunc(self->bdb,
-                           (BDBCMP)TCBDB_cmpfunc, self);
+  if (reverse) {
+    result = tcbdbsetcmpfunc(self->bdb, (BDBCMP)TCBDB_cmpreverse, self);
+  } else {
+    result = tcbdbsetcmpfunc(self->bdb, cmpfn, cmpfnop);
+  }
   Py_END_ALLOW_THREADS
 
   if (!result) {
@@ -237,12 +328,37 @@ static PyObject *tc_BDB_setcache(tc_BDB *self, PyObject *args, PyObject *keywds)
   Py_RETURN_NONE;
 }
 
+TC_BOOL_LONG_LONG_ARG(tc_BDB_setxmsiz,tc_BDB,setxmsiz,xmsiz,tcbdbsetxmsiz,bdb,tc_Error_SetBDB);
+TC_BOOL_INT_ARG(tc_BDB_setdfunit,tc_BDB,setdfunit,dfunit,tcbdbsetdfunit,bdb,tc_Error_SetBDB);
+TC_XDB_defrag(tc_BDB_defrag,tc_BDB,tcbdbdefrag,bdb,tc_Error_SetBDB);
+
+static PyObject *tc_BDB_tuning(tc_BDB *self) {
+  log_trace("ENTER");
+  PyObject *dict;
+  TCBDB *bdb = self->bdb;
+
+  /* records of the underlying hash database are pages, not cached */
+  if (!(dict = tc_HDB_Tuning(bdb->hdb)) ||
+      PyDict_DelItemString(dict, "rcnum") ||
+      tc_Dict_SetLongLong(dict, "lmemb", bdb->lmemb) ||
+      tc_Dict_SetLongLong(dict, "nmemb", bdb->nmemb) ||
+      tc_Dict_SetLongLong(dict, "opts", bdb->opts) ||
+      tc_Dict_SetLongLong(dict, "lcnum", bdb->lcnum) ||
+      tc_Dict_SetLongLong(dict, "ncnum", bdb->ncnum)) {
+    Py_XDECREF(dict);
+    return NULL;
+  }
+  return dict;
+}
+
 TC_XDB_OPEN(tc_BDB_open,tc_BDB,tc_BDB_new,tcbdbopen,bdb,tc_BDB_dealloc,tc_Error_SetBDB);
 TC_BOOL_NOARGS(tc_BDB_close,tc_BDB,tcbdbclose,bdb,tc_Error_SetBDB,bdb);
-TC_XDB_PUT(tc_BDB_put, tc_BDB, put, tcbdbput, bdb, tc_Error_SetBDB);
-TC_XDB_PUT(tc_BDB_putkeep, tc_BDB, putkeep, tcbdbputkeep, bdb, tc_Error_SetBDB);
-TC_XDB_PUT(tc_BDB_putcat, tc_BDB, putcat, tcbdbputcat, bdb, tc_Error_SetBDB);
-TC_XDB_PUT(tc_BDB_putdup, tc_BDB, putdup, tcbdbputdup, bdb, tc_Error_SetBDB);
+TC_XDB_PUT(tc_BDB_put, tc_BDB, put, tcbdbput, bdb, tc_Error_SetBDB, false);
+TC_XDB_PUT(tc_BDB_putkeep, tc_BDB, putkeep, tcbdbputkeep, bdb, tc_Error_SetBDB, false);
+TC_XDB_PUT(tc_BDB_putcat, tc_BDB, putcat, tcbdbputcat, bdb, tc_Error_SetBDB, true);
+TC_XDB_PUT(tc_BDB_putdup, tc_BDB, putdup, tcbdbputdup, bdb, tc_Error_SetBDB, false);
+TC_XDB_putmany(tc_BDB_putmany, tc_BDB, putmany, tcbdbput, tcbdbputkeep, tcbdbputcat,
+               tcbdbtranbegin, tcbdbtrancommit, tcbdbtranabort, tcbdbecode, bdb, tc_Error_SetBDB);
 
 static PyObject *tc_BDB_putlist(tc_BDB *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
@@ -251,6 +367,7 @@ static PyObject *tc_BDB_putlist(tc_BDB *self, PyObject *args, PyObject *keywds)
   TCLIST *tcvalue;
   PyObject *value;
   int key_len, value_size, i;
+  tc_StatsTimer timer;
   static char *kwlist[] = {"key", "value", NULL};
 
   if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#O!:putlist", kwlist,
@@ -261,14 +378,19 @@ static PyObject *tc_BDB_putlist(tc_BDB *self, PyObject *args, PyObject *keywds)
 
   value_size = PyList_Size(value);
   for (i = 0; i < value_size; i++) {
-    PyObject *v = PyList_GetItem(value, i);
-    if (PyBytes_Check(v)) {
-      tclistpush(tcvalue, PyBytes_AsString(v), PyBytes_Size(v));
+    tc_buffer_t v;
+    if (tc_Codec_Buffer(self->codec, PyList_GET_ITEM(value, i), &v, "values") != 0) {
+      tclistdel(tcvalue);
+      return NULL;
     }
+    tclistpush(tcvalue, TC_BUFFER_BUF(v), TC_BUFFER_LEN(v));
+    TC_BUFFER_RELEASE(v);
   }
   Py_BEGIN_ALLOW_THREADS
-  result = tcbdbputdup3(self->bdb, key, key_len, tcvalue);
+  TC_STATS_CALL(timer, result = tcbdbputdup3(self->bdb, key, key_len, tcvalue));
   Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_PUT, &timer, key_len + _tclist_size(tcvalue), 0,
+                  result);
   tclistdel(tcvalue);
 
   if (!result) {
@@ -278,15 +400,72 @@ static PyObject *tc_BDB_putlist(tc_BDB *self, PyObject *args, PyObject *keywds)
   Py_RETURN_NONE;
 }
 
-TC_BOOL_KEYARGS(tc_BDB_out,tc_BDB,out,tcbdbout,bdb,tc_Error_SetBDB,bdb);
-TC_BOOL_KEYARGS(tc_BDB_outlist,tc_BDB,outlist,tcbdbout3,bdb,tc_Error_SetBDB,bdb);
-TC_STRINGL_KEYARGS(tc_BDB_get,tc_BDB,get,tcbdbget,bdb,tc_Error_SetBDB);
+TC_BOOL_KEYARGS(tc_BDB_out,tc_BDB,out,tcbdbout,bdb,tc_Error_SetBDB,bdb,TC_OP_OUT);
+TC_BOOL_KEYARGS(tc_BDB_outlist,tc_BDB,outlist,tcbdbout3,bdb,tc_Error_SetBDB,bdb,TC_OP_OUT);
+TC_STRINGL_KEYARGS(tc_BDB_get,tc_BDB,get,tcbdbget,bdb,tc_Error_SetBDB,TC_OP_GET);
+
+/* Read the value of a record straight into a writable buffer, skipping the
+   intermediate bytes object. Returns the size of the value. */
+static PyObject *tc_BDB_get_into(tc_BDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key, *copy = NULL;
+  const char *value;
+  int key_len, value_len, max;
+  tc_buffer_t buffer;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"key", "buffer", NULL};
+
+  /* an encoded value in the buffer would be of no use */
+  if (self->codec != TC_CODEC_RAW) {
+    PyErr_SetString(PyExc_ValueError, "get_into can't be used with a codec");
+    return NULL;
+  }
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#" TC_WBUFFER_FMT ":get_into", kwlist,
+                                   &key, &key_len, TC_BUFFER_ARGS(buffer)) ||
+      tc_Buffer_Check(&buffer) != 0) {
+    return NULL;
+  }
+  max = TC_BUFFER_LEN(buffer);
+  Py_BEGIN_ALLOW_THREADS
+  /* tcbdbget3 points into the leaf cache, which other threads may change
+     as soon as it returns when the database is shared */
+  timer.begin = tc_Stats_now();
+  if (self->bdb->mmtx) {
+    value = copy = tcbdbget(self->bdb, key, key_len, &value_len);
+  } else {
+    value = tcbdbget3(self->bdb, key, key_len, &value_len);
+  }
+  if (value && value_len <= max) {
+    memcpy(TC_BUFFER_BUF(buffer), value, value_len);
+  }
+  timer.end = tc_Stats_now();
+  Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(buffer);
+  tc_Stats_record(self->stats, TC_OP_GET, &timer, key_len, value ? value_len : 0,
+                  value != NULL);
+  if (copy) {
+    free(copy);
+  }
+
+  if (!value) {
+    tc_Error_SetBDB(self->bdb);
+    return NULL;
+  }
+  if (value_len > max) {
+    PyErr_Format(PyExc_ValueError, "buffer too small for a value of %d bytes", value_len);
+    return NULL;
+  }
+  return NUMBER_FromLong((long)value_len);
+}
+
+TC_XDB_getmany(tc_BDB_getmany,tc_BDB,getmany,tcbdbget,tcbdbecode,bdb,tc_Error_SetBDB);
 
 static PyObject *tc_BDB_getlist(tc_BDB *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
   char *key;
   int key_len;
   TCLIST *list;
+  tc_StatsTimer timer;
   static char *kwlist[] = {"key", NULL};
 
   if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:getlist", kwlist,
@@ -294,10 +473,12 @@ static PyObject *tc_BDB_getlist(tc_BDB *self, PyObject *args, PyObject *keywds)
     return NULL;
   }
   Py_BEGIN_ALLOW_THREADS
-  list = tcbdbget4(self->bdb, key, key_len);
+  TC_STATS_CALL(timer, list = tcbdbget4(self->bdb, key, key_len));
   Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_GET, &timer, key_len, list ? _tclist_size(list) : 0,
+                  list != NULL);
 
-  TCLIST2PyList()
+  TCLIST2PyList(self->codec)
 }
 
 TC_INT_KEYARGS(tc_BDB_vnum,tc_BDB,vnum,tcbdbvnum,bdb,tc_Error_SetBDB);
@@ -306,9 +487,13 @@ TC_BOOL_NOARGS(tc_BDB_sync,tc_BDB,tcbdbsync,bdb,tc_Error_SetBDB,bdb);
 tc_BDB_TUNE_OR_OPT(tc_BDB_optimize, optimize, tcbdboptimize);
 TC_BOOL_PATHARGS(tc_BDB_copy, tc_BDB, copy, tcbdbcopy, bdb, tc_Error_SetBDB);
 TC_BOOL_NOARGS(tc_BDB_vanish,tc_BDB,tcbdbvanish,bdb,tc_Error_SetBDB,bdb);
-TC_BOOL_NOARGS(tc_BDB_tranbegin,tc_BDB,tcbdbtranbegin,bdb,tc_Error_SetBDB,bdb);
-TC_BOOL_NOARGS(tc_BDB_trancommit,tc_BDB,tcbdbtrancommit,bdb,tc_Error_SetBDB,bdb);
-TC_BOOL_NOARGS(tc_BDB_tranabort,tc_BDB,tcbdbtranabort,bdb,tc_Error_SetBDB,bdb);
+TC_XDB_tran(tc_BDB_tranbegin,tc_BDB,tcbdbtranbegin,bdb,tc_Error_SetBDB,true);
+TC_XDB_tran(tc_BDB_trancommit,tc_BDB,tcbdbtrancommit,bdb,tc_Error_SetBDB,false);
+TC_XDB_tran(tc_BDB_tranabort,tc_BDB,tcbdbtranabort,bdb,tc_Error_SetBDB,false);
+TC_XDB_transaction(tc_BDB_transaction,tc_BDB);
+TC_XDB_stats(tc_BDB_stats,tc_BDB);
+TC_XDB_prometheus(tc_BDB_prometheus,tc_BDB);
+TC_XDB_setcodec(tc_BDB_setcodec,tc_BDB);
 TC_STRING_NOARGS(tc_BDB_path,tc_BDB,tcbdbpath,bdb,tc_Error_SetBDB);
 TC_U_LONG_LONG_NOARGS(tc_BDB_rnum, tc_BDB, tcbdbrnum, bdb, tcbdbecode, tc_Error_SetBDB);
 TC_U_LONG_LONG_NOARGS(tc_BDB_fsiz, tc_BDB, tcbdbrnum, bdb, tcbdbecode, tc_Error_SetBDB);
@@ -330,7 +515,7 @@ static PyObject *tc_BDB_range(tc_BDB *self, PyObject *args, PyObject *keywds) {
                                ekey, ekey_len, einc, max);
   Py_END_ALLOW_THREADS
 
-  TCLIST2PyList()
+  TCLIST2PyList(TC_CODEC_RAW)
 }
 
 static PyObject *tc_BDB_rangefwm(tc_BDB *self, PyObject *args, PyObject *keywds) {
@@ -348,7 +533,7 @@ static PyObject *tc_BDB_rangefwm(tc_BDB *self, PyObject *args, PyObject *keywds)
   list = tcbdbrange3(self->bdb, prefix, max);
   Py_END_ALLOW_THREADS
 
-  TCLIST2PyList()
+  TCLIST2PyList(TC_CODEC_RAW)
 }
 
 /* TODO: features for experts */
@@ -357,31 +542,45 @@ TC_XDB_Contains(tc_BDB_Contains,tc_BDB,tcbdbvsiz,bdb);
 TC_XDB___contains__(tc_BDB___contains__,tc_BDB,tc_BDB_Contains);
 TC_XDB___getitem__(tc_BDB___getitem__,tc_BDB,tcbdbget,bdb,tc_Error_SetBDB);
 
-static PyObject *tc_BDB_curnew(tc_BDB *self) {
-  log_trace("ENTER");
+static tc_BDBCursor *_curnew(tc_BDB *self, int prefetch) {
   tc_BDBCursor *cur;
   PyObject *args;
   
-  args = Py_BuildValue("(O)", self);
+  if (!(args = Py_BuildValue("(Oi)", self, prefetch))) {
+    return NULL;
+  }
   cur = (tc_BDBCursor *)tc_BDBCursor_new(&tc_BDBCursorType, args, NULL);
   Py_DECREF(args);
+  return cur;
+}
 
-  if (cur) {
-    return (PyObject *)cur;
+static PyObject *tc_BDB_curnew(tc_BDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  int prefetch = 0;
+  static char *kwlist[] = {"prefetch", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|i:curnew", kwlist, &prefetch)) {
+    return NULL;
   }
-  tc_Error_SetBDB(self->bdb);
-  return NULL;
+  return (PyObject *)_curnew(self, prefetch);
 }
 
 static PyObject *tc_BDB_GetIter(tc_BDB *self, tc_itertype_t itype) {
   log_trace("ENTER");
   tc_BDBCursor *cur;
-  if ((cur = (tc_BDBCursor *)tc_BDB_curnew(self))) {
+  PyObject *result;
+  if ((cur = _curnew(self, TC_ITER_PREFETCH))) {
     cur->itype = itype;
-    if (tc_BDBCursor_first(cur)) {
+    if ((result = tc_BDBCursor_first(cur))) {
+      Py_DECREF(result);
+      return (PyObject *)cur;
+    }
+    /* an empty database iterates over nothing */
+    if (tcbdbecode(self->bdb) == TCENOREC) {
+      PyErr_Clear();
       return (PyObject *)cur;
     }
-    tc_BDBCursor_dealloc(cur);
+    Py_DECREF(cur);
   }
   return NULL;
 }
@@ -417,10 +616,12 @@ static PyObject *tc_BDB_keys(tc_BDB *self) {
     char *key;
     int key_len;
     PyObject *_key;
+    tc_StatsTimer timer;
 
     Py_BEGIN_ALLOW_THREADS
-    key = tcbdbcurkey(cur, &key_len);
+    TC_STATS_CALL(timer, key = tcbdbcurkey(cur, &key_len));
     Py_END_ALLOW_THREADS
+    tc_Stats_record(self->stats, TC_OP_ITER, &timer, 0, key ? key_len : 0, key != NULL);
 
     if (!key) { break; }
     _key = PyBytes_FromStringAndSize(key, key_len);
@@ -471,13 +672,16 @@ static PyObject *tc_BDB_items(tc_BDB *self) {
   return NULL;
 main:
   for (i = 0; result; i++) {
+    tc_StatsTimer timer;
     Py_BEGIN_ALLOW_THREADS
-    result = tcbdbcurrec(cur, key, value);
+    TC_STATS_CALL(timer, result = tcbdbcurrec(cur, key, value));
     Py_END_ALLOW_THREADS
+    tc_Stats_record(self->stats, TC_OP_ITER, &timer, 0,
+                    tcxstrsize(key) + tcxstrsize(value), result);
     if (result) {
       PyObject *tuple;
-      tuple = Py_BuildValue("(s#s#)", tcxstrptr(key), tcxstrsize(key),
-                                      tcxstrptr(value), tcxstrsize(value));
+      tuple = Py_BuildValue("(s#N)", tcxstrptr(key), tcxstrsize(key),
+                            tc_Codec_Value(self->codec, tcxstrptr(value), tcxstrsize(value)));
       if (tuple) {
         PyList_SET_ITEM(ret, i, tuple);
         Py_BEGIN_ALLOW_THREADS
@@ -486,6 +690,7 @@ main:
         tcxstrclear(key);
         tcxstrclear(value);
       } else {
+        Py_CLEAR(ret);
         break;
       }
     }
@@ -523,13 +728,16 @@ static PyObject *tc_BDB_values(tc_BDB *self) {
     char *value;
     int value_len;
     PyObject *_value;
+    tc_StatsTimer timer;
 
     Py_BEGIN_ALLOW_THREADS
-    value = tcbdbcurval(cur, &value_len);
+    TC_STATS_CALL(timer, value = tcbdbcurval(cur, &value_len));
     Py_END_ALLOW_THREADS
+    tc_Stats_record(self->stats, TC_OP_ITER, &timer, 0, value ? value_len : 0,
+                    value != NULL);
 
     if (!value) { break; }
-    _value = PyBytes_FromStringAndSize(value, value_len);
+    _value = tc_Codec_Value(self->codec, value, value_len);
     free(value);
     if (!_value) {
       Py_DECREF(ret);
@@ -561,12 +769,22 @@ static PyMethodDef tc_BDB_methods[] = {
     "Get the last happened error code of a B+ tree database object."},
   {"setcmpfunc", (PyCFunction)tc_BDB_setcmpfunc, METH_VARARGS | METH_KEYWORDS,
     "Set the custom comparison function of a B+ tree database object."},
+  {"setcodec", (PyCFunction)tc_BDB_setcodec, METH_VARARGS | METH_KEYWORDS,
+    "Set the codec of the values of a B+ tree database object, None or 'raw' for bytes, 'tc' for Python objects."},
   {"setmutex", (PyCFunction)tc_BDB_setmutex, METH_NOARGS,
     "Set mutual exclusion control of a B+ tree database object for threading."},
   {"tune", (PyCFunction)tc_BDB_tune, METH_VARARGS | METH_KEYWORDS,
     "Set the tuning parameters of a B+ tree database object."},
   {"setcache", (PyCFunction)tc_BDB_setcache, METH_VARARGS | METH_KEYWORDS,
     "Set the caching parameters of a B+ tree database object."},
+  {"setxmsiz", (PyCFunction)tc_BDB_setxmsiz, METH_VARARGS | METH_KEYWORDS,
+    "Set the size of the extra mapped memory of a B+ tree database object."},
+  {"setdfunit", (PyCFunction)tc_BDB_setdfunit, METH_VARARGS | METH_KEYWORDS,
+    "Set the unit step number of auto defragmentation of a B+ tree database object."},
+  {"defrag", (PyCFunction)tc_BDB_defrag, METH_VARARGS | METH_KEYWORDS,
+    "Defragment step records of a B+ tree database object, or the whole file if step is 0."},
+  {"tuning", (PyCFunction)tc_BDB_tuning, METH_NOARGS,
+    "Get a dict of the tuning and cache parameters in effect of a B+ tree database object."},
   {"open", (PyCFunction)tc_BDB_open, METH_VARARGS | METH_KEYWORDS,
     "Open a database file and connect a B+ tree database object."},
   {"close", (PyCFunction)tc_BDB_close, METH_NOARGS,
@@ -581,6 +799,9 @@ static PyMethodDef tc_BDB_methods[] = {
     "Store a record into a B+ tree database object with allowing duplication of keys."},
   {"putlist", (PyCFunction)tc_BDB_putlist, METH_VARARGS | METH_KEYWORDS,
     "Store records into a B+ tree database object with allowing duplication of keys."},
+  {"putmany", (PyCFunction)tc_BDB_putmany, METH_VARARGS | METH_KEYWORDS,
+    "Store records from a mapping or from (key, value) pairs into a B+ tree database object.\n"
+   "mode is 'put', 'keep' or 'cat'. Returns the number of records stored."},
   {"out", (PyCFunction)tc_BDB_out, METH_VARARGS | METH_KEYWORDS,
     "Remove a record of a B+ tree database object."},
   {"outlist", (PyCFunction)tc_BDB_outlist, METH_VARARGS | METH_KEYWORDS,
@@ -588,6 +809,12 @@ static PyMethodDef tc_BDB_methods[] = {
   {"get", (PyCFunction)tc_BDB_get, METH_VARARGS | METH_KEYWORDS,
     "Retrieve a record in a B+ tree database object.\n"
    "If the key of duplicated records is specified, the value of the first record is selected."},
+  {"get_into", (PyCFunction)tc_BDB_get_into, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record in a B+ tree database object into a writable buffer.\n"
+   "Returns the size of the value. ValueError is raised if the buffer is too small."},
+  {"getmany", (PyCFunction)tc_BDB_getmany, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve the records of several keys in a B+ tree database object.\n"
+   "Returns a list of values in the order of the keys, missing records being replaced by default."},
   {"getlist", (PyCFunction)tc_BDB_getlist, METH_VARARGS | METH_KEYWORDS,
     "Retrieve records in a B+ tree database object."},
   {"vnum", (PyCFunction)tc_BDB_vnum, METH_VARARGS | METH_KEYWORDS,
@@ -608,14 +835,21 @@ static PyMethodDef tc_BDB_methods[] = {
     "Commit the transaction of a B+ tree database object."},
   {"tranabort", (PyCFunction)tc_BDB_tranabort, METH_NOARGS,
     "Abort the transaction of a B+ tree database object."},
+  {"transaction", (PyCFunction)tc_BDB_transaction, METH_NOARGS,
+    "Get a context manager running a block in a transaction of a B+ tree database object."},
+  {"stats", (PyCFunction)tc_BDB_stats, METH_VARARGS | METH_KEYWORDS,
+    "Get a dict of the operation counters and latencies of a B+ tree database object."},
+  {"prometheus", (PyCFunction)tc_BDB_prometheus, METH_VARARGS | METH_KEYWORDS,
+    "Dump the operation counters and latencies of a B+ tree database object in the Prometheus text format."},
   {"path", (PyCFunction)tc_BDB_path, METH_NOARGS,
     "Get the file path of a B+ tree database object."},
   {"rnum", (PyCFunction)tc_BDB_rnum, METH_NOARGS,
     "Get the number of records of a B+ tree database object."},
   {"fsiz", (PyCFunction)tc_BDB_fsiz, METH_NOARGS,
     "Get the size of the database file of a B+ tree database object."},
-  {"curnew", (PyCFunction)tc_BDB_curnew, METH_NOARGS,
-    "Create a cursor object."},
+  {"curnew", (PyCFunction)tc_BDB_curnew, METH_VARARGS | METH_KEYWORDS,
+    "Create a cursor object.\n"
+   "With prefetch, iterating over the cursor reads that many records at a time."},
   {"range", (PyCFunction)tc_BDB_range, METH_VARARGS | METH_KEYWORDS,
     NULL},
   {"rangefwm", (PyCFunction)tc_BDB_rangefwm, METH_VARARGS | METH_KEYWORDS,
@@ -715,7 +949,16 @@ PyTypeObject tc_BDBType = {
 
 int tc_BDB_register(PyObject *module) {
   log_trace("ENTER");
-  if (PyType_Ready(&tc_BDBType) == 0)
-    return PyModule_AddObject(module, "BDB", (PyObject *)&tc_BDBType);
-  return -1;
+  if (PyType_Ready(&tc_BDBType) != 0 ||
+      PyModule_AddObject(module, "BDB", (PyObject *)&tc_BDBType) != 0) {
+    return -1;
+  }
+  /* native comparators for setcmpfunc */
+  if (PyModule_AddObject(module, "cmplexical", _cmp_capsule((BDBCMP)tccmplexical)) != 0 ||
+      PyModule_AddObject(module, "cmpdecimal", _cmp_capsule((BDBCMP)tccmpdecimal)) != 0 ||
+      PyModule_AddObject(module, "cmpint32", _cmp_capsule((BDBCMP)tccmpint32)) != 0 ||
+      PyModule_AddObject(module, "cmpint64", _cmp_capsule((BDBCMP)tccmpint64)) != 0) {
+    return -1;
+  }
+  return 0;
 }
@@ -3,12 +3,25 @@
 
 #include "_base.h"
 #include <tcbdb.h>
+#include "Stats.h"
+#include "Codec.h"
+
+/* Native comparators are handed around as capsules of this name holding a
+   BDBCMP, with the capsule context passed to it as cmpop. tc.cmplexical,
+   tc.cmpdecimal, tc.cmpint32 and tc.cmpint64 are such capsules; extension
+   modules can create their own and pass them to BDB.setcmpfunc. */
+#define TC_BDBCMP_CAPSULE "tc.BDBCMP"
 
 typedef struct {
   PyObject_HEAD
   TCBDB	*bdb;
   PyObject *cmp;
   PyObject *cmpop;
+  BDBCMP cmpfn;     /* comparator wrapped to reverse the order */
+  void *cmpfnop;
+  tc_Stats *stats;
+  tc_codec_t codec;             /* encoding of values */
+  bool intran;                  /* a transaction was begun by tranbegin() */
 } tc_BDB;
 
 extern PyTypeObject tc_BDBType;
@@ -3,52 +3,202 @@
 
 /* Private --------------------------------------------------------------- */
 
+/* Copy records from the cursor position into the buffer, moving the cursor
+   past each of them, until the buffer is full or the cursor runs off the
+   end. Called without the GIL. Returns false on errors other than running
+   off the end. */
+static bool _fill(tc_BDBCursor *self) {
+  TCBDB *bdb = self->bdb->bdb;
+  const void *kbuf, *vbuf = NULL;
+  int ksiz, vsiz = 0;
+
+  tc_RecBuf_clear(self->buf);
+  self->atend = true;
+  while (!tc_RecBuf_full(self->buf)) {
+    if (bdb->mmtx) {
+      /* pointers into the leaf cache are not stable when the database is
+         shared between threads, so copy under tc's lock */
+      if (!tcbdbcurrec(self->cur, self->kxstr, self->vxstr)) {
+        return tcbdbecode(bdb) == TCENOREC;
+      }
+      kbuf = tcxstrptr(self->kxstr);
+      ksiz = tcxstrsize(self->kxstr);
+      vbuf = tcxstrptr(self->vxstr);
+      vsiz = tcxstrsize(self->vxstr);
+    } else {
+      if (!(kbuf = tcbdbcurkey3(self->cur, &ksiz)) ||
+          (self->itype != tc_iter_key_t && !(vbuf = tcbdbcurval3(self->cur, &vsiz)))) {
+        return tcbdbecode(bdb) == TCENOREC;
+      }
+    }
+    tc_RecBuf_push(self->buf, kbuf, ksiz, vbuf, vsiz);
+    if (!tcbdbcurnext(self->cur)) {
+      return tcbdbecode(bdb) == TCENOREC;
+    }
+  }
+  self->atend = false;
+  return true;
+}
+
+/* Move the cursor back to the first record not yet handed out by the
+   iteration, so that it points where it would without prefetching. The
+   cursor steps back over the records read ahead rather than jumping to
+   the key, which would land on the first of its duplicates. If the
+   record it arrives at is not the one that was read, the database was
+   changed in between and RuntimeError is raised rather than reading or
+   changing another record. */
+static bool _sync(tc_BDBCursor *self) {
+  tc_RecBuf *buf = self->buf;
+  const char *base = (const char *)tcxstrptr(buf->arena);
+  bool result = true, same = true;
+
+  if (buf->pos < buf->num) {
+    int i = buf->pos, back = buf->num - buf->pos;
+    Py_BEGIN_ALLOW_THREADS
+    if (self->atend) {
+      result = tcbdbcurlast(self->cur);
+      back--;
+    }
+    while (result && back-- > 0) {
+      result = tcbdbcurprev(self->cur);
+    }
+    if (result && (result = tcbdbcurrec(self->cur, self->kxstr, self->vxstr))) {
+      same = tcxstrsize(self->kxstr) == buf->ksizs[i] &&
+             !memcmp(tcxstrptr(self->kxstr), base + buf->koffs[i], buf->ksizs[i]);
+      if (same && self->itype != tc_iter_key_t) {
+        same = tcxstrsize(self->vxstr) == buf->vsizs[i] &&
+               !memcmp(tcxstrptr(self->vxstr), base + buf->voffs[i], buf->vsizs[i]);
+      }
+    }
+    Py_END_ALLOW_THREADS
+    if (!result) {
+      tc_Error_SetBDB(self->bdb->bdb);
+    } else if (!same) {
+      PyErr_SetString(PyExc_RuntimeError,
+                      "the database was changed while the cursor read ahead");
+      result = false;
+    }
+  }
+  tc_RecBuf_clear(buf);
+  return result;
+}
+
 /* Public --------------------------------------------------------------- */
 
 PyObject *tc_BDBCursor_new(PyTypeObject *type, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
   tc_BDB *bdb;
   tc_BDBCursor *self;
-  static char *kwlist[] = {"bdb", NULL};
+  int prefetch = 0;
+  static char *kwlist[] = {"bdb", "prefetch", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!:new", kwlist,
-                                   &tc_BDBType, &bdb)) {
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!|i:new", kwlist,
+                                   &tc_BDBType, &bdb, &prefetch)) {
     return NULL;
   }
   if (!(self = (tc_BDBCursor *)type->tp_alloc(type, 0))) {
     PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_BDBCursor instance");
     return NULL;
   }
+  Py_INCREF(bdb);
+  self->bdb = bdb;
+
+  /* without prefetching, a single record goes through the buffer */
+  if (!(self->buf = tc_RecBuf_new(prefetch > 1 ? prefetch : 1, bdb->codec))) {
+    Py_DECREF(self);
+    return NULL;
+  }
+  self->kxstr = tcxstrnew();
+  self->vxstr = tcxstrnew();
 
   Py_BEGIN_ALLOW_THREADS
   self->cur = tcbdbcurnew(bdb->bdb);
   Py_END_ALLOW_THREADS
 
   if (!self->cur) {
-    Py_DECREF(self);
     tc_Error_SetBDB(bdb->bdb);
+    Py_DECREF(self);
     return NULL;
   }
-  Py_INCREF(bdb);
-  self->bdb = bdb;
   return (PyObject *)self;
 }
 
 void tc_BDBCursor_dealloc(tc_BDBCursor *self) {
   log_trace("ENTER");
-  Py_BEGIN_ALLOW_THREADS
-  tcbdbcurdel(self->cur);
-  Py_END_ALLOW_THREADS
+  if (self->cur) {
+    Py_BEGIN_ALLOW_THREADS
+    tcbdbcurdel(self->cur);
+    Py_END_ALLOW_THREADS
+  }
+  if (self->buf) {
+    tc_RecBuf_del(self->buf);
+  }
+  if (self->kxstr) {
+    tcxstrdel(self->kxstr);
+  }
+  if (self->vxstr) {
+    tcxstrdel(self->vxstr);
+  }
   Py_XDECREF(self->bdb);
   PyObject_Del(self);
 }
 
+/* Moving the cursor discards prefetched records */
+#define TC_BDBCursor_MOVE(func,call) \
+  static PyObject * \
+  func(tc_BDBCursor *self) { \
+    bool result; \
+    tc_StatsTimer timer; \
+    tc_RecBuf_clear(self->buf); \
+    Py_BEGIN_ALLOW_THREADS \
+    TC_STATS_CALL(timer, result = call(self->cur)); \
+    Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->bdb->stats, TC_OP_CURSOR, &timer, 0, 0, result); \
+    if (!result) { \
+      tc_Error_SetBDB(self->bdb->bdb); \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
+/* Reading or changing the current record first undoes prefetching */
+#define TC_BDBCursor_SYNCED(func,call) \
+  static PyObject * \
+  func(tc_BDBCursor *self) { \
+    if (!_sync(self)) { \
+      return NULL; \
+    } \
+    return call(self); \
+  }
+
+TC_BDBCursor_MOVE(tc_BDBCursor_first_,tcbdbcurfirst);
+TC_BDBCursor_MOVE(tc_BDBCursor_last,tcbdbcurlast);
+TC_BDBCursor_MOVE(tc_BDBCursor_prev,tcbdbcurprev);
+TC_BDBCursor_MOVE(tc_BDBCursor_next,tcbdbcurnext);
+
 PyObject *tc_BDBCursor_first(tc_BDBCursor *self) {
   log_trace("ENTER");
+  return tc_BDBCursor_first_(self);
+}
+
+static PyObject *tc_BDBCursor_jump(tc_BDBCursor *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
   bool result;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"key", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:jump", kwlist,
+                                   &key, &key_len)) {
+    return NULL;
+  }
+  tc_RecBuf_clear(self->buf);
   Py_BEGIN_ALLOW_THREADS
-  result = tcbdbcurfirst(self->cur);
+  TC_STATS_CALL(timer, result = tcbdbcurjump(self->cur, key, key_len));
   Py_END_ALLOW_THREADS
+  tc_Stats_record(self->bdb->stats, TC_OP_CURSOR, &timer, key_len, 0, result);
+
   if (!result) {
     tc_Error_SetBDB(self->bdb->bdb);
     return NULL;
@@ -56,25 +206,27 @@ PyObject *tc_BDBCursor_first(tc_BDBCursor *self) {
   Py_RETURN_NONE;
 }
 
-TC_BOOL_NOARGS(tc_BDBCursor_last,tc_BDBCursor,tcbdbcurlast,cur,tc_Error_SetBDB,bdb->bdb);
-TC_BOOL_KEYARGS(tc_BDBCursor_jump,tc_BDBCursor,jump,tcbdbcurjump,cur,tc_Error_SetBDB,bdb->bdb);
-TC_BOOL_NOARGS(tc_BDBCursor_prev,tc_BDBCursor,tcbdbcurprev,cur,tc_Error_SetBDB,bdb->bdb);
-TC_BOOL_NOARGS(tc_BDBCursor_next,tc_BDBCursor,tcbdbcurnext,cur,tc_Error_SetBDB,bdb->bdb);
-
 static PyObject *tc_BDBCursor_put(tc_BDBCursor *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
   bool result;
-  char *value;
-  int value_len, cpmode;
+  PyObject *_value;
+  tc_buffer_t value;
+  int cpmode;
   static char *kwlist[] = {"value", "cpmode", NULL};
 
-  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#i:put", kwlist,
-                                   &value, &value_len, &cpmode)) {
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi:put", kwlist,
+                                   &_value, &cpmode) ||
+      tc_Codec_Buffer(self->bdb->codec, _value, &value, "values") != 0) {
+    return NULL;
+  }
+  if (!_sync(self)) {
+    TC_BUFFER_RELEASE(value);
     return NULL;
   }
   Py_BEGIN_ALLOW_THREADS
-  result = tcbdbcurput(self->cur, value, value_len, cpmode);
+  result = tcbdbcurput(self->cur, TC_BUFFER_BUF(value), TC_BUFFER_LEN(value), cpmode);
   Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(value);
 
   if (!result) {
     tc_Error_SetBDB(self->bdb->bdb);
@@ -83,45 +235,68 @@ static PyObject *tc_BDBCursor_put(tc_BDBCursor *self, PyObject *args, PyObject *
   Py_RETURN_NONE;
 }
 
-TC_BOOL_NOARGS(tc_BDBCursor_out,tc_BDBCursor,tcbdbcurout,cur,tc_Error_SetBDB,bdb->bdb);
-TC_STRINGL_NOARGS(tc_BDBCursor_key,tc_BDBCursor,tcbdbcurkey,cur,tc_Error_SetBDB,bdb->bdb);
-TC_STRINGL_NOARGS(tc_BDBCursor_val,tc_BDBCursor,tcbdbcurval,cur,tc_Error_SetBDB,bdb->bdb);
+TC_BOOL_NOARGS(tc_BDBCursor_out_,tc_BDBCursor,tcbdbcurout,cur,tc_Error_SetBDB,bdb->bdb);
+TC_STRINGL_NOARGS(tc_BDBCursor_key_,tc_BDBCursor,tcbdbcurkey,cur,tc_Error_SetBDB,bdb->bdb);
 
-static PyObject *tc_BDBCursor_rec(tc_BDBCursor *self) {
+static PyObject *tc_BDBCursor_val_(tc_BDBCursor *self) {
+  log_trace("ENTER");
+  char *value;
+  int value_len;
+  PyObject *ret;
+
+  Py_BEGIN_ALLOW_THREADS
+  value = tcbdbcurval(self->cur, &value_len);
+  Py_END_ALLOW_THREADS
+
+  if (!value) {
+    tc_Error_SetBDB(self->bdb->bdb);
+    return NULL;
+  }
+  ret = tc_Codec_Value(self->bdb->codec, value, value_len);
+  free(value);
+  return ret;
+}
+
+static PyObject *tc_BDBCursor_rec_(tc_BDBCursor *self) {
   log_trace("ENTER");
   TC_GET_TCXSTR_KEY_VALUE(tcbdbcurrec,self->cur)
   if (result) {
-    ret = Py_BuildValue("(s#s#)", tcxstrptr(key), tcxstrsize(key),
-                                  tcxstrptr(value), tcxstrsize(value));
-  }
-  if (!ret) {
+    ret = Py_BuildValue("(s#N)", tcxstrptr(key), tcxstrsize(key),
+                        tc_Codec_Value(self->bdb->codec, tcxstrptr(value), tcxstrsize(value)));
+  } else {
     tc_Error_SetBDB(self->bdb->bdb);
   }
   TC_CLEAR_TCXSTR_KEY_VALUE()
 }
 
+TC_BDBCursor_SYNCED(tc_BDBCursor_out,tc_BDBCursor_out_);
+TC_BDBCursor_SYNCED(tc_BDBCursor_key,tc_BDBCursor_key_);
+TC_BDBCursor_SYNCED(tc_BDBCursor_val,tc_BDBCursor_val_);
+TC_BDBCursor_SYNCED(tc_BDBCursor_rec,tc_BDBCursor_rec_);
+
+/* Hands out records from the buffer, refilling it with up to `prefetch`
+   records per GIL release */
 static PyObject *tc_BDBCursor_iternext(tc_BDBCursor *self) {
   log_trace("ENTER");
-  /* TODO: performance up */
-  TC_GET_TCXSTR_KEY_VALUE(tcbdbcurrec,self->cur)
-  if (result) {
-    switch (self->itype) {
-      case tc_iter_key_t:
-        ret = PyBytes_FromStringAndSize(tcxstrptr(key), tcxstrsize(key));
-        break;
-      case tc_iter_value_t:
-        ret = PyBytes_FromStringAndSize(tcxstrptr(value), tcxstrsize(value));
-        break;
-      case tc_iter_item_t:
-        ret = Py_BuildValue("(s#s#)", tcxstrptr(key), tcxstrsize(key),
-                                      tcxstrptr(value), tcxstrsize(value));
-        break;
+  tc_RecBuf *buf = self->buf;
+
+  if (buf->pos >= buf->num) {
+    bool result;
+    tc_StatsTimer timer;
+    Py_BEGIN_ALLOW_THREADS
+    TC_STATS_CALL(timer, result = _fill(self));
+    Py_END_ALLOW_THREADS
+    tc_Stats_record(self->bdb->stats, TC_OP_ITER, &timer, 0,
+                    tcxstrsize(buf->arena), result);
+    if (!result) {
+      tc_Error_SetBDB(self->bdb->bdb);
+      return NULL;
+    }
+    if (buf->num == 0) {
+      return NULL;
     }
   }
-  Py_BEGIN_ALLOW_THREADS
-  result = tcbdbcurnext(self->cur);
-  Py_END_ALLOW_THREADS
-  TC_CLEAR_TCXSTR_KEY_VALUE()
+  return tc_RecBuf_get(buf, buf->pos++, self->itype);
 }
 
 static PyMethodDef tc_BDBCursor_methods[] = {
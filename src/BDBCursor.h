@@ -4,12 +4,17 @@
 #include "_base.h"
 #include <tcbdb.h>
 #include "BDB.h"
+#include "util.h"
 
 typedef struct {
   PyObject_HEAD
   tc_BDB *bdb;
   BDBCUR *cur;
   tc_itertype_t itype;
+  tc_RecBuf *buf;   /* records read ahead of the iteration */
+  bool atend;       /* the cursor ran off the end reading ahead */
+  TCXSTR *kxstr;
+  TCXSTR *vxstr;
 } tc_BDBCursor;
 
 extern PyTypeObject tc_BDBCursorType;
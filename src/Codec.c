@@ -0,0 +1,404 @@
+#include "Codec.h"
+#include "util.h"
+
+/* Private --------------------------------------------------------------- */
+
+/* Type tags. Integers are zigzag varints; integers that don't fit in 64
+   bits, bytes and unicode strings (UTF-8) are a varint length followed by
+   their data; containers are a varint count followed by their items, or
+   keys and values for dicts. Floats are 8 bytes IEEE 754, big endian. */
+#define TAG_NONE    'N'
+#define TAG_TRUE    'T'
+#define TAG_FALSE   'F'
+#define TAG_INT     'i'
+#define TAG_BIGINT  'I'
+#define TAG_FLOAT   'd'
+#define TAG_BYTES   'b'
+#define TAG_UNICODE 'u'
+#define TAG_TUPLE   't'
+#define TAG_LIST    'l'
+#define TAG_DICT    'm'
+
+static void _put_tag(TCXSTR *xstr, char tag) {
+  tcxstrcat(xstr, &tag, 1);
+}
+
+static void _put_varint(TCXSTR *xstr, uint64_t n) {
+  unsigned char buf[10];
+  int len = 0;
+
+  while (n >= 0x80) {
+    buf[len++] = (unsigned char)(n | 0x80);
+    n >>= 7;
+  }
+  buf[len++] = (unsigned char)n;
+  tcxstrcat(xstr, buf, len);
+}
+
+static void _put_data(TCXSTR *xstr, char tag, const char *buf, Py_ssize_t size) {
+  _put_tag(xstr, tag);
+  _put_varint(xstr, (uint64_t)size);
+  tcxstrcat(xstr, buf, (int)size);
+}
+
+static int _put_long(TCXSTR *xstr, PyObject *obj) {
+  PY_LONG_LONG n;
+  PyObject *str;
+  int overflow;
+
+  n = PyLong_AsLongLongAndOverflow(obj, &overflow);
+  if (n == -1 && PyErr_Occurred()) {
+    return -1;
+  }
+  if (!overflow) {
+    _put_tag(xstr, TAG_INT);
+    _put_varint(xstr, ((uint64_t)n << 1) ^ (uint64_t)(n >> 63));
+    return 0;
+  }
+  /* rare enough to go through the decimal representation */
+  if (!(str = PyObject_Str(obj))) {
+    return -1;
+  }
+#if (PY_VERSION_HEX < 0x03000000)
+  _put_data(xstr, TAG_BIGINT, PyBytes_AS_STRING(str), PyBytes_GET_SIZE(str));
+#else
+  {
+    Py_ssize_t size;
+    const char *buf = PyUnicode_AsUTF8AndSize(str, &size);
+    if (!buf) {
+      Py_DECREF(str);
+      return -1;
+    }
+    _put_data(xstr, TAG_BIGINT, buf, size);
+  }
+#endif
+  Py_DECREF(str);
+  return 0;
+}
+
+static void _put_double(TCXSTR *xstr, double value) {
+  unsigned char buf[8];
+  uint64_t bits;
+  int i;
+
+  memcpy(&bits, &value, sizeof(bits));
+  for (i = 7; i >= 0; i--) {
+    buf[i] = (unsigned char)bits;
+    bits >>= 8;
+  }
+  tcxstrcat(xstr, buf, sizeof(buf));
+}
+
+static int _encode(TCXSTR *xstr, PyObject *obj);
+
+static int _encode_items(TCXSTR *xstr, char tag, PyObject *seq) {
+  Py_ssize_t i, n = PySequence_Fast_GET_SIZE(seq);
+
+  _put_tag(xstr, tag);
+  _put_varint(xstr, (uint64_t)n);
+  for (i = 0; i < n; i++) {
+    if (_encode(xstr, PySequence_Fast_GET_ITEM(seq, i)) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int _encode(TCXSTR *xstr, PyObject *obj) {
+  int ret = 0;
+
+  if (obj == Py_None) {
+    _put_tag(xstr, TAG_NONE);
+  } else if (PyBool_Check(obj)) {
+    _put_tag(xstr, obj == Py_True ? TAG_TRUE : TAG_FALSE);
+#if (PY_VERSION_HEX < 0x03000000)
+  } else if (PyInt_Check(obj)) {
+    long n = PyInt_AS_LONG(obj);
+    _put_tag(xstr, TAG_INT);
+    _put_varint(xstr, ((uint64_t)(PY_LONG_LONG)n << 1) ^ (uint64_t)((PY_LONG_LONG)n >> 63));
+#endif
+  } else if (PyLong_Check(obj)) {
+    ret = _put_long(xstr, obj);
+  } else if (PyFloat_Check(obj)) {
+    _put_tag(xstr, TAG_FLOAT);
+    _put_double(xstr, PyFloat_AS_DOUBLE(obj));
+  } else if (PyBytes_Check(obj)) {
+    _put_data(xstr, TAG_BYTES, PyBytes_AS_STRING(obj), PyBytes_GET_SIZE(obj));
+  } else if (PyUnicode_Check(obj)) {
+    PyObject *utf8 = PyUnicode_AsUTF8String(obj);
+    if (!utf8) {
+      return -1;
+    }
+    _put_data(xstr, TAG_UNICODE, PyBytes_AS_STRING(utf8), PyBytes_GET_SIZE(utf8));
+    Py_DECREF(utf8);
+  } else if (PyTuple_Check(obj) || PyList_Check(obj) || PyDict_Check(obj)) {
+    if (Py_EnterRecursiveCall(" while encoding a value")) {
+      return -1;
+    }
+    if (PyTuple_Check(obj)) {
+      ret = _encode_items(xstr, TAG_TUPLE, obj);
+    } else if (PyList_Check(obj)) {
+      ret = _encode_items(xstr, TAG_LIST, obj);
+    } else {
+      PyObject *key, *value;
+      Py_ssize_t pos = 0;
+      _put_tag(xstr, TAG_DICT);
+      _put_varint(xstr, (uint64_t)PyDict_Size(obj));
+      while (PyDict_Next(obj, &pos, &key, &value)) {
+        if (_encode(xstr, key) != 0 || _encode(xstr, value) != 0) {
+          ret = -1;
+          break;
+        }
+      }
+    }
+    Py_LeaveRecursiveCall();
+  } else {
+    PyErr_Format(PyExc_TypeError, "cannot encode values of type %.100s",
+                 Py_TYPE(obj)->tp_name);
+    ret = -1;
+  }
+  return ret;
+}
+
+typedef struct {
+  const unsigned char *p;
+  const unsigned char *end;
+} _reader;
+
+static PyObject *_corrupt(void) {
+  PyErr_SetString(PyExc_ValueError, "corrupt encoded value");
+  return NULL;
+}
+
+static bool _get_varint(_reader *r, uint64_t *n) {
+  int shift;
+
+  *n = 0;
+  for (shift = 0; shift < 64 && r->p < r->end; shift += 7) {
+    unsigned char c = *r->p++;
+    *n |= (uint64_t)(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Length of data or number of items, which can't exceed the bytes left
+   since every item takes at least one */
+static bool _get_size(_reader *r, Py_ssize_t *size) {
+  uint64_t n;
+
+  if (!_get_varint(r, &n) || n > (uint64_t)(r->end - r->p)) {
+    return false;
+  }
+  *size = (Py_ssize_t)n;
+  return true;
+}
+
+static PyObject *_decode(_reader *r) {
+  PyObject *ret = NULL, *key, *value;
+  Py_ssize_t size, i;
+  uint64_t n;
+  char tag;
+
+  if (r->p >= r->end) {
+    return _corrupt();
+  }
+  tag = (char)*r->p++;
+  switch (tag) {
+    case TAG_NONE:
+      Py_RETURN_NONE;
+    case TAG_TRUE:
+      Py_RETURN_TRUE;
+    case TAG_FALSE:
+      Py_RETURN_FALSE;
+    case TAG_INT: {
+      PY_LONG_LONG v;
+      if (!_get_varint(r, &n)) {
+        return _corrupt();
+      }
+      v = (PY_LONG_LONG)(n >> 1) ^ -(PY_LONG_LONG)(n & 1);
+      if (v >= LONG_MIN && v <= LONG_MAX) {
+        return NUMBER_FromLong((long)v);
+      }
+      return PyLong_FromLongLong(v);
+    }
+    case TAG_BIGINT: {
+      char *str;
+      if (!_get_size(r, &size)) {
+        return _corrupt();
+      }
+      if (!(str = PyMem_Malloc(size + 1))) {
+        return PyErr_NoMemory();
+      }
+      memcpy(str, r->p, size);
+      str[size] = '\0';
+      r->p += size;
+      ret = PyLong_FromString(str, NULL, 10);
+      PyMem_Free(str);
+      return ret;
+    }
+    case TAG_FLOAT: {
+      uint64_t bits = 0;
+      double d;
+      if (r->end - r->p < 8) {
+        return _corrupt();
+      }
+      for (i = 0; i < 8; i++) {
+        bits = (bits << 8) | *r->p++;
+      }
+      memcpy(&d, &bits, sizeof(d));
+      return PyFloat_FromDouble(d);
+    }
+    case TAG_BYTES:
+    case TAG_UNICODE:
+      if (!_get_size(r, &size)) {
+        return _corrupt();
+      }
+      ret = tag == TAG_BYTES
+          ? PyBytes_FromStringAndSize((const char *)r->p, size)
+          : PyUnicode_DecodeUTF8((const char *)r->p, size, NULL);
+      r->p += size;
+      return ret;
+    case TAG_TUPLE:
+    case TAG_LIST:
+    case TAG_DICT:
+      if (!_get_size(r, &size)) {
+        return _corrupt();
+      }
+      if (Py_EnterRecursiveCall(" while decoding a value")) {
+        return NULL;
+      }
+      if (tag == TAG_TUPLE) {
+        ret = PyTuple_New(size);
+      } else if (tag == TAG_LIST) {
+        ret = PyList_New(size);
+      } else {
+        ret = PyDict_New();
+      }
+      for (i = 0; ret && i < size; i++) {
+        if (!(value = _decode(r))) {
+          Py_CLEAR(ret);
+        } else if (tag == TAG_TUPLE) {
+          PyTuple_SET_ITEM(ret, i, value);
+        } else if (tag == TAG_LIST) {
+          PyList_SET_ITEM(ret, i, value);
+        } else {
+          key = value;
+          if (!(value = _decode(r)) || PyDict_SetItem(ret, key, value) != 0) {
+            Py_CLEAR(ret);
+          }
+          Py_DECREF(key);
+          Py_XDECREF(value);
+        }
+      }
+      Py_LeaveRecursiveCall();
+      return ret;
+    default:
+      return _corrupt();
+  }
+}
+
+/* Public ---------------------------------------------------------------- */
+
+/* Codec of a codec argument: None or "raw", or "tc" */
+int tc_Codec_FromObject(PyObject *name, tc_codec_t *codec) {
+  PyObject *bytes;
+  const char *str;
+  int ret = 0;
+
+  if (name == NULL || name == Py_None) {
+    *codec = TC_CODEC_RAW;
+    return 0;
+  }
+  if (!(bytes = tc_AsBytes(name, "codec"))) {
+    return -1;
+  }
+  str = PyBytes_AS_STRING(bytes);
+  if (!strcmp(str, "raw")) {
+    *codec = TC_CODEC_RAW;
+  } else if (!strcmp(str, "tc")) {
+    *codec = TC_CODEC_TC;
+  } else {
+    PyErr_Format(PyExc_ValueError, "unknown codec '%.100s', expected 'raw' or 'tc'", str);
+    ret = -1;
+  }
+  Py_DECREF(bytes);
+  return ret;
+}
+
+PyObject *tc_Codec_Encode(PyObject *obj) {
+  PyObject *ret = NULL;
+  TCXSTR *xstr = tcxstrnew();
+  unsigned char version = TC_CODEC_VERSION;
+
+  tcxstrcat(xstr, TC_CODEC_MAGIC, TC_CODEC_MAGIC_LEN);
+  tcxstrcat(xstr, &version, 1);
+  if (_encode(xstr, obj) == 0) {
+    ret = PyBytes_FromStringAndSize(tcxstrptr(xstr), tcxstrsize(xstr));
+  }
+  tcxstrdel(xstr);
+  return ret;
+}
+
+PyObject *tc_Codec_Decode(const char *buf, int size) {
+  PyObject *ret;
+  _reader r;
+
+  if (size < TC_CODEC_HEADER_LEN || memcmp(buf, TC_CODEC_MAGIC, TC_CODEC_MAGIC_LEN)) {
+    return PyBytes_FromStringAndSize(buf, size);
+  }
+  if ((unsigned char)buf[TC_CODEC_MAGIC_LEN] != TC_CODEC_VERSION) {
+    PyErr_Format(PyExc_ValueError, "unsupported codec version %d",
+                 (int)(unsigned char)buf[TC_CODEC_MAGIC_LEN]);
+    return NULL;
+  }
+  r.p = (const unsigned char *)buf + TC_CODEC_HEADER_LEN;
+  r.end = (const unsigned char *)buf + size;
+  if ((ret = _decode(&r)) && r.p != r.end) {
+    Py_DECREF(ret);
+    return _corrupt();
+  }
+  return ret;
+}
+
+int tc_Codec_Buffer(tc_codec_t codec, PyObject *obj, tc_buffer_t *buf, const char *what) {
+  PyObject *bytes;
+  int ret;
+
+  if (codec == TC_CODEC_RAW) {
+    return tc_Buffer_FromObject(obj, buf, what);
+  }
+  if (!(bytes = tc_Codec_Encode(obj))) {
+    return -1;
+  }
+  ret = tc_Buffer_FromObject(bytes, buf, what);
+  Py_DECREF(bytes);
+  return ret;
+}
+
+PyObject *tc_Codec_Value(tc_codec_t codec, const char *buf, int size) {
+  if (codec == TC_CODEC_RAW) {
+    return PyBytes_FromStringAndSize(buf, size);
+  }
+  return tc_Codec_Decode(buf, size);
+}
+
+PyObject *tc_Codec_encode(PyObject *module, PyObject *obj) {
+  log_trace("ENTER");
+  return tc_Codec_Encode(obj);
+}
+
+PyObject *tc_Codec_decode(PyObject *module, PyObject *data) {
+  tc_buffer_t buf;
+  PyObject *ret;
+
+  log_trace("ENTER");
+  if (tc_Buffer_FromObject(data, &buf, "encoded values") != 0) {
+    return NULL;
+  }
+  ret = tc_Codec_Decode(TC_BUFFER_BUF(buf), TC_BUFFER_LEN(buf));
+  TC_BUFFER_RELEASE(buf);
+  return ret;
+}
@@ -0,0 +1,35 @@
+#ifndef PYTC_CODEC_H
+#define PYTC_CODEC_H
+
+#include "_base.h"
+
+/* Codecs of database handles */
+typedef enum {
+  TC_CODEC_RAW,   /* values are bytes, stored as they are */
+  TC_CODEC_TC     /* values are Python objects encoded by this module */
+} tc_codec_t;
+
+/* Encoded values start with the TC_CODEC_MAGIC_LEN bytes of TC_CODEC_MAGIC
+   and the format version, which is increased whenever the format changes.
+   Values without the magic were stored raw and are returned as bytes, so
+   that a database can be migrated one record at a time. The magic is long
+   enough that raw values are not mistaken for encoded ones by chance. */
+#define TC_CODEC_MAGIC "\xfe" "tc\x00"
+#define TC_CODEC_MAGIC_LEN 4
+#define TC_CODEC_HEADER_LEN (TC_CODEC_MAGIC_LEN + 1)
+#define TC_CODEC_VERSION 1
+
+int tc_Codec_FromObject (PyObject *name, tc_codec_t *codec);
+PyObject *tc_Codec_Encode (PyObject *obj);
+PyObject *tc_Codec_Decode (const char *buf, int size);
+
+/* Value stored in a handle using codec */
+int tc_Codec_Buffer (tc_codec_t codec, PyObject *obj, tc_buffer_t *buf, const char *what);
+/* Object of a value read from a handle using codec */
+PyObject *tc_Codec_Value (tc_codec_t codec, const char *buf, int size);
+
+/* tc.encode() and tc.decode() */
+PyObject *tc_Codec_encode (PyObject *module, PyObject *obj);
+PyObject *tc_Codec_decode (PyObject *module, PyObject *data);
+
+#endif
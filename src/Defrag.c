@@ -0,0 +1,363 @@
+#include "Defrag.h"
+#include "HDB.h"
+#include "BDB.h"
+#include "TDB.h"
+#include "util.h"
+#include <errno.h>
+#include <sys/time.h>
+
+/* Private --------------------------------------------------------------- */
+
+#define TC_DEFRAG_OPS(prefix,type) \
+  static bool _ ## prefix ## defrag(void *db, int64_t step) { \
+    return prefix ## defrag((type *)db, step); \
+  } \
+  static int _ ## prefix ## ecode(void *db) { \
+    return prefix ## ecode((type *)db); \
+  }
+
+TC_DEFRAG_OPS(tchdb, TCHDB);
+TC_DEFRAG_OPS(tcbdb, TCBDB);
+TC_DEFRAG_OPS(tctdb, TCTDB);
+
+/* the interval grows up to this many times while the database is busy */
+#define TC_DEFRAG_MAXBACKOFF 16
+
+static double _now(void) {
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void _deadline(struct timespec *ts, double interval) {
+  double secs = _now() + interval;
+
+  ts->tv_sec = (time_t)secs;
+  ts->tv_nsec = (long)((secs - ts->tv_sec) * 1e9);
+}
+
+/* One round of up to steps calls. Called with the mutex held, which is
+   released during each call. Returns whether the calls were quick. */
+static bool _round(tc_Defrag *self) {
+  uint64_t before, after;
+  double start, elapsed;
+  bool ok;
+  int i;
+
+  for (i = 0; i < self->steps && !self->stop && !self->paused; i++) {
+    before = self->hdb->dfcur;
+    pthread_mutex_unlock(&self->mutex);
+    start = _now();
+    ok = self->defrag(self->handle, self->step);
+    elapsed = _now() - start;
+    after = self->hdb->dfcur;
+    pthread_mutex_lock(&self->mutex);
+    self->calls++;
+    self->seconds += elapsed;
+    if (!ok) {
+      self->ecode = self->ecode_of(self->handle);
+      return true;
+    }
+    if (after < before) {
+      self->passes++;
+    }
+    if (elapsed > self->maxlat) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void *_defragger(void *arg) {
+  tc_Defrag *self = (tc_Defrag *)arg;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&self->mutex);
+  while (!self->stop) {
+    if (self->paused || self->ecode) {
+      pthread_cond_wait(&self->wake, &self->mutex);
+      continue;
+    }
+    _deadline(&deadline, self->delay);
+    while (!self->stop && !self->paused &&
+           pthread_cond_timedwait(&self->wake, &self->mutex, &deadline) != ETIMEDOUT);
+    if (self->stop || self->paused) {
+      continue;
+    }
+    if (_round(self)) {
+      self->delay = self->interval;
+    } else {
+      self->backoffs++;
+      self->delay = min(self->delay * 2, self->interval * TC_DEFRAG_MAXBACKOFF);
+    }
+  }
+  pthread_mutex_unlock(&self->mutex);
+  return NULL;
+}
+
+/* Stop the thread. Must be called without the GIL. */
+static void _stop(tc_Defrag *self) {
+  pthread_mutex_lock(&self->mutex);
+  self->stop = true;
+  pthread_cond_signal(&self->wake);
+  pthread_mutex_unlock(&self->mutex);
+  if (self->started) {
+    pthread_join(self->thread, NULL);
+    self->started = false;
+  }
+}
+
+static void _set_paused(tc_Defrag *self, bool paused) {
+  pthread_mutex_lock(&self->mutex);
+  self->paused = paused;
+  self->delay = self->interval;
+  pthread_cond_signal(&self->wake);
+  pthread_mutex_unlock(&self->mutex);
+}
+
+/* Public ---------------------------------------------------------------- */
+
+static long tc_Defrag_Hash(PyObject *self) {
+  log_trace("ENTER");
+  PyErr_SetString(PyExc_TypeError, "Defrag objects are unhashable");
+  return -1L;
+}
+
+static void tc_Defrag_dealloc(tc_Defrag *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  _stop(self);
+  Py_END_ALLOW_THREADS
+  pthread_cond_destroy(&self->wake);
+  pthread_mutex_destroy(&self->mutex);
+  Py_XDECREF(self->db);
+  PyObject_Del(self);
+}
+
+static PyObject *tc_Defrag_new(PyTypeObject *type, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  tc_Defrag *self;
+  PyObject *db;
+  void *handle, *mmtx;
+  TCHDB *hdb;
+  bool (*defrag)(void *, int64_t);
+  int (*ecode_of)(void *);
+  const char *(*errmsg)(int);
+  PY_LONG_LONG step = 64;
+  int steps = 16;
+  double interval = 1.0, maxlat = 0.01;
+  static char *kwlist[] = {"db", "step", "steps", "interval", "maxlat", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|Lidd:Defrag", kwlist,
+                                   &db, &step, &steps, &interval, &maxlat)) {
+    return NULL;
+  }
+  if (PyObject_TypeCheck(db, &tc_HDBType)) {
+    handle = hdb = ((tc_HDB *)db)->hdb;
+    mmtx = hdb->mmtx;
+    defrag = _tchdbdefrag;
+    ecode_of = _tchdbecode;
+    errmsg = tchdberrmsg;
+  } else if (PyObject_TypeCheck(db, &tc_BDBType)) {
+    handle = ((tc_BDB *)db)->bdb;
+    hdb = ((TCBDB *)handle)->hdb;
+    mmtx = ((TCBDB *)handle)->mmtx;
+    defrag = _tcbdbdefrag;
+    ecode_of = _tcbdbecode;
+    errmsg = tcbdberrmsg;
+  } else if (PyObject_TypeCheck(db, &tc_TDBType)) {
+    handle = ((tc_TDB *)db)->db;
+    hdb = ((TCTDB *)handle)->hdb;
+    mmtx = ((TCTDB *)handle)->mmtx;
+    defrag = _tctdbdefrag;
+    ecode_of = _tctdbecode;
+    errmsg = tctdberrmsg;
+  } else {
+    PyErr_SetString(PyExc_TypeError, "db must be an HDB, BDB or TDB object");
+    return NULL;
+  }
+  /* the database is used from a thread of its own */
+  if (!mmtx) {
+    PyErr_SetString(PyExc_ValueError, "setmutex() must be called on db before it is opened");
+    return NULL;
+  }
+  if (step <= 0 || steps <= 0 || interval <= 0 || maxlat <= 0) {
+    PyErr_SetString(PyExc_ValueError, "step, steps, interval and maxlat must be positive");
+    return NULL;
+  }
+  if (!(self = (tc_Defrag *)type->tp_alloc(type, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_Defrag instance");
+    return NULL;
+  }
+  Py_INCREF(db);
+  self->db = db;
+  self->handle = handle;
+  self->hdb = hdb;
+  self->defrag = defrag;
+  self->ecode_of = ecode_of;
+  self->errmsg = errmsg;
+  self->step = step;
+  self->steps = steps;
+  self->interval = self->delay = interval;
+  self->maxlat = maxlat;
+  self->fsiz0 = hdb->fsiz;
+  pthread_mutex_init(&self->mutex, NULL);
+  pthread_cond_init(&self->wake, NULL);
+  if (pthread_create(&self->thread, NULL, _defragger, self) != 0) {
+    PyErr_SetString(PyExc_RuntimeError, "Cannot start defragmentation thread");
+    Py_DECREF(self);
+    return NULL;
+  }
+  self->started = true;
+  return (PyObject *)self;
+}
+
+static PyObject *tc_Defrag_stop(tc_Defrag *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  _stop(self);
+  Py_END_ALLOW_THREADS
+  if (self->ecode) {
+    tc_Error_SetCodeAndString(self->ecode, self->errmsg(self->ecode));
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_Defrag_pause(tc_Defrag *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  _set_paused(self, true);
+  Py_END_ALLOW_THREADS
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_Defrag_resume(tc_Defrag *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  _set_paused(self, false);
+  Py_END_ALLOW_THREADS
+  Py_RETURN_NONE;
+}
+
+/* Progress of the thread and fragmentation of the file. Values of the
+   database are read without its lock and are approximate. */
+static PyObject *tc_Defrag_status(tc_Defrag *self) {
+  log_trace("ENTER");
+  PyObject *dict, *item;
+  TCHDB *hdb = self->hdb;
+  uint64_t fsiz = hdb->fsiz, dfcur = hdb->dfcur, frec = hdb->frec;
+  uint64_t calls, passes, backoffs;
+  double seconds, delay, progress = 0;
+  bool running;
+  int ecode, i;
+
+  pthread_mutex_lock(&self->mutex);
+  running = self->started && !self->stop && !self->paused && !self->ecode;
+  calls = self->calls;
+  passes = self->passes;
+  backoffs = self->backoffs;
+  seconds = self->seconds;
+  delay = self->delay;
+  ecode = self->ecode;
+  pthread_mutex_unlock(&self->mutex);
+
+  if (fsiz > frec && dfcur > frec) {
+    progress = min((double)(dfcur - frec) / (fsiz - frec), 1.0);
+  }
+  if (!(dict = PyDict_New())) {
+    return NULL;
+  }
+  if (PyDict_SetItemString(dict, "running", running ? Py_True : Py_False) ||
+      tc_Dict_SetLongLong(dict, "calls", calls) ||
+      tc_Dict_SetLongLong(dict, "passes", passes) ||
+      tc_Dict_SetLongLong(dict, "backoffs", backoffs) ||
+      tc_Dict_SetLongLong(dict, "ecode", ecode) ||
+      tc_Dict_SetLongLong(dict, "fsiz", fsiz) ||
+      tc_Dict_SetLongLong(dict, "reclaimed", (PY_LONG_LONG)self->fsiz0 - (PY_LONG_LONG)fsiz) ||
+      tc_Dict_SetLongLong(dict, "freeblocks", hdb->fbpnum)) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  {
+    const char *names[] = {"seconds", "interval", "progress"};
+    double values[] = {seconds, delay, progress};
+    for (i = 0; i < 3; i++) {
+      if (!(item = PyFloat_FromDouble(values[i])) ||
+          PyDict_SetItemString(dict, names[i], item)) {
+        Py_XDECREF(item);
+        Py_DECREF(dict);
+        return NULL;
+      }
+      Py_DECREF(item);
+    }
+  }
+  return dict;
+}
+
+/* methods of classes */
+static PyMethodDef tc_Defrag_methods[] = {
+  {"stop", (PyCFunction)tc_Defrag_stop, METH_NOARGS,
+    "Stop the defragmentation thread."},
+  {"pause", (PyCFunction)tc_Defrag_pause, METH_NOARGS,
+    "Pause defragmentation until resume() is called."},
+  {"resume", (PyCFunction)tc_Defrag_resume, METH_NOARGS,
+    "Resume paused defragmentation."},
+  {"status", (PyCFunction)tc_Defrag_status, METH_NOARGS,
+    "Get a dict of the progress of defragmentation and the fragmentation of the file."},
+  {NULL, NULL, 0, NULL}
+};
+
+PyTypeObject tc_DefragType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.Defrag",                                 /* tp_name */
+  sizeof(tc_Defrag),                           /* tp_basicsize */
+  0,                                           /* tp_itemsize */
+  (destructor)tc_Defrag_dealloc,               /* tp_dealloc */
+  0,                                           /* tp_print */
+  0,                                           /* tp_getattr */
+  0,                                           /* tp_setattr */
+  0,                                           /* tp_compare */
+  0,                                           /* tp_repr */
+  0,                                           /* tp_as_number */
+  0,                                           /* tp_as_sequence */
+  0,                                           /* tp_as_mapping */
+  tc_Defrag_Hash,                              /* tp_hash  */
+  0,                                           /* tp_call */
+  0,                                           /* tp_str */
+  0,                                           /* tp_getattro */
+  0,                                           /* tp_setattro */
+  0,                                           /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,    /* tp_flags */
+  "Background defragmentation of a database",  /* tp_doc */
+  0,                                           /* tp_traverse */
+  0,                                           /* tp_clear */
+  0,                                           /* tp_richcompare */
+  0,                                           /* tp_weaklistoffset */
+  0,                                           /* tp_iter */
+  0,                                           /* tp_iternext */
+  tc_Defrag_methods,                           /* tp_methods */
+  0,                                           /* tp_members */
+  0,                                           /* tp_getset */
+  0,                                           /* tp_base */
+  0,                                           /* tp_dict */
+  0,                                           /* tp_descr_get */
+  0,                                           /* tp_descr_set */
+  0,                                           /* tp_dictoffset */
+  0,                                           /* tp_init */
+  0,                                           /* tp_alloc */
+  tc_Defrag_new,                               /* tp_new */
+};
+
+int tc_Defrag_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_DefragType) == 0)
+    return PyModule_AddObject(module, "Defrag", (PyObject *)&tc_DefragType);
+  return -1;
+}
@@ -0,0 +1,45 @@
+#ifndef PYTC_DEFRAG_H
+#define PYTC_DEFRAG_H
+
+#include "_base.h"
+#include <pthread.h>
+#include <tchdb.h>
+
+/* Background defragmentation of an HDB, BDB or TDB. A native thread runs
+   up to steps calls of defrag(step) per interval. A call taking longer
+   than maxlat means foreground traffic kept the database lock busy, so
+   the rest of the interval is skipped and the interval doubles, up to 16
+   times, until calls are quick again. All fields below hdb are guarded
+   by mutex. */
+typedef struct {
+  PyObject_HEAD
+  PyObject *db;             /* the database object, kept alive */
+  void *handle;             /* its TCHDB, TCBDB or TCTDB */
+  TCHDB *hdb;               /* the hash database holding the records */
+  bool (*defrag)(void *db, int64_t step);
+  int (*ecode_of)(void *db);
+  const char *(*errmsg)(int ecode);
+  int64_t step;             /* records moved per call */
+  int steps;                /* calls per interval */
+  double interval;          /* seconds between rounds of calls */
+  double maxlat;            /* seconds a call may take before backing off */
+  bool started;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  bool stop;
+  bool paused;
+  int ecode;                /* error of a failed call, stops the thread */
+  double delay;             /* current interval */
+  uint64_t calls;
+  uint64_t passes;          /* times the cursor went through the file */
+  uint64_t backoffs;
+  double seconds;           /* time spent in calls */
+  uint64_t fsiz0;           /* file size when started */
+} tc_Defrag;
+
+extern PyTypeObject tc_DefragType;
+
+int tc_Defrag_register(PyObject *module);
+
+#endif
@@ -0,0 +1,841 @@
+#include "FDB.h"
+#include "FDBIterator.h"
+#include "Transaction.h"
+#include "util.h"
+
+/* Private --------------------------------------------------------------- */
+
+void tc_Error_SetFDB(TCFDB *fdb) {
+  log_trace("ENTER");
+  int ecode = tcfdbecode(fdb);
+  if (ecode == TCENOREC) {
+    PyErr_SetString(PyExc_KeyError, tcfdberrmsg(ecode));
+  } else {
+    tc_Error_SetCodeAndString(ecode, tcfdberrmsg(ecode));
+  }
+}
+
+/* IDs are handed out as plain ints where they fit */
+PyObject *tc_FDB_IdAsObject(uint64_t id) {
+  if (id <= LONG_MAX) {
+    return NUMBER_FromLong((long)id);
+  }
+  return PyLong_FromUnsignedLongLong(id);
+}
+
+static int _id_from_object(PyObject *obj, PY_LONG_LONG *id) {
+  if (PYTC_STRING_CHECK(obj)) {
+    PyErr_SetString(PyExc_TypeError, "IDs of a fixed-length database must be integers");
+    return -1;
+  }
+  *id = PyLong_AsLongLong(obj);
+  if (*id == -1 && PyErr_Occurred()) {
+    return -1;
+  }
+  return 0;
+}
+
+#define tc_FDB_TUNE_OR_OPT(a,b,c) \
+  static PyObject * \
+  a(tc_FDB *self, PyObject *args, PyObject *keywds) { \
+    log_trace("ENTER");\
+    bool result; \
+    int width = 0; \
+    PY_LONG_LONG limsiz = 0; \
+    static char *kwlist[] = {"width", "limsiz", NULL}; \
+  \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "|iL:" #b, kwlist, \
+                                     &width, &limsiz)) { \
+      return NULL; \
+    } \
+    Py_BEGIN_ALLOW_THREADS \
+    result = c(self->fdb, width, limsiz); \
+    Py_END_ALLOW_THREADS \
+  \
+    if (!result) { \
+      tc_Error_SetFDB(self->fdb); \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
+#define tc_FDB_PUT(func,method,call) \
+  static PyObject * \
+  func(tc_FDB *self, PyObject *args, PyObject *keywds) { \
+    log_trace("ENTER"); \
+    PY_LONG_LONG id; \
+    tc_buffer_t value; \
+    bool result; \
+    tc_StatsTimer timer; \
+    static char *kwlist[] = {"id", "value", NULL}; \
+  \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "L" TC_BUFFER_FMT ":" #method, kwlist, \
+                                     &id, TC_BUFFER_ARGS(value)) || \
+        tc_Buffer_Check(&value) != 0) { \
+      return NULL; \
+    } \
+    Py_BEGIN_ALLOW_THREADS \
+    TC_STATS_CALL(timer, result = call(self->fdb, id, TC_BUFFER_BUF(value), \
+                                       TC_BUFFER_LEN(value))); \
+    Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_PUT, &timer, TC_BUFFER_LEN(value), 0, result); \
+    TC_BUFFER_RELEASE(value); \
+  \
+    if (!result) { \
+      tc_Error_SetFDB(self->fdb); \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
+/* Unlike TC_U_LONG_LONG_NOARGS, these never fail, so the last error code
+   (which may be left over from an earlier lookup) is not looked at */
+#define tc_FDB_U_LONG_LONG_NOARGS(func,call) \
+  static PyObject * \
+  func(tc_FDB *self) { \
+    unsigned PY_LONG_LONG val; \
+  \
+    Py_BEGIN_ALLOW_THREADS \
+    val = call(self->fdb); \
+    Py_END_ALLOW_THREADS \
+    return PyLong_FromUnsignedLongLong(val); \
+  }
+
+/* Copy the records lower .. lower+num-1 into num consecutive slots of
+   width bytes each. Slots of missing records are zeroed and longer values
+   are clipped. Must be called without the GIL. Returns the number of
+   records found or -1 on errors. */
+static int64_t _getrange(TCFDB *fdb, int64_t lower, int64_t num, int width, char *dst) {
+  int64_t i, found = 0;
+  int value_len;
+
+  for (i = 0; i < num; i++, dst += width) {
+    value_len = tcfdbget4(fdb, lower + i, dst, width);
+    if (value_len == -1) {
+      if (tcfdbecode(fdb) != TCENOREC) {
+        return -1;
+      }
+      value_len = 0;
+    } else {
+      found++;
+    }
+    memset(dst + value_len, 0, width - value_len);
+  }
+  return found;
+}
+
+/* Slot width of range reads, defaulting to the width of the database */
+static int _getrange_width(tc_FDB *self, int width) {
+  if (width == 0) {
+    Py_BEGIN_ALLOW_THREADS
+    width = (int)tcfdbwidth(self->fdb);
+    Py_END_ALLOW_THREADS
+  }
+  if (width <= 0) {
+    PyErr_SetString(PyExc_ValueError, "width must be positive");
+    return -1;
+  }
+  return width;
+}
+
+/* Public --------------------------------------------------------------- */
+
+static long tc_FDB_Hash(PyObject *self) {
+  log_trace("ENTER");
+  PyErr_SetString(PyExc_TypeError, "FDB objects are unhashable");
+  return -1L;
+}
+
+static PyObject *tc_FDB_errmsg(PyTypeObject *type, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  int ecode;
+  static char *kwlist[] = {"ecode", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "i:errmsg", kwlist,
+                                   &ecode)) {
+    return NULL;
+  }
+  return PyBytes_FromString(tcfdberrmsg(ecode));
+}
+
+static void tc_FDB_dealloc(tc_FDB *self) {
+  log_trace("ENTER");
+  /* NOTE: tcfdbdel closes fdb implicitly */
+  if (self->fdb) {
+    Py_BEGIN_ALLOW_THREADS
+    tcfdbdel(self->fdb);
+    Py_END_ALLOW_THREADS
+  }
+  tc_Stats_del(self->stats);
+  PyObject_Del(self);
+}
+
+static PyObject *tc_FDB_new(PyTypeObject *type, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  tc_FDB *self;
+  if (!(self = (tc_FDB *)type->tp_alloc(type, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_FDB instance");
+    return NULL;
+  }
+  if (!(self->stats = tc_Stats_new())) {
+    /* exception set by tc_Stats_new */
+  } else if ((self->fdb = tcfdbnew())) {
+    int omode = 0;
+    char *path = NULL;
+    static char *kwlist[] = {"path", "omode", NULL};
+
+    if (PyArg_ParseTupleAndKeywords(args, keywds, "|si:open", kwlist,
+                                    &path, &omode)) {
+      if (path && omode) {
+        bool result;
+        Py_BEGIN_ALLOW_THREADS
+        result = tcfdbopen(self->fdb, path, omode);
+        Py_END_ALLOW_THREADS
+        if (result) {
+          return (PyObject *)self;
+        }
+      } else {
+        return (PyObject *)self;
+      }
+      tc_Error_SetFDB(self->fdb);
+    }
+  } else {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc TCFDB instance");
+  }
+  tc_FDB_dealloc(self);
+  return NULL;
+}
+
+static PyObject *tc_FDB_ecode(tc_FDB *self) {
+  log_trace("ENTER");
+  return NUMBER_FromLong((long)tcfdbecode(self->fdb));
+}
+
+TC_BOOL_NOARGS(tc_FDB_setmutex,tc_FDB,tcfdbsetmutex,fdb,tc_Error_SetFDB,fdb);
+tc_FDB_TUNE_OR_OPT(tc_FDB_tune, tune, tcfdbtune);
+TC_XDB_OPEN(tc_FDB_open,tc_FDB,tc_FDB_new,tcfdbopen,fdb,tc_FDB_dealloc,tc_Error_SetFDB);
+TC_BOOL_NOARGS(tc_FDB_close,tc_FDB,tcfdbclose,fdb,tc_Error_SetFDB,fdb);
+tc_FDB_PUT(tc_FDB_put, put, tcfdbput);
+tc_FDB_PUT(tc_FDB_putkeep, putkeep, tcfdbputkeep);
+tc_FDB_PUT(tc_FDB_putcat, putcat, tcfdbputcat);
+
+static PyObject *tc_FDB_out(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG id;
+  bool result;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"id", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "L:out", kwlist, &id)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, result = tcfdbout(self->fdb, id));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_OUT, &timer, 0, 0, result);
+
+  if (!result) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_FDB_GetItem(tc_FDB *self, PY_LONG_LONG id) {
+  PyObject *ret;
+  void *value;
+  int value_len;
+  tc_StatsTimer timer;
+
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, value = tcfdbget(self->fdb, id, &value_len));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_GET, &timer, 0, value ? value_len : 0, value != NULL);
+
+  if (!value) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  ret = PyBytes_FromStringAndSize(value, value_len);
+  free(value);
+  return ret;
+}
+
+static PyObject *tc_FDB_get(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG id;
+  static char *kwlist[] = {"id", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "L:get", kwlist, &id)) {
+    return NULL;
+  }
+  return tc_FDB_GetItem(self, id);
+}
+
+/* Read the value of a record straight into a writable buffer, skipping the
+   intermediate bytes object. Returns the size of the value. */
+static PyObject *tc_FDB_get_into(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG id;
+  int value_len, full_len = -1;
+  tc_buffer_t buffer;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"id", "buffer", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "L" TC_WBUFFER_FMT ":get_into", kwlist,
+                                   &id, TC_BUFFER_ARGS(buffer)) ||
+      tc_Buffer_Check(&buffer) != 0) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, value_len = tcfdbget4(self->fdb, id, TC_BUFFER_BUF(buffer),
+                                             TC_BUFFER_LEN(buffer)));
+  /* tc silently clips the value to the buffer, which is then left
+     partly written */
+  if (value_len == TC_BUFFER_LEN(buffer)) {
+    full_len = tcfdbvsiz(self->fdb, id);
+  }
+  Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(buffer);
+  tc_Stats_record(self->stats, TC_OP_GET, &timer, 0,
+                  value_len == -1 ? 0 : value_len, value_len != -1);
+
+  if (value_len == -1) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  if (full_len > value_len) {
+    PyErr_Format(PyExc_ValueError, "buffer too small for a value of %d bytes", full_len);
+    return NULL;
+  }
+  return NUMBER_FromLong((long)value_len);
+}
+
+/* Read the records of IDs lower to upper into one bytes object of
+   fixed-size slots, in a single GIL release */
+static PyObject *tc_FDB_getrange(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *ret;
+  PY_LONG_LONG lower, upper, num, found;
+  int width = 0;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"lower", "upper", "width", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "LL|i:getrange", kwlist,
+                                   &lower, &upper, &width)) {
+    return NULL;
+  }
+  if ((width = _getrange_width(self, width)) == -1) {
+    return NULL;
+  }
+  if (lower < 1 || upper < lower) {
+    PyErr_SetString(PyExc_ValueError, "invalid range of IDs");
+    return NULL;
+  }
+  num = upper - lower + 1;
+  if (num > PY_SSIZE_T_MAX / width) {
+    PyErr_SetString(PyExc_OverflowError, "range of IDs too large");
+    return NULL;
+  }
+  if (!(ret = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)(num * width)))) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, found = _getrange(self->fdb, lower, num, width, PyBytes_AS_STRING(ret)));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_GETMANY, &timer, 0,
+                  found == -1 ? 0 : num * width, found != -1);
+
+  if (found == -1) {
+    tc_Error_SetFDB(self->fdb);
+    Py_DECREF(ret);
+    return NULL;
+  }
+  return ret;
+}
+
+/* Same as getrange, filling as many slots of a writable buffer as fit */
+static PyObject *tc_FDB_getrange_into(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG lower, num, found;
+  int width = 0;
+  tc_buffer_t buffer;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"lower", "buffer", "width", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "L" TC_WBUFFER_FMT "|i:getrange_into",
+                                   kwlist, &lower, TC_BUFFER_ARGS(buffer), &width) ||
+      tc_Buffer_Check(&buffer) != 0) {
+    return NULL;
+  }
+  if ((width = _getrange_width(self, width)) == -1) {
+    TC_BUFFER_RELEASE(buffer);
+    return NULL;
+  }
+  if (lower < 1) {
+    TC_BUFFER_RELEASE(buffer);
+    PyErr_SetString(PyExc_ValueError, "invalid range of IDs");
+    return NULL;
+  }
+  num = (PY_LONG_LONG)(TC_BUFFER_LEN(buffer) / width);
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, found = _getrange(self->fdb, lower, num, width, TC_BUFFER_BUF(buffer)));
+  Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(buffer);
+  tc_Stats_record(self->stats, TC_OP_GETMANY, &timer, 0,
+                  found == -1 ? 0 : num * width, found != -1);
+
+  if (found == -1) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  return PyLong_FromLongLong(found);
+}
+
+static PyObject *tc_FDB_vsiz(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG id;
+  int ret;
+  static char *kwlist[] = {"id", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "L:vsiz", kwlist, &id)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  ret = tcfdbvsiz(self->fdb, id);
+  Py_END_ALLOW_THREADS
+
+  if (ret == -1) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  return NUMBER_FromLong((long)ret);
+}
+
+/* IDs of the records between lower and upper, at most max of them */
+static PyObject *tc_FDB_range(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *ret, *id;
+  PY_LONG_LONG lower = FDBIDMIN, upper = FDBIDMAX;
+  uint64_t *ids;
+  int i, num, max = -1;
+  static char *kwlist[] = {"lower", "upper", "max", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|LLi:range", kwlist,
+                                   &lower, &upper, &max)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  ids = tcfdbrange(self->fdb, lower, upper, max, &num);
+  Py_END_ALLOW_THREADS
+
+  if (!ids) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  if ((ret = PyList_New(num))) {
+    for (i = 0; i < num; i++) {
+      if (!(id = tc_FDB_IdAsObject(ids[i]))) {
+        Py_CLEAR(ret);
+        break;
+      }
+      PyList_SET_ITEM(ret, i, id);
+    }
+  }
+  free(ids);
+  return ret;
+}
+
+static PyObject *tc_FDB_iterinit(tc_FDB *self) {
+  log_trace("ENTER");
+  bool result;
+
+  Py_BEGIN_ALLOW_THREADS
+  result = tcfdbiterinit(self->fdb);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_FDB_iternext(tc_FDB *self) {
+  log_trace("ENTER");
+  uint64_t id;
+
+  Py_BEGIN_ALLOW_THREADS
+  id = tcfdbiternext(self->fdb);
+  Py_END_ALLOW_THREADS
+
+  if (!id) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  return tc_FDB_IdAsObject(id);
+}
+
+static PyObject *tc_FDB_GetIter(tc_FDB *self, tc_itertype_t itype) {
+  log_trace("ENTER");
+  return (PyObject *)tc_FDBIterator_new_capi(self, itype, TC_ITER_PREFETCH);
+}
+
+TC_XDB_iters(tc_FDB,tc_FDB_GetIter_keys,tc_FDB_GetIter_values,tc_FDB_GetIter_items,tc_FDB_GetIter);
+
+/* Walk the whole database, TC_SCAN_SIZE records per GIL release */
+static PyObject *tc_FDB_scan(tc_FDB *self, tc_itertype_t itype) {
+  log_trace("ENTER");
+  PyObject *ret, *obj;
+  tc_FDBIterator *iter;
+  bool result;
+  tc_StatsTimer timer;
+  int i;
+
+  if (!(iter = tc_FDBIterator_new_capi(self, itype, TC_SCAN_SIZE))) {
+    return NULL;
+  }
+  if (!(ret = PyList_New(0))) {
+    Py_DECREF(iter);
+    return NULL;
+  }
+  while (ret && !iter->done) {
+    Py_BEGIN_ALLOW_THREADS
+    TC_STATS_CALL(timer, result = tc_FDBIterator_fetch(iter));
+    Py_END_ALLOW_THREADS
+    tc_Stats_record(self->stats, TC_OP_ITER, &timer, 0,
+                    tcxstrsize(iter->buf->arena), result);
+    if (!result) {
+      tc_Error_SetFDB(self->fdb);
+      Py_CLEAR(ret);
+      break;
+    }
+    for (i = 0; i < iter->buf->num; i++) {
+      if (!(obj = tc_FDBIterator_get(iter, i)) || PyList_Append(ret, obj) != 0) {
+        Py_XDECREF(obj);
+        Py_CLEAR(ret);
+        break;
+      }
+      Py_DECREF(obj);
+    }
+  }
+  Py_DECREF(iter);
+  return ret;
+}
+
+static PyObject *tc_FDB_keys(tc_FDB *self) {
+  return tc_FDB_scan(self, tc_iter_key_t);
+}
+
+static PyObject *tc_FDB_items(tc_FDB *self) {
+  return tc_FDB_scan(self, tc_iter_item_t);
+}
+
+static PyObject *tc_FDB_values(tc_FDB *self) {
+  return tc_FDB_scan(self, tc_iter_value_t);
+}
+
+static PyObject *tc_FDB_addint(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG id;
+  int num;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"id", "num", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "Li:addint", kwlist, &id, &num)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, num = tcfdbaddint(self->fdb, id, num));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_PUT, &timer, sizeof(num), 0, num != INT_MIN);
+
+  if (num == INT_MIN) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  return NUMBER_FromLong((long)num);
+}
+
+static PyObject *tc_FDB_adddouble(tc_FDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG id;
+  double num;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"id", "num", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "Ld:adddouble", kwlist, &id, &num)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, num = tcfdbadddouble(self->fdb, id, num));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_PUT, &timer, sizeof(num), 0, !isnan(num));
+
+  if (isnan(num)) {
+    tc_Error_SetFDB(self->fdb);
+    return NULL;
+  }
+  return PyFloat_FromDouble(num);
+}
+
+TC_BOOL_NOARGS(tc_FDB_sync,tc_FDB,tcfdbsync,fdb,tc_Error_SetFDB,fdb);
+tc_FDB_TUNE_OR_OPT(tc_FDB_optimize, optimize, tcfdboptimize);
+TC_STRING_NOARGS(tc_FDB_path,tc_FDB,tcfdbpath,fdb,tc_Error_SetFDB);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_rnum, tcfdbrnum);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_fsiz, tcfdbfsiz);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_min, tcfdbmin);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_max, tcfdbmax);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_width, tcfdbwidth);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_limsiz, tcfdblimsiz);
+tc_FDB_U_LONG_LONG_NOARGS(tc_FDB_limid, tcfdblimid);
+TC_BOOL_NOARGS(tc_FDB_vanish,tc_FDB,tcfdbvanish,fdb,tc_Error_SetFDB,fdb);
+TC_BOOL_NOARGS(tc_FDB_tranbegin,tc_FDB,tcfdbtranbegin,fdb,tc_Error_SetFDB,fdb);
+TC_BOOL_NOARGS(tc_FDB_trancommit,tc_FDB,tcfdbtrancommit,fdb,tc_Error_SetFDB,fdb);
+TC_BOOL_NOARGS(tc_FDB_tranabort,tc_FDB,tcfdbtranabort,fdb,tc_Error_SetFDB,fdb);
+TC_XDB_transaction(tc_FDB_transaction,tc_FDB);
+TC_XDB_stats(tc_FDB_stats,tc_FDB);
+TC_XDB_prometheus(tc_FDB_prometheus,tc_FDB);
+TC_BOOL_PATHARGS(tc_FDB_copy, tc_FDB, copy, tcfdbcopy, fdb, tc_Error_SetFDB);
+
+/* for dict like interface */
+static int tc_FDB_Contains(tc_FDB *self, PyObject *_id) {
+  PY_LONG_LONG id;
+  int value_len;
+
+  if (_id_from_object(_id, &id) != 0) {
+    return -1;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  value_len = tcfdbvsiz(self->fdb, id);
+  Py_END_ALLOW_THREADS
+
+  return (value_len != -1);
+}
+
+TC_XDB___contains__(tc_FDB___contains__,tc_FDB,tc_FDB_Contains);
+
+static PyObject *tc_FDB_subscript(tc_FDB *self, PyObject *_id) {
+  PY_LONG_LONG id;
+
+  if (_id_from_object(_id, &id) != 0) {
+    return NULL;
+  }
+  return tc_FDB_GetItem(self, id);
+}
+
+static Py_ssize_t tc_FDB_length(tc_FDB *self) {
+  uint64_t ret;
+  Py_BEGIN_ALLOW_THREADS
+  ret = tcfdbrnum(self->fdb);
+  Py_END_ALLOW_THREADS
+  return (Py_ssize_t)ret;
+}
+
+static int tc_FDB_ass_sub(tc_FDB *self, PyObject *_id, PyObject *_value) {
+  PY_LONG_LONG id;
+  tc_buffer_t value;
+  bool result;
+  tc_StatsTimer timer;
+
+  if (_id_from_object(_id, &id) != 0) {
+    return -1;
+  }
+  if (_value) {
+    if (tc_Buffer_FromObject(_value, &value, "values") != 0) {
+      return -1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    TC_STATS_CALL(timer, result = tcfdbput(self->fdb, id, TC_BUFFER_BUF(value),
+                                           TC_BUFFER_LEN(value)));
+    Py_END_ALLOW_THREADS
+    tc_Stats_record(self->stats, TC_OP_PUT, &timer, TC_BUFFER_LEN(value), 0, result);
+    TC_BUFFER_RELEASE(value);
+  } else {
+    Py_BEGIN_ALLOW_THREADS
+    TC_STATS_CALL(timer, result = tcfdbout(self->fdb, id));
+    Py_END_ALLOW_THREADS
+    tc_Stats_record(self->stats, TC_OP_OUT, &timer, 0, 0, result);
+  }
+  if (!result) {
+    tc_Error_SetFDB(self->fdb);
+    return -1;
+  }
+  return 0;
+}
+
+/* methods of classes */
+static PyMethodDef tc_FDB_methods[] = {
+  {"errmsg", (PyCFunction)tc_FDB_errmsg, METH_VARARGS | METH_KEYWORDS | METH_CLASS,
+    "Get the message string corresponding to an error code."},
+  {"ecode", (PyCFunction)tc_FDB_ecode, METH_NOARGS,
+    "Get the last happened error code of a fixed-length database object."},
+  {"setmutex", (PyCFunction)tc_FDB_setmutex, METH_NOARGS,
+    "Set mutual exclusion control of a fixed-length database object for threading."},
+  {"tune", (PyCFunction)tc_FDB_tune, METH_VARARGS | METH_KEYWORDS,
+    "Set the tuning parameters of a fixed-length database object."},
+  {"open", (PyCFunction)tc_FDB_open, METH_VARARGS | METH_KEYWORDS,
+    "Open a database file and connect a fixed-length database object."},
+  {"close", (PyCFunction)tc_FDB_close, METH_NOARGS,
+    "Close a fixed-length database object."},
+  {"put", (PyCFunction)tc_FDB_put, METH_VARARGS | METH_KEYWORDS,
+    "Store a record into a fixed-length database object."},
+  {"putkeep", (PyCFunction)tc_FDB_putkeep, METH_VARARGS | METH_KEYWORDS,
+    "Store a new record into a fixed-length database object."},
+  {"putcat", (PyCFunction)tc_FDB_putcat, METH_VARARGS | METH_KEYWORDS,
+    "Concatenate a value at the end of the existing record in a fixed-length database object."},
+  {"out", (PyCFunction)tc_FDB_out, METH_VARARGS | METH_KEYWORDS,
+    "Remove a record of a fixed-length database object."},
+  {"get", (PyCFunction)tc_FDB_get, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record in a fixed-length database object."},
+  {"get_into", (PyCFunction)tc_FDB_get_into, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record in a fixed-length database object into a writable buffer.\n"
+   "Returns the size of the value. ValueError is raised if the buffer is too small."},
+  {"getrange", (PyCFunction)tc_FDB_getrange, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve the records of the IDs from lower to upper as one string of slots of width bytes.\n"
+   "Missing records are zero-filled."},
+  {"getrange_into", (PyCFunction)tc_FDB_getrange_into, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve the records from the ID lower on into the slots of width bytes of a writable buffer.\n"
+   "Returns the number of records found."},
+  {"vsiz", (PyCFunction)tc_FDB_vsiz, METH_VARARGS | METH_KEYWORDS,
+    "Get the size of the value of a record in a fixed-length database object."},
+  {"range", (PyCFunction)tc_FDB_range, METH_VARARGS | METH_KEYWORDS,
+    "Get the IDs of the records in a range of a fixed-length database object."},
+  {"iterinit", (PyCFunction)tc_FDB_iterinit, METH_NOARGS,
+    "Initialize the iterator of a fixed-length database object."},
+  {"iternext", (PyCFunction)tc_FDB_iternext, METH_NOARGS,
+    "Get the next ID of the iterator of a fixed-length database object."},
+  {"sync", (PyCFunction)tc_FDB_sync, METH_NOARGS,
+    "Synchronize updated contents of a fixed-length database object with the file and the device."},
+  {"optimize", (PyCFunction)tc_FDB_optimize, METH_VARARGS | METH_KEYWORDS,
+    "Optimize the file of a fixed-length database object."},
+  {"vanish", (PyCFunction)tc_FDB_vanish, METH_NOARGS,
+    "Remove all records of a fixed-length database object."},
+  {"tranbegin", (PyCFunction)tc_FDB_tranbegin, METH_NOARGS,
+    "Begin the transaction of a fixed-length database object."},
+  {"trancommit", (PyCFunction)tc_FDB_trancommit, METH_NOARGS,
+    "Commit the transaction of a fixed-length database object."},
+  {"tranabort", (PyCFunction)tc_FDB_tranabort, METH_NOARGS,
+    "Abort the transaction of a fixed-length database object."},
+  {"transaction", (PyCFunction)tc_FDB_transaction, METH_NOARGS,
+    "Get a context manager running a block in a transaction of a fixed-length database object."},
+  {"stats", (PyCFunction)tc_FDB_stats, METH_VARARGS | METH_KEYWORDS,
+    "Get a dict of the operation counters and latencies of a fixed-length database object."},
+  {"prometheus", (PyCFunction)tc_FDB_prometheus, METH_VARARGS | METH_KEYWORDS,
+    "Dump the operation counters and latencies of a fixed-length database object in the Prometheus text format."},
+  {"path", (PyCFunction)tc_FDB_path, METH_NOARGS,
+    "Get the file path of a fixed-length database object."},
+  {"copy", (PyCFunction)tc_FDB_copy, METH_VARARGS | METH_KEYWORDS,
+    "Copy the database file of a fixed-length database object."},
+  {"rnum", (PyCFunction)tc_FDB_rnum, METH_NOARGS,
+    "Get the number of records of a fixed-length database object."},
+  {"fsiz", (PyCFunction)tc_FDB_fsiz, METH_NOARGS,
+    "Get the size of the database file of a fixed-length database object."},
+  {"min", (PyCFunction)tc_FDB_min, METH_NOARGS,
+    "Get the minimum ID number of records of a fixed-length database object."},
+  {"max", (PyCFunction)tc_FDB_max, METH_NOARGS,
+    "Get the maximum ID number of records of a fixed-length database object."},
+  {"width", (PyCFunction)tc_FDB_width, METH_NOARGS,
+    "Get the width of the value of each record of a fixed-length database object."},
+  {"limsiz", (PyCFunction)tc_FDB_limsiz, METH_NOARGS,
+    "Get the limit file size of a fixed-length database object."},
+  {"limid", (PyCFunction)tc_FDB_limid, METH_NOARGS,
+    "Get the limit ID number of a fixed-length database object."},
+  {"__contains__", (PyCFunction)tc_FDB___contains__, METH_O | METH_COEXIST,
+    NULL},
+  {"__getitem__", (PyCFunction)tc_FDB_subscript, METH_O | METH_COEXIST,
+    NULL},
+  {"has_key", (PyCFunction)tc_FDB___contains__, METH_O,
+    NULL},
+  {"keys", (PyCFunction)tc_FDB_keys, METH_NOARGS,
+    NULL},
+  {"items", (PyCFunction)tc_FDB_items, METH_NOARGS,
+    NULL},
+  {"values", (PyCFunction)tc_FDB_values, METH_NOARGS,
+    NULL},
+  {"iteritems", (PyCFunction)tc_FDB_GetIter_items, METH_NOARGS,
+    NULL},
+  {"iterkeys", (PyCFunction)tc_FDB_GetIter_keys, METH_NOARGS,
+    NULL},
+  {"itervalues", (PyCFunction)tc_FDB_GetIter_values, METH_NOARGS,
+    NULL},
+  {"addint", (PyCFunction)tc_FDB_addint, METH_VARARGS | METH_KEYWORDS,
+    "Add an integer to a record in a fixed-length database object."},
+  {"adddouble", (PyCFunction)tc_FDB_adddouble, METH_VARARGS | METH_KEYWORDS,
+    "Add a real number to a record in a fixed-length database object."},
+  {NULL, NULL, 0, NULL}
+};
+
+
+/* Hack to implement "key in dict" */
+static PySequenceMethods tc_FDB_as_sequence = {
+  0,                             /* sq_length */
+  0,                             /* sq_concat */
+  0,                             /* sq_repeat */
+  0,                             /* sq_item */
+  0,                             /* sq_slice */
+  0,                             /* sq_ass_item */
+  0,                             /* sq_ass_slice */
+  (objobjproc)tc_FDB_Contains,   /* sq_contains */
+  0,                             /* sq_inplace_concat */
+  0,                             /* sq_inplace_repeat */
+};
+
+static PyMappingMethods tc_FDB_as_mapping = {
+  (lenfunc)tc_FDB_length, /* mp_length (inquiry/lenfunc )*/
+  (binaryfunc)tc_FDB_subscript, /* mp_subscript */
+  (objobjargproc)tc_FDB_ass_sub, /* mp_ass_subscript */
+};
+
+PyTypeObject tc_FDBType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.FDB",                                    /* tp_name */
+  sizeof(tc_FDB),                              /* tp_basicsize */
+  0,                                           /* tp_itemsize */
+  (destructor)tc_FDB_dealloc,                  /* tp_dealloc */
+  0,                                           /* tp_print */
+  0,                                           /* tp_getattr */
+  0,                                           /* tp_setattr */
+  0,                                           /* tp_compare */
+  0,                                           /* tp_repr */
+  0,                                           /* tp_as_number */
+  &tc_FDB_as_sequence,                         /* tp_as_sequence */
+  &tc_FDB_as_mapping,                          /* tp_as_mapping */
+  tc_FDB_Hash,                                 /* tp_hash  */
+  0,                                           /* tp_call */
+  0,                                           /* tp_str */
+  0,                                           /* tp_getattro */
+  0,                                           /* tp_setattro */
+  0,                                           /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,    /* tp_flags */
+  "Tokyo Cabinet Fixed-length database",       /* tp_doc */
+  0,                                           /* tp_traverse */
+  0,                                           /* tp_clear */
+  0,                                           /* tp_richcompare */
+  0,                                           /* tp_weaklistoffset */
+  (getiterfunc)tc_FDB_GetIter_keys,            /* tp_iter */
+  0,                                           /* tp_iternext */
+  tc_FDB_methods,                              /* tp_methods */
+  0,                                           /* tp_members */
+  0,                                           /* tp_getset */
+  0,                                           /* tp_base */
+  0,                                           /* tp_dict */
+  0,                                           /* tp_descr_get */
+  0,                                           /* tp_descr_set */
+  0,                                           /* tp_dictoffset */
+  0,                                           /* tp_init */
+  0,                                           /* tp_alloc */
+  tc_FDB_new,                                  /* tp_new */
+};
+
+int tc_FDB_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_FDBType) == 0)
+    return PyModule_AddObject(module, "FDB", (PyObject *)&tc_FDBType);
+  return -1;
+}
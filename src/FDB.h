@@ -0,0 +1,22 @@
+#ifndef PYTC_FDB_H
+#define PYTC_FDB_H
+
+#include "_base.h"
+#include <tcfdb.h>
+#include "Stats.h"
+
+typedef struct {
+  PyObject_HEAD
+  TCFDB *fdb;
+  tc_Stats *stats;
+} tc_FDB;
+
+extern PyTypeObject tc_FDBType;
+
+void tc_Error_SetFDB(TCFDB *fdb);
+
+PyObject *tc_FDB_IdAsObject(uint64_t id);
+
+int tc_FDB_register(PyObject *module);
+
+#endif
@@ -0,0 +1,165 @@
+#include "FDBIterator.h"
+
+/* Public ---------------------------------------------------------------- */
+
+tc_FDBIterator *tc_FDBIterator_new_capi(tc_FDB *fdb, tc_itertype_t itype, int prefetch) {
+  log_trace("ENTER");
+  tc_FDBIterator *self;
+
+  if (!(self = (tc_FDBIterator *)tc_FDBIteratorType.tp_alloc(&tc_FDBIteratorType, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_FDBIterator instance");
+    return NULL;
+  }
+  Py_INCREF(fdb);
+  self->fdb = fdb;
+  self->itype = itype;
+  self->lower = FDBIDMIN;
+  if (!(self->buf = tc_RecBuf_new(prefetch, TC_CODEC_RAW)) ||
+      !(self->ids = PyMem_New(uint64_t, prefetch))) {
+    PyErr_NoMemory();
+    Py_DECREF(self);
+    return NULL;
+  }
+  return self;
+}
+
+static void tc_FDBIterator_dealloc(tc_FDBIterator *self) {
+  log_trace("ENTER");
+  if (self->buf) {
+    tc_RecBuf_del(self->buf);
+  }
+  PyMem_Free(self->ids);
+  Py_XDECREF(self->fdb);
+  PyObject_Del(self);
+}
+
+/* Read the next chunk of records into the buffer. Must be called without
+   the GIL. Records removed between listing the IDs and reading their
+   values are skipped, so a chunk may come back empty before the end. */
+bool tc_FDBIterator_fetch(tc_FDBIterator *self) {
+  TCFDB *fdb = self->fdb->fdb;
+  tc_RecBuf *buf = self->buf;
+  uint64_t *ids;
+  int i, num;
+
+  tc_RecBuf_clear(buf);
+  if (self->done) {
+    return true;
+  }
+  if (!(ids = tcfdbrange(fdb, self->lower, FDBIDMAX, buf->cap, &num))) {
+    return false;
+  }
+  for (i = 0; i < num; i++) {
+    if (self->itype == tc_iter_key_t) {
+      tc_RecBuf_push(buf, "", 0, NULL, 0);
+    } else {
+      int value_len;
+      void *value = tcfdbget(fdb, ids[i], &value_len);
+      if (!value) {
+        continue;
+      }
+      tc_RecBuf_push(buf, "", 0, value, value_len);
+      free(value);
+    }
+    self->ids[buf->num - 1] = ids[i];
+  }
+  if (num < buf->cap) {
+    self->done = true;
+  } else {
+    self->lower = ids[num - 1] + 1;
+  }
+  free(ids);
+  return true;
+}
+
+/* New reference to the ID, the value or an (ID, value) tuple of record i
+   of the current chunk */
+PyObject *tc_FDBIterator_get(tc_FDBIterator *self, int i) {
+  PyObject *id, *value, *item;
+
+  if (self->itype == tc_iter_key_t) {
+    return tc_FDB_IdAsObject(self->ids[i]);
+  } else if (self->itype == tc_iter_value_t) {
+    return tc_RecBuf_get(self->buf, i, tc_iter_value_t);
+  }
+  if (!(item = PyTuple_New(2))) {
+    return NULL;
+  }
+  if (!(id = tc_FDB_IdAsObject(self->ids[i])) ||
+      !(value = tc_RecBuf_get(self->buf, i, tc_iter_value_t))) {
+    Py_XDECREF(id);
+    Py_DECREF(item);
+    return NULL;
+  }
+  PyTuple_SET_ITEM(item, 0, id);
+  PyTuple_SET_ITEM(item, 1, value);
+  return item;
+}
+
+static PyObject *tc_FDBIterator_iternext(tc_FDBIterator *self) {
+  log_trace("ENTER");
+  tc_RecBuf *buf = self->buf;
+
+  while (buf->pos >= buf->num) {
+    bool result;
+    tc_StatsTimer timer;
+    if (self->done) {
+      return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    TC_STATS_CALL(timer, result = tc_FDBIterator_fetch(self));
+    Py_END_ALLOW_THREADS
+    tc_Stats_record(self->fdb->stats, TC_OP_ITER, &timer, 0,
+                    tcxstrsize(buf->arena), result);
+    if (!result) {
+      tc_Error_SetFDB(self->fdb->fdb);
+      return NULL;
+    }
+  }
+  return tc_FDBIterator_get(self, buf->pos++);
+}
+
+/* Type ------------------------------------------------------------------ */
+
+PyTypeObject tc_FDBIteratorType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.FDBIterator",                         /* tp_name */
+  sizeof(tc_FDBIterator),                   /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)tc_FDBIterator_dealloc,       /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  0,                                        /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash  */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,                       /* tp_flags */
+  "Tokyo Cabinet fixed-length database iterator", /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  PyObject_SelfIter,                        /* tp_iter */
+  (iternextfunc)tc_FDBIterator_iternext,    /* tp_iternext */
+  0,                                        /* tp_methods */
+};
+
+int tc_FDBIterator_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_FDBIteratorType) == 0)
+    return PyModule_AddObject(module, "FDBIterator", (PyObject *)&tc_FDBIteratorType);
+  return -1;
+}
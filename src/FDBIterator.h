@@ -0,0 +1,30 @@
+#ifndef PYTC_FDBITERATOR_H
+#define PYTC_FDBITERATOR_H
+
+#include "_base.h"
+#include <tcfdb.h>
+#include "FDB.h"
+#include "util.h"
+
+/* An iterator of a fixed-length database object. IDs are read in
+   ascending order with tcfdbrange, a chunk at a time, so tc's own
+   iterator is left alone and any number of iterators can be in use. */
+typedef struct {
+  PyObject_HEAD
+  tc_FDB *fdb;
+  tc_itertype_t itype;
+  tc_RecBuf *buf;   /* values of the current chunk */
+  uint64_t *ids;    /* IDs of the current chunk */
+  int64_t lower;    /* first ID of the next chunk */
+  bool done;
+} tc_FDBIterator;
+
+extern PyTypeObject tc_FDBIteratorType;
+
+tc_FDBIterator *tc_FDBIterator_new_capi(tc_FDB *fdb, tc_itertype_t itype, int prefetch);
+bool tc_FDBIterator_fetch(tc_FDBIterator *self);
+PyObject *tc_FDBIterator_get(tc_FDBIterator *self, int i);
+
+int tc_FDBIterator_register(PyObject *module);
+
+#endif
@@ -1,9 +1,11 @@
 #include "HDB.h"
+#include "HDBIterator.h"
+#include "Transaction.h"
 #include "util.h"
 
 /* Private --------------------------------------------------------------- */
 
-static void tc_Error_SetHDB(TCHDB *hdb) {
+void tc_Error_SetHDB(TCHDB *hdb) {
   log_trace("ENTER");
   int ecode = tchdbecode(hdb);
   if (ecode == TCENOREC) {
@@ -13,6 +15,90 @@ static void tc_Error_SetHDB(TCHDB *hdb) {
   }
 }
 
+void tc_HDBPos_init(tc_HDBPos *pos) {
+  pos->nextkey = tcxstrnew();
+  pos->kxstr = tcxstrnew();
+  pos->vxstr = tcxstrnew();
+  tc_HDBPos_reset(pos);
+}
+
+void tc_HDBPos_reset(tc_HDBPos *pos) {
+  pos->started = pos->done = pos->lost = false;
+}
+
+/* Read the next chunk of records into buf, and the key of the record
+   after it to resume from. Must be called with the iterlock held, and may
+   be called without the GIL. Returns false on errors other than running
+   off the end. */
+bool tc_HDBPos_read(tc_HDBPos *pos, TCHDB *hdb, tc_RecBuf *buf, tc_itertype_t itype) {
+  bool full;
+  char *key;
+  int key_len;
+
+  tc_RecBuf_clear(buf);
+  if (pos->done) {
+    return true;
+  }
+  if (!pos->started) {
+    if (!tchdbiterinit(hdb)) {
+      return false;
+    }
+    pos->started = true;
+  } else if (!tchdbiterinit2(hdb, tcxstrptr(pos->nextkey), tcxstrsize(pos->nextkey))) {
+    pos->lost = tchdbecode(hdb) == TCENOREC;
+    return false;
+  }
+  for (;;) {
+    full = tc_RecBuf_full(buf);
+    if (full || itype == tc_iter_key_t) {
+      if (!(key = tchdbiternext(hdb, &key_len))) {
+        break;
+      }
+      if (full) {
+        /* not handed out yet, so it may only be removed by someone else */
+        tcxstrclear(pos->nextkey);
+        tcxstrcat(pos->nextkey, key, key_len);
+        free(key);
+        return true;
+      }
+      tc_RecBuf_push(buf, key, key_len, NULL, 0);
+      free(key);
+    } else {
+      if (!tchdbiternext3(hdb, pos->kxstr, pos->vxstr)) {
+        break;
+      }
+      tc_RecBuf_push(buf, tcxstrptr(pos->kxstr), tcxstrsize(pos->kxstr),
+                     tcxstrptr(pos->vxstr), tcxstrsize(pos->vxstr));
+    }
+  }
+  if (tchdbecode(hdb) != TCENOREC) {
+    return false;
+  }
+  pos->done = true;
+  return true;
+}
+
+void tc_HDBPos_SetError(tc_HDBPos *pos, TCHDB *hdb) {
+  if (pos->lost) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "the record to resume iterating from was removed");
+  } else {
+    tc_Error_SetHDB(hdb);
+  }
+}
+
+void tc_HDBPos_clear(tc_HDBPos *pos) {
+  if (pos->nextkey) {
+    tcxstrdel(pos->nextkey);
+  }
+  if (pos->kxstr) {
+    tcxstrdel(pos->kxstr);
+  }
+  if (pos->vxstr) {
+    tcxstrdel(pos->vxstr);
+  }
+}
+
 #define tc_HDB_TUNE_OR_OPT(a,b,c) \
   static PyObject * \
   a(tc_HDB *self, PyObject *args, PyObject *keywds) { \
@@ -43,6 +129,27 @@ static void tc_Error_SetHDB(TCHDB *hdb) {
 
 /* Public --------------------------------------------------------------- */
 
+/* Tuning parameters in effect, Tokyo Cabinet's defaults for those not set.
+   Also used for the hash databases under BDB and TDB. */
+PyObject *tc_HDB_Tuning(TCHDB *hdb) {
+  PyObject *dict;
+
+  if (!(dict = PyDict_New())) {
+    return NULL;
+  }
+  if (tc_Dict_SetLongLong(dict, "bnum", hdb->bnum) ||
+      tc_Dict_SetLongLong(dict, "apow", hdb->apow) ||
+      tc_Dict_SetLongLong(dict, "fpow", hdb->fpow) ||
+      tc_Dict_SetLongLong(dict, "opts", hdb->opts) ||
+      tc_Dict_SetLongLong(dict, "rcnum", hdb->rcnum) ||
+      tc_Dict_SetLongLong(dict, "xmsiz", hdb->xmsiz) ||
+      tc_Dict_SetLongLong(dict, "dfunit", hdb->dfunit)) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  return dict;
+}
+
 static long tc_HDB_Hash(PyObject *self) {
   log_trace("ENTER");
   PyErr_SetString(PyExc_TypeError, "HDB objects are unhashable");
@@ -76,6 +183,14 @@ static void tc_HDB_dealloc(tc_HDB *self) {
     tchdbdel(self->hdb);
     Py_END_ALLOW_THREADS
   }
+  if (self->iterlock) {
+    PyThread_free_lock(self->iterlock);
+  }
+  tc_HDBPos_clear(&self->iterpos);
+  if (self->iterbuf) {
+    tc_RecBuf_del(self->iterbuf);
+  }
+  tc_Stats_del(self->stats);
   PyObject_Del(self);
 }
 
@@ -93,13 +208,22 @@ static PyObject *tc_HDB_new(PyTypeObject *type, PyObject *args, PyObject *keywds
     PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_HDB instance");
     return NULL;
   }
-  if ((self->hdb = tchdbnew())) {
+  tc_HDBPos_init(&self->iterpos);
+  if (!(self->iterlock = PyThread_allocate_lock())) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc iterator lock");
+  } else if (!(self->iterbuf = tc_RecBuf_new(1, TC_CODEC_RAW))) {
+    /* exception set by tc_RecBuf_new */
+  } else if (!(self->stats = tc_Stats_new())) {
+    /* exception set by tc_Stats_new */
+  } else if ((self->hdb = tchdbnew())) {
     int omode = 0;
     char *path = NULL;
-    static char *kwlist[] = {"path", "omode", NULL};
+    PyObject *codec = NULL;
+    static char *kwlist[] = {"path", "omode", "codec", NULL};
 
-    if (PyArg_ParseTupleAndKeywords(args, keywds, "|si:open", kwlist,
-                                    &path, &omode)) {
+    if (PyArg_ParseTupleAndKeywords(args, keywds, "|siO:open", kwlist,
+                                    &path, &omode, &codec) &&
+        tc_Codec_FromObject(codec, &self->codec) == 0) {
       if (path && omode) {
         bool result;
         Py_BEGIN_ALLOW_THREADS
@@ -127,75 +251,149 @@ static PyObject *tc_HDB_ecode(tc_HDB *self) {
 
 TC_BOOL_NOARGS(tc_HDB_setmutex,tc_HDB,tchdbsetmutex,hdb,tc_Error_SetHDB,hdb);
 tc_HDB_TUNE_OR_OPT(tc_HDB_tune, tune, tchdbtune);
+TC_BOOL_INT_ARG(tc_HDB_setcache,tc_HDB,setcache,rcnum,tchdbsetcache,hdb,tc_Error_SetHDB);
+TC_BOOL_LONG_LONG_ARG(tc_HDB_setxmsiz,tc_HDB,setxmsiz,xmsiz,tchdbsetxmsiz,hdb,tc_Error_SetHDB);
+TC_BOOL_INT_ARG(tc_HDB_setdfunit,tc_HDB,setdfunit,dfunit,tchdbsetdfunit,hdb,tc_Error_SetHDB);
+TC_XDB_defrag(tc_HDB_defrag,tc_HDB,tchdbdefrag,hdb,tc_Error_SetHDB);
+
+static PyObject *tc_HDB_tuning(tc_HDB *self) {
+  log_trace("ENTER");
+  return tc_HDB_Tuning(self->hdb);
+}
+
 TC_XDB_OPEN(tc_HDB_open,tc_HDB,tc_HDB_new,tchdbopen,hdb,tc_HDB_dealloc,tc_Error_SetHDB);
 TC_BOOL_NOARGS(tc_HDB_close,tc_HDB,tchdbclose,hdb,tc_Error_SetHDB,hdb);
-TC_XDB_PUT(tc_HDB_put, tc_HDB, put, tchdbput, hdb, tc_Error_SetHDB);
-TC_XDB_PUT(tc_HDB_putkeep, tc_HDB, putkeep, tchdbputkeep, hdb, tc_Error_SetHDB);
-TC_XDB_PUT(tc_HDB_putcat, tc_HDB, putcat, tchdbputcat, hdb, tc_Error_SetHDB);
-TC_XDB_PUT(tc_HDB_putasync, tc_HDB, putasync, tchdbputasync, hdb, tc_Error_SetHDB);
-TC_BOOL_KEYARGS(tc_HDB_out,tc_HDB,out,tchdbout,hdb,tc_Error_SetHDB,hdb);
-TC_STRINGL_KEYARGS(tc_HDB_get,tc_HDB,get,tchdbget,hdb,tc_Error_SetHDB);
-TC_INT_KEYARGS(tc_HDB_vsiz,tc_HDB,vsiz,tchdbvsiz,hdb,tc_Error_SetHDB);
+TC_XDB_PUT(tc_HDB_put, tc_HDB, put, tchdbput, hdb, tc_Error_SetHDB, false);
+TC_XDB_PUT(tc_HDB_putkeep, tc_HDB, putkeep, tchdbputkeep, hdb, tc_Error_SetHDB, false);
+TC_XDB_PUT(tc_HDB_putcat, tc_HDB, putcat, tchdbputcat, hdb, tc_Error_SetHDB, true);
+TC_XDB_PUT(tc_HDB_putasync, tc_HDB, putasync, tchdbputasync, hdb, tc_Error_SetHDB, false);
+TC_XDB_putmany(tc_HDB_putmany, tc_HDB, putmany, tchdbput, tchdbputkeep, tchdbputcat,
+               tchdbtranbegin, tchdbtrancommit, tchdbtranabort, tchdbecode, hdb, tc_Error_SetHDB);
+TC_BOOL_KEYARGS(tc_HDB_out,tc_HDB,out,tchdbout,hdb,tc_Error_SetHDB,hdb,TC_OP_OUT);
+TC_STRINGL_KEYARGS(tc_HDB_get,tc_HDB,get,tchdbget,hdb,tc_Error_SetHDB,TC_OP_GET);
+TC_XDB_getmany(tc_HDB_getmany,tc_HDB,getmany,tchdbget,tchdbecode,hdb,tc_Error_SetHDB);
+
+/* Read the value of a record straight into a writable buffer, skipping the
+   intermediate bytes object. Returns the size of the value. */
+static PyObject *tc_HDB_get_into(tc_HDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len, value_len, full_len = -1;
+  tc_buffer_t buffer;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"key", "buffer", NULL};
+
+  /* an encoded value in the buffer would be of no use */
+  if (self->codec != TC_CODEC_RAW) {
+    PyErr_SetString(PyExc_ValueError, "get_into can't be used with a codec");
+    return NULL;
+  }
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#" TC_WBUFFER_FMT ":get_into", kwlist,
+                                   &key, &key_len, TC_BUFFER_ARGS(buffer)) ||
+      tc_Buffer_Check(&buffer) != 0) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, value_len = tchdbget3(self->hdb, key, key_len, TC_BUFFER_BUF(buffer),
+                                             TC_BUFFER_LEN(buffer)));
+  /* tc silently clips the value to the buffer, which is then left
+     partly written */
+  if (value_len == TC_BUFFER_LEN(buffer)) {
+    full_len = tchdbvsiz(self->hdb, key, key_len);
+  }
+  Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(buffer);
+  tc_Stats_record(self->stats, TC_OP_GET, &timer, key_len,
+                  value_len == -1 ? 0 : value_len, value_len != -1);
+
+  if (value_len == -1) {
+    tc_Error_SetHDB(self->hdb);
+    return NULL;
+  }
+  if (full_len > value_len) {
+    PyErr_Format(PyExc_ValueError, "buffer too small for a value of %d bytes", full_len);
+    return NULL;
+  }
+  return NUMBER_FromLong((long)value_len);
+}
 
-TC_BOOL_NOARGS(tc_HDB_iterinit,tc_HDB,tchdbiterinit,hdb,tc_Error_SetHDB,hdb);
+TC_INT_KEYARGS(tc_HDB_vsiz,tc_HDB,vsiz,tchdbvsiz,hdb,tc_Error_SetHDB);
 
-static PyObject *tc_HDB_GetIter(tc_HDB *self, tc_itertype_t itype) {
+/* The iterator of iterinit() and iternext(), shared by everyone calling
+   them. It reads one key at a time, like tc's own, so that it sees changes
+   to the database as soon as they are made. */
+static PyObject *tc_HDB_iterinit(tc_HDB *self) {
   log_trace("ENTER");
-  if (tc_HDB_iterinit(self)) {
-    Py_INCREF(self);
-    /* hack */
-    if (self->hold_itype) {
-      self->hold_itype = false;
-    } else {
-      self->itype = itype;
-      if (itype != tc_iter_key_t) {
-        self->hold_itype = true;
-      }
-    }
-    return (PyObject *)self;
+  bool result;
+
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->iterlock, WAIT_LOCK);
+  if ((result = tchdbiterinit(self->hdb))) {
+    tc_HDBPos_reset(&self->iterpos);
   }
-  return NULL;
-}
+  PyThread_release_lock(self->iterlock);
+  Py_END_ALLOW_THREADS
 
-TC_XDB_iters(tc_HDB,tc_HDB_GetIter_keys,tc_HDB_GetIter_values,tc_HDB_GetIter_items,tc_HDB_GetIter);
+  if (!result) {
+    tc_Error_SetHDB(self->hdb);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
 
 static PyObject *tc_HDB_iternext(tc_HDB *self) {
   log_trace("ENTER");
-  if (self->itype == tc_iter_key_t) {
-    void *key;
-    int key_len;
-
-    Py_BEGIN_ALLOW_THREADS
-    key = tchdbiternext(self->hdb, &key_len);
-    Py_END_ALLOW_THREADS
+  PyObject *ret;
+  char *key = NULL;
+  int key_len;
+  bool result;
+  tc_RecBuf *buf = self->iterbuf;
+
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->iterlock, WAIT_LOCK);
+  if ((result = tc_HDBPos_read(&self->iterpos, self->hdb, buf, tc_iter_key_t)) &&
+      buf->num > 0) {
+    key_len = buf->ksizs[0];
+    key = tcmemdup(tcxstrptr(buf->arena) + buf->koffs[0], key_len);
+  }
+  PyThread_release_lock(self->iterlock);
+  Py_END_ALLOW_THREADS
 
-    if (key) {
-      PyObject *_key;
-      _key = PyBytes_FromStringAndSize(key, key_len);
-      free(key);
-      return _key;
-    }
+  if (!result) {
+    tc_HDBPos_SetError(&self->iterpos, self->hdb);
+    return NULL;
+  }
+  if (!key) {
+    /* tc's own iterator raises KeyError at the end */
+    PyErr_SetString(PyExc_KeyError, tchdberrmsg(TCENOREC));
     return NULL;
-  } else {
-    TC_GET_TCXSTR_KEY_VALUE(tchdbiternext3,self->hdb)
-    if (result) {
-      if (self->itype == tc_iter_value_t) {
-        ret = PyBytes_FromStringAndSize(tcxstrptr(value), tcxstrsize(value));
-      } else {
-        ret = Py_BuildValue("(s#s#)", tcxstrptr(key), tcxstrsize(key),
-                                      tcxstrptr(value), tcxstrsize(value));
-      }
-    }
-    TC_CLEAR_TCXSTR_KEY_VALUE()
   }
+  ret = PyBytes_FromStringAndSize(key, key_len);
+  free(key);
+  return ret;
+}
+
+/* Every iterator has a position of its own */
+static PyObject *tc_HDB_GetIter(tc_HDB *self, tc_itertype_t itype) {
+  log_trace("ENTER");
+  return (PyObject *)tc_HDBIterator_new_capi(self, itype, TC_ITER_PREFETCH);
 }
 
+TC_XDB_iters(tc_HDB,tc_HDB_GetIter_keys,tc_HDB_GetIter_values,tc_HDB_GetIter_items,tc_HDB_GetIter);
+
 TC_BOOL_NOARGS(tc_HDB_sync,tc_HDB,tchdbsync,hdb,tc_Error_SetHDB,hdb);
 tc_HDB_TUNE_OR_OPT(tc_HDB_optimize, optimize, tchdboptimize);
 TC_STRING_NOARGS(tc_HDB_path,tc_HDB,tchdbpath,hdb,tc_Error_SetHDB);
 TC_U_LONG_LONG_NOARGS(tc_HDB_rnum, tc_HDB, tchdbrnum, hdb, tchdbecode, tc_Error_SetHDB);
 TC_U_LONG_LONG_NOARGS(tc_HDB_fsiz, tc_HDB, tchdbrnum, hdb, tchdbecode, tc_Error_SetHDB);
 TC_BOOL_NOARGS(tc_HDB_vanish,tc_HDB,tchdbvanish,hdb,tc_Error_SetHDB,hdb);
+TC_XDB_tran(tc_HDB_tranbegin,tc_HDB,tchdbtranbegin,hdb,tc_Error_SetHDB,true);
+TC_XDB_tran(tc_HDB_trancommit,tc_HDB,tchdbtrancommit,hdb,tc_Error_SetHDB,false);
+TC_XDB_tran(tc_HDB_tranabort,tc_HDB,tchdbtranabort,hdb,tc_Error_SetHDB,false);
+TC_XDB_transaction(tc_HDB_transaction,tc_HDB);
+TC_XDB_stats(tc_HDB_stats,tc_HDB);
+TC_XDB_prometheus(tc_HDB_prometheus,tc_HDB);
+TC_XDB_setcodec(tc_HDB_setcodec,tc_HDB);
 TC_BOOL_PATHARGS(tc_HDB_copy, tc_HDB, copy, tchdbcopy, hdb, tc_Error_SetHDB);
 /* todo: features for experts */
 TC_XDB_Contains(tc_HDB_Contains,tc_HDB,tchdbvsiz,hdb);
@@ -203,122 +401,57 @@ TC_XDB___contains__(tc_HDB___contains__,tc_HDB,tc_HDB_Contains);
 TC_XDB___getitem__(tc_HDB___getitem__,tc_HDB,tchdbget,hdb,tc_Error_SetHDB);
 TC_XDB_rnum(TCHDB_rnum,TCHDB,tchdbrnum);
 
-static PyObject *tc_HDB_keys(tc_HDB *self) {
+/* Walk the whole database, TC_SCAN_SIZE records per GIL release, and
+   collect keys, values or items into a list */
+static PyObject *tc_HDB_scan(tc_HDB *self, tc_itertype_t itype) {
   log_trace("ENTER");
+  PyObject *ret, *obj;
+  tc_HDBIterator *iter;
+  bool result;
+  tc_StatsTimer timer;
   int i;
-  PyObject *ret;
-  if (!tc_HDB_iterinit((tc_HDB *)self) ||
-      !(ret = PyList_New(TCHDB_rnum(self->hdb)))) {
-    return NULL;
-  }
-  for (i = 0; ; i++) {
-    char *key;
-    int key_len;
-    PyObject *_key;
-
-    Py_BEGIN_ALLOW_THREADS
-    key = tchdbiternext(self->hdb, &key_len);
-    Py_END_ALLOW_THREADS
-    if (!key) { break; }
-    _key = PyBytes_FromStringAndSize(key, key_len);
-    free(key);
-    if (!_key) {
-      Py_DECREF(ret);
-      return NULL;
-    }
-    PyList_SET_ITEM(ret, i, _key);
-  }
-  return ret;
-}
 
-static PyObject *tc_HDB_items(tc_HDB *self) {
-  log_trace("ENTER");
-  int i, n = TCHDB_rnum(self->hdb);
-  PyObject *ret, *item;
-  if (!tc_HDB_iterinit((tc_HDB *)self) ||
-      !(ret = PyList_New(n))) {
+  if (!(iter = tc_HDBIterator_new_capi(self, itype, TC_SCAN_SIZE))) {
     return NULL;
   }
-  for (i = 0; i < n; i++) {
-    if (!(item = PyTuple_New(2))) {
-      Py_DECREF(ret);
-      return NULL;
-    }
-    PyList_SET_ITEM(ret, i, item);
+  if (!(ret = PyList_New(0))) {
+    Py_DECREF(iter);
+    return NULL;
   }
-  for (i = 0; ; i++) {
-    char *key, *value;
-    int key_len, value_len;
-
-    Py_BEGIN_ALLOW_THREADS
-    key = tchdbiternext(self->hdb, &key_len);
-    Py_END_ALLOW_THREADS
-    if (!key) { break; }
-
+  do {
     Py_BEGIN_ALLOW_THREADS
-    value = tchdbget(self->hdb, key, key_len, &value_len);
+    TC_STATS_CALL(timer, result = tc_HDBIterator_fetch(iter));
     Py_END_ALLOW_THREADS
-
-    if (value) {
-      PyObject *_key, *_value;
-      _key = PyBytes_FromStringAndSize(key, key_len);
-      free(key);
-      if (!_key) {
-        Py_DECREF(ret);
-        return NULL;
-      }
-      _value = PyBytes_FromStringAndSize(value, value_len);
-      free(value);
-      if (!_value) {
-        Py_DECREF(_key);
-        Py_DECREF(ret);
-        return NULL;
+    tc_Stats_record(self->stats, TC_OP_ITER, &timer, 0,
+                    tcxstrsize(iter->buf->arena), result);
+    if (!result) {
+      tc_HDBPos_SetError(&iter->pos, self->hdb);
+      Py_CLEAR(ret);
+      break;
+    }
+    for (i = 0; i < iter->buf->num; i++) {
+      if (!(obj = tc_RecBuf_get(iter->buf, i, itype)) || PyList_Append(ret, obj) != 0) {
+        Py_XDECREF(obj);
+        Py_CLEAR(ret);
+        break;
       }
-      item = PyList_GET_ITEM(ret, i);
-      PyTuple_SET_ITEM(item, 0, _key);
-      PyTuple_SET_ITEM(item, 1, _value);
-    } else {
-      free(key);
+      Py_DECREF(obj);
     }
-  }
+  } while (ret && iter->buf->num > 0);
+  Py_DECREF(iter);
   return ret;
 }
 
-static PyObject *tc_HDB_values(tc_HDB *self) {
-  log_trace("ENTER");
-  int i;
-  PyObject *ret;
-  if (!tc_HDB_iterinit((tc_HDB *)self) ||
-      !(ret = PyList_New(TCHDB_rnum(self->hdb)))) {
-    return NULL;
-  }
-  for (i = 0; ; i++) {
-    char *key, *value;
-    int key_len, value_len;
-
-    Py_BEGIN_ALLOW_THREADS
-    key = tchdbiternext(self->hdb, &key_len);
-    Py_END_ALLOW_THREADS
+static PyObject *tc_HDB_keys(tc_HDB *self) {
+  return tc_HDB_scan(self, tc_iter_key_t);
+}
 
-    if (!key) { break; }
+static PyObject *tc_HDB_items(tc_HDB *self) {
+  return tc_HDB_scan(self, tc_iter_item_t);
+}
 
-    Py_BEGIN_ALLOW_THREADS
-    value = tchdbget(self->hdb, key, key_len, &value_len);
-    Py_END_ALLOW_THREADS
-    free(key);
-
-    if (value) {
-      PyObject *_value;
-      _value = PyBytes_FromStringAndSize(value, value_len);
-      free(value);
-      if (!_value) {
-        Py_DECREF(ret);
-        return NULL;
-      }
-      PyList_SET_ITEM(ret, i, _value);
-    }
-  }
-  return ret;
+static PyObject *tc_HDB_values(tc_HDB *self) {
+  return tc_HDB_scan(self, tc_iter_value_t);
 }
 
 TC_XDB_length(tc_HDB_length,tc_HDB,TCHDB_rnum,hdb);
@@ -338,8 +471,20 @@ static PyMethodDef tc_HDB_methods[] = {
     "Get the last happened error code of a hash database object."},
   {"setmutex", (PyCFunction)tc_HDB_setmutex, METH_NOARGS,
     "Set mutual exclusion control of a hash database object for threading."},
+  {"setcodec", (PyCFunction)tc_HDB_setcodec, METH_VARARGS | METH_KEYWORDS,
+    "Set the codec of the values of a hash database object, None or 'raw' for bytes, 'tc' for Python objects."},
   {"tune", (PyCFunction)tc_HDB_tune, METH_VARARGS | METH_KEYWORDS,
     "Set the tuning parameters of a hash database object."},
+  {"setcache", (PyCFunction)tc_HDB_setcache, METH_VARARGS | METH_KEYWORDS,
+    "Set the maximum number of records to be cached of a hash database object."},
+  {"setxmsiz", (PyCFunction)tc_HDB_setxmsiz, METH_VARARGS | METH_KEYWORDS,
+    "Set the size of the extra mapped memory of a hash database object."},
+  {"setdfunit", (PyCFunction)tc_HDB_setdfunit, METH_VARARGS | METH_KEYWORDS,
+    "Set the unit step number of auto defragmentation of a hash database object."},
+  {"defrag", (PyCFunction)tc_HDB_defrag, METH_VARARGS | METH_KEYWORDS,
+    "Defragment step records of a hash database object, or the whole file if step is 0."},
+  {"tuning", (PyCFunction)tc_HDB_tuning, METH_NOARGS,
+    "Get a dict of the tuning and cache parameters in effect of a hash database object."},
   {"open", (PyCFunction)tc_HDB_open, METH_VARARGS | METH_KEYWORDS,
     "Open a database file and connect a hash database object."},
   {"close", (PyCFunction)tc_HDB_close, METH_NOARGS,
@@ -352,22 +497,43 @@ static PyMethodDef tc_HDB_methods[] = {
     "Concatenate a value at the end of the existing record in a hash database object."},
   {"putasync", (PyCFunction)tc_HDB_putasync, METH_VARARGS | METH_KEYWORDS,
     "Store a record into a hash database object in asynchronous fashion."},
+  {"putmany", (PyCFunction)tc_HDB_putmany, METH_VARARGS | METH_KEYWORDS,
+    "Store records from a mapping or from (key, value) pairs into a hash database object.\n"
+   "mode is 'put', 'keep' or 'cat'. Returns the number of records stored."},
   {"out", (PyCFunction)tc_HDB_out, METH_VARARGS | METH_KEYWORDS,
     "Remove a record of a hash database object."},
   {"get", (PyCFunction)tc_HDB_get, METH_VARARGS | METH_KEYWORDS,
     "Retrieve a record in a hash database object."},
+  {"get_into", (PyCFunction)tc_HDB_get_into, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record in a hash database object into a writable buffer.\n"
+   "Returns the size of the value. ValueError is raised if the buffer is too small."},
+  {"getmany", (PyCFunction)tc_HDB_getmany, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve the records of several keys in a hash database object.\n"
+   "Returns a list of values in the order of the keys, missing records being replaced by default."},
   {"vsiz", (PyCFunction)tc_HDB_vsiz, METH_VARARGS | METH_KEYWORDS,
     "Get the size of the value of a record in a hash database object."},
   {"iterinit", (PyCFunction)tc_HDB_iterinit, METH_NOARGS,
     "Initialize the iterator of a hash database object."},
   {"iternext", (PyCFunction)tc_HDB_iternext, METH_NOARGS,
-    "Get the next extensible objects of the iterator of a hash database object."},
+    "Get the next key of the iterator of a hash database object."},
   {"sync", (PyCFunction)tc_HDB_sync, METH_NOARGS,
     "Synchronize updated contents of a hash database object with the file and the device."},
   {"optimize", (PyCFunction)tc_HDB_optimize, METH_VARARGS | METH_KEYWORDS,
     "Optimize the file of a hash database object."},
   {"vanish", (PyCFunction)tc_HDB_vanish, METH_NOARGS,
     "Remove all records of a hash database object."},
+  {"tranbegin", (PyCFunction)tc_HDB_tranbegin, METH_NOARGS,
+    "Begin the transaction of a hash database object."},
+  {"trancommit", (PyCFunction)tc_HDB_trancommit, METH_NOARGS,
+    "Commit the transaction of a hash database object."},
+  {"tranabort", (PyCFunction)tc_HDB_tranabort, METH_NOARGS,
+    "Abort the transaction of a hash database object."},
+  {"transaction", (PyCFunction)tc_HDB_transaction, METH_NOARGS,
+    "Get a context manager running a block in a transaction of a hash database object."},
+  {"stats", (PyCFunction)tc_HDB_stats, METH_VARARGS | METH_KEYWORDS,
+    "Get a dict of the operation counters and latencies of a hash database object."},
+  {"prometheus", (PyCFunction)tc_HDB_prometheus, METH_VARARGS | METH_KEYWORDS,
+    "Dump the operation counters and latencies of a hash database object in the Prometheus text format."},
   {"path", (PyCFunction)tc_HDB_path, METH_NOARGS,
     "Get the file path of a hash database object."},
   {"copy", (PyCFunction)tc_HDB_copy, METH_VARARGS | METH_KEYWORDS,
@@ -454,7 +620,7 @@ PyTypeObject tc_HDBType = {
   0,                                           /* tp_richcompare */
   0,                                           /* tp_weaklistoffset */
   (getiterfunc)tc_HDB_GetIter_keys,           /* tp_iter */
-  (iternextfunc)tc_HDB_iternext,              /* tp_iternext */
+  0,                                           /* tp_iternext */
   tc_HDB_methods,                             /* tp_methods */
   0,                                           /* tp_members */
   0,                                           /* tp_getset */
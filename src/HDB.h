@@ -2,17 +2,48 @@
 #define PYTC_HDB_H
 
 #include "_base.h"
+#include <pythread.h>
 #include <tchdb.h>
+#include "Stats.h"
+#include "Codec.h"
+#include "util.h"
+
+/* Position of an iteration over a hash database. tc has a single iterator
+   per handle, which is moved to nextkey, the first record not read yet, at
+   the start of each chunk under the handle's iterlock. Resuming by key, and
+   never by offset, keeps iterations valid whatever removals or
+   defragmentation do to the file in between. */
+typedef struct {
+  TCXSTR *nextkey;
+  TCXSTR *kxstr;
+  TCXSTR *vxstr;
+  bool started;
+  bool done;
+  bool lost;    /* nextkey was removed before the iteration got to it */
+} tc_HDBPos;
 
 typedef struct {
   PyObject_HEAD
   TCHDB	*hdb;
-  tc_itertype_t itype;
-  bool hold_itype;
+  PyThread_type_lock iterlock; /* serializes use of tc's iterator */
+  tc_HDBPos iterpos;           /* position of iterinit() and iternext() */
+  tc_RecBuf *iterbuf;
+  tc_Stats *stats;
+  tc_codec_t codec;             /* encoding of values */
+  bool intran;                  /* a transaction was begun by tranbegin() */
 } tc_HDB;
 
 extern PyTypeObject tc_HDBType;
 
+void tc_Error_SetHDB(TCHDB *hdb);
+
+void tc_HDBPos_init(tc_HDBPos *pos);
+void tc_HDBPos_reset(tc_HDBPos *pos);
+bool tc_HDBPos_read(tc_HDBPos *pos, TCHDB *hdb, tc_RecBuf *buf, tc_itertype_t itype);
+void tc_HDBPos_SetError(tc_HDBPos *pos, TCHDB *hdb);
+void tc_HDBPos_clear(tc_HDBPos *pos);
+PyObject *tc_HDB_Tuning(TCHDB *hdb);
+
 int tc_HDB_register(PyObject *module);
 
 #endif
@@ -0,0 +1,111 @@
+#include "HDBIterator.h"
+
+/* Public ---------------------------------------------------------------- */
+
+tc_HDBIterator *tc_HDBIterator_new_capi(tc_HDB *hdb, tc_itertype_t itype, int prefetch) {
+  log_trace("ENTER");
+  tc_HDBIterator *self;
+
+  if (!(self = (tc_HDBIterator *)tc_HDBIteratorType.tp_alloc(&tc_HDBIteratorType, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_HDBIterator instance");
+    return NULL;
+  }
+  Py_INCREF(hdb);
+  self->hdb = hdb;
+  self->itype = itype;
+  if (!(self->buf = tc_RecBuf_new(prefetch, hdb->codec))) {
+    Py_DECREF(self);
+    return NULL;
+  }
+  tc_HDBPos_init(&self->pos);
+  return self;
+}
+
+static void tc_HDBIterator_dealloc(tc_HDBIterator *self) {
+  log_trace("ENTER");
+  if (self->buf) {
+    tc_RecBuf_del(self->buf);
+  }
+  tc_HDBPos_clear(&self->pos);
+  Py_XDECREF(self->hdb);
+  PyObject_Del(self);
+}
+
+/* Read the next chunk of records into the buffer. Must be called without
+   the GIL. Returns false on errors other than running off the end. */
+bool tc_HDBIterator_fetch(tc_HDBIterator *self) {
+  bool result;
+
+  PyThread_acquire_lock(self->hdb->iterlock, WAIT_LOCK);
+  result = tc_HDBPos_read(&self->pos, self->hdb->hdb, self->buf, self->itype);
+  PyThread_release_lock(self->hdb->iterlock);
+  return result;
+}
+
+static PyObject *tc_HDBIterator_iternext(tc_HDBIterator *self) {
+  log_trace("ENTER");
+  tc_RecBuf *buf = self->buf;
+
+  if (buf->pos >= buf->num) {
+    bool result;
+    tc_StatsTimer timer;
+    Py_BEGIN_ALLOW_THREADS
+    TC_STATS_CALL(timer, result = tc_HDBIterator_fetch(self));
+    Py_END_ALLOW_THREADS
+    tc_Stats_record(self->hdb->stats, TC_OP_ITER, &timer, 0,
+                    tcxstrsize(buf->arena), result);
+    if (!result) {
+      tc_HDBPos_SetError(&self->pos, self->hdb->hdb);
+      return NULL;
+    }
+    if (buf->num == 0) {
+      return NULL;
+    }
+  }
+  return tc_RecBuf_get(buf, buf->pos++, self->itype);
+}
+
+/* Type ------------------------------------------------------------------ */
+
+PyTypeObject tc_HDBIteratorType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.HDBIterator",                         /* tp_name */
+  sizeof(tc_HDBIterator),                   /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)tc_HDBIterator_dealloc,       /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  0,                                        /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash  */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,                       /* tp_flags */
+  "Tokyo Cabinet hash database iterator",   /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  PyObject_SelfIter,                        /* tp_iter */
+  (iternextfunc)tc_HDBIterator_iternext,    /* tp_iternext */
+  0,                                        /* tp_methods */
+};
+
+int tc_HDBIterator_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_HDBIteratorType) == 0)
+    return PyModule_AddObject(module, "HDBIterator", (PyObject *)&tc_HDBIteratorType);
+  return -1;
+}
@@ -0,0 +1,26 @@
+#ifndef PYTC_HDBITERATOR_H
+#define PYTC_HDBITERATOR_H
+
+#include "_base.h"
+#include <tchdb.h>
+#include "HDB.h"
+#include "util.h"
+
+/* An iterator of a hash database object with its own position, see
+   tc_HDBPos. */
+typedef struct {
+  PyObject_HEAD
+  tc_HDB *hdb;
+  tc_itertype_t itype;
+  tc_RecBuf *buf;
+  tc_HDBPos pos;
+} tc_HDBIterator;
+
+extern PyTypeObject tc_HDBIteratorType;
+
+tc_HDBIterator *tc_HDBIterator_new_capi(tc_HDB *hdb, tc_itertype_t itype, int prefetch);
+bool tc_HDBIterator_fetch(tc_HDBIterator *self);
+
+int tc_HDBIterator_register(PyObject *module);
+
+#endif
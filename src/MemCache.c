@@ -0,0 +1,640 @@
+#include "MemCache.h"
+#include "util.h"
+#include <pthread.h>
+
+/* Private --------------------------------------------------------------- */
+
+/* The functions below are called without the GIL */
+
+/* Stripes of a TCMDB and the stripe of a key, as in tcutil.c, which does
+   not export them */
+#define TCMDBMNUM 8
+#define TCMDBHASH(TC_res, TC_kbuf, TC_ksiz) \
+  do { \
+    const unsigned char *_TC_p = (const unsigned char *)(TC_kbuf) + TC_ksiz - 1; \
+    int _TC_ksiz = TC_ksiz; \
+    for ((TC_res) = 0x20071123; _TC_ksiz--;) { \
+      (TC_res) = (TC_res) * 33 + *(_TC_p)--; \
+    } \
+    (TC_res) &= TCMDBMNUM - 1; \
+  } while (false)
+
+/* tcmdbget leaves a record where it is, so that tcmdbcutfront would drop
+   records in insertion order. A hit moves the record to the back of its
+   stripe, under the stripe's lock, to have the least recently used records
+   dropped first. */
+static void *_mdbget(TCMDB *mdb, const void *kbuf, int ksiz, int *sp) {
+  unsigned int mi;
+  pthread_rwlock_t *mtx;
+  const char *vbuf;
+  char *ret = NULL;
+  int vsiz;
+
+  TCMDBHASH(mi, kbuf, ksiz);
+  mtx = (pthread_rwlock_t *)mdb->mmtxs + mi;
+  if (pthread_rwlock_wrlock(mtx) != 0) {
+    return NULL;
+  }
+  if ((vbuf = tcmapget(mdb->maps[mi], kbuf, ksiz, &vsiz))) {
+    ret = tcmemdup(vbuf, vsiz);
+    *sp = vsiz;
+    tcmapmove(mdb->maps[mi], kbuf, ksiz, false);
+  }
+  pthread_rwlock_unlock(mtx);
+  return ret;
+}
+
+static void _put(tc_MemCache *self, const void *kbuf, int ksiz, const void *vbuf, int vsiz) {
+  if (self->mdb) {
+    tcmdbput(self->mdb, kbuf, ksiz, vbuf, vsiz);
+  } else {
+    tcndbput(self->ndb, kbuf, ksiz, vbuf, vsiz);
+  }
+}
+
+static bool _putkeep(tc_MemCache *self, const void *kbuf, int ksiz, const void *vbuf, int vsiz) {
+  if (self->mdb) {
+    return tcmdbputkeep(self->mdb, kbuf, ksiz, vbuf, vsiz);
+  }
+  return tcndbputkeep(self->ndb, kbuf, ksiz, vbuf, vsiz);
+}
+
+static void *_get(tc_MemCache *self, const void *kbuf, int ksiz, int *sp) {
+  if (self->mdb) {
+    return _mdbget(self->mdb, kbuf, ksiz, sp);
+  }
+  return tcndbget(self->ndb, kbuf, ksiz, sp);
+}
+
+static bool _out(tc_MemCache *self, const void *kbuf, int ksiz) {
+  if (self->mdb) {
+    return tcmdbout(self->mdb, kbuf, ksiz);
+  }
+  return tcndbout(self->ndb, kbuf, ksiz);
+}
+
+static int _vsiz(tc_MemCache *self, const void *kbuf, int ksiz) {
+  if (self->mdb) {
+    return tcmdbvsiz(self->mdb, kbuf, ksiz);
+  }
+  return tcndbvsiz(self->ndb, kbuf, ksiz);
+}
+
+static uint64_t _rnum(tc_MemCache *self) {
+  return self->mdb ? tcmdbrnum(self->mdb) : tcndbrnum(self->ndb);
+}
+
+static uint64_t _msiz(tc_MemCache *self) {
+  return self->mdb ? tcmdbmsiz(self->mdb) : tcndbmsiz(self->ndb);
+}
+
+/* Drop records until the cache is back within its capacity. The hash
+   variant drops the least recently stored or read records of every stripe,
+   the ordered one those on the fringe of its splay tree, i.e. those not
+   accessed lately. */
+static void _evict(tc_MemCache *self) {
+  uint64_t rnum, msiz;
+  int64_t num = 0;
+
+  if (self->capnum <= 0 && self->capsiz <= 0) {
+    return;
+  }
+  rnum = _rnum(self);
+  if (self->capnum > 0 && rnum > (uint64_t)self->capnum) {
+    num = rnum - self->capnum;
+  }
+  if (self->capsiz > 0 && rnum > 0 && (msiz = _msiz(self)) > (uint64_t)self->capsiz) {
+    /* estimate the number of records from the average record size */
+    num = max(num, (int64_t)((msiz - self->capsiz) / (msiz / rnum + 1)) + 1);
+  }
+  if (num > 0) {
+    num = min(num, INT_MAX);
+    if (self->mdb) {
+      tcmdbcutfront(self->mdb, (int)num);
+    } else {
+      tcndbcutfringe(self->ndb, (int)num);
+    }
+  }
+}
+
+/* Parse a key with "s#", as put() and get() do. The string belongs to the
+   key object. Returns -1 with an exception set on failure. */
+static int _key_parse(PyObject *key, char **kbuf, int *ksiz) {
+  return PyArg_Parse(key, "s#", kbuf, ksiz) ? 0 : -1;
+}
+
+/* Public ---------------------------------------------------------------- */
+
+static long tc_MemCache_Hash(PyObject *self) {
+  log_trace("ENTER");
+  PyErr_SetString(PyExc_TypeError, "MemCache objects are unhashable");
+  return -1L;
+}
+
+static void tc_MemCache_dealloc(tc_MemCache *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  if (self->mdb) {
+    tcmdbdel(self->mdb);
+  }
+  if (self->ndb) {
+    tcndbdel(self->ndb);
+  }
+  Py_END_ALLOW_THREADS
+  if (self->iterlock) {
+    PyThread_free_lock(self->iterlock);
+  }
+  PyObject_Del(self);
+}
+
+static PyObject *tc_MemCache_new(PyTypeObject *type, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  tc_MemCache *self;
+  PY_LONG_LONG capnum = 0, capsiz = 0;
+  unsigned int bnum = 0;
+  PyObject *ordered = NULL;
+  static char *kwlist[] = {"capnum", "capsiz", "bnum", "ordered", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|LLIO:MemCache", kwlist,
+                                   &capnum, &capsiz, &bnum, &ordered)) {
+    return NULL;
+  }
+  if (!(self = (tc_MemCache *)type->tp_alloc(type, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_MemCache instance");
+    return NULL;
+  }
+  self->capnum = capnum;
+  self->capsiz = capsiz;
+  if (!(self->iterlock = PyThread_allocate_lock())) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc iterator lock");
+  } else if (ordered && PyObject_IsTrue(ordered)) {
+    if ((self->ndb = tcndbnew())) {
+      return (PyObject *)self;
+    }
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc TCNDB instance");
+  } else {
+    if ((self->mdb = bnum ? tcmdbnew2(bnum) : tcmdbnew())) {
+      return (PyObject *)self;
+    }
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc TCMDB instance");
+  }
+  tc_MemCache_dealloc(self);
+  return NULL;
+}
+
+static PyObject *tc_MemCache_put(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
+  tc_buffer_t value;
+  static char *kwlist[] = {"key", "value", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#" TC_BUFFER_FMT ":put", kwlist,
+                                   &key, &key_len, TC_BUFFER_ARGS(value)) ||
+      tc_Buffer_Check(&value) != 0) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  _put(self, key, key_len, TC_BUFFER_BUF(value), TC_BUFFER_LEN(value));
+  _evict(self);
+  Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(value);
+  Py_RETURN_NONE;
+}
+
+/* Returns whether the record was stored */
+static PyObject *tc_MemCache_putkeep(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
+  bool result;
+  tc_buffer_t value;
+  static char *kwlist[] = {"key", "value", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#" TC_BUFFER_FMT ":putkeep", kwlist,
+                                   &key, &key_len, TC_BUFFER_ARGS(value)) ||
+      tc_Buffer_Check(&value) != 0) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  if ((result = _putkeep(self, key, key_len, TC_BUFFER_BUF(value), TC_BUFFER_LEN(value)))) {
+    _evict(self);
+  }
+  Py_END_ALLOW_THREADS
+  TC_BUFFER_RELEASE(value);
+  return PyBool_FromLong(result);
+}
+
+/* Stores (key, value) pairs from a mapping or an iterable, TC_BATCH_SIZE
+   records per GIL release */
+static PyObject *tc_MemCache_putmany(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *items, *iter;
+  tc_KVBatch *batch;
+  long stored = 0;
+  int i, n;
+  static char *kwlist[] = {"items", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O:putmany", kwlist, &items) ||
+      !(iter = tc_KVBatch_iter(items))) {
+    return NULL;
+  }
+  if (!(batch = tc_KVBatch_new(TC_CODEC_RAW))) {
+    Py_DECREF(iter);
+    return NULL;
+  }
+  while ((n = tc_KVBatch_fill(batch, iter)) > 0) {
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i++) {
+      _put(self, batch->kbufs[i], batch->ksizs[i], batch->vbufs[i], batch->vsizs[i]);
+    }
+    _evict(self);
+    Py_END_ALLOW_THREADS
+    stored += n;
+  }
+  tc_KVBatch_del(batch);
+  Py_DECREF(iter);
+  if (PyErr_Occurred()) {
+    tc_Error_SetStored(stored);
+    return NULL;
+  }
+  return NUMBER_FromLong(stored);
+}
+
+static PyObject *tc_MemCache_GetItem(tc_MemCache *self, const char *key, int key_len) {
+  PyObject *ret;
+  void *value;
+  int value_len;
+
+  Py_BEGIN_ALLOW_THREADS
+  value = _get(self, key, key_len, &value_len);
+  Py_END_ALLOW_THREADS
+
+  if (!value) {
+    PyErr_SetString(PyExc_KeyError, "no record found");
+    return NULL;
+  }
+  ret = PyBytes_FromStringAndSize(value, value_len);
+  free(value);
+  return ret;
+}
+
+static PyObject *tc_MemCache_get(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
+  static char *kwlist[] = {"key", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:get", kwlist, &key, &key_len)) {
+    return NULL;
+  }
+  return tc_MemCache_GetItem(self, key, key_len);
+}
+
+/* Looks up every key in one GIL release; missing keys map to default */
+static PyObject *tc_MemCache_getmany(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *keys, *dflt = Py_None, *ret = NULL, *value;
+  TCLIST *klist;
+  char **values;
+  int *value_lens;
+  int i, n;
+  static char *kwlist[] = {"keys", "default", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|O:getmany", kwlist,
+                                   &keys, &dflt) ||
+      !(klist = tc_TCLIST_FromKeys(keys))) {
+    return NULL;
+  }
+  n = tclistnum(klist);
+  values = (char **)calloc(n + 1, sizeof(char *));
+  value_lens = (int *)calloc(n + 1, sizeof(int));
+  if (!values || !value_lens) {
+    PyErr_NoMemory();
+    goto exit;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  for (i = 0; i < n; i++) {
+    int key_len;
+    const char *key = tclistval(klist, i, &key_len);
+    values[i] = _get(self, key, key_len, &value_lens[i]);
+  }
+  Py_END_ALLOW_THREADS
+
+  if ((ret = PyList_New(n))) {
+    for (i = 0; i < n; i++) {
+      if (values[i]) {
+        if (!(value = PyBytes_FromStringAndSize(values[i], value_lens[i]))) {
+          Py_CLEAR(ret);
+          break;
+        }
+      } else {
+        Py_INCREF(dflt);
+        value = dflt;
+      }
+      PyList_SET_ITEM(ret, i, value);
+    }
+  }
+exit:
+  if (values) {
+    for (i = 0; i < n; i++) {
+      if (values[i]) { free(values[i]); }
+    }
+    free(values);
+  }
+  if (value_lens) { free(value_lens); }
+  tclistdel(klist);
+  return ret;
+}
+
+static PyObject *tc_MemCache_out(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
+  bool result;
+  static char *kwlist[] = {"key", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:out", kwlist, &key, &key_len)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  result = _out(self, key, key_len);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    PyErr_SetString(PyExc_KeyError, "no record found");
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_MemCache_vsiz(tc_MemCache *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len, ret;
+  static char *kwlist[] = {"key", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:vsiz", kwlist, &key, &key_len)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  ret = _vsiz(self, key, key_len);
+  Py_END_ALLOW_THREADS
+
+  if (ret == -1) {
+    PyErr_SetString(PyExc_KeyError, "no record found");
+    return NULL;
+  }
+  return NUMBER_FromLong((long)ret);
+}
+
+static PyObject *tc_MemCache_vanish(tc_MemCache *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  if (self->mdb) {
+    tcmdbvanish(self->mdb);
+  } else {
+    tcndbvanish(self->ndb);
+  }
+  Py_END_ALLOW_THREADS
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_MemCache_rnum(tc_MemCache *self) {
+  uint64_t ret;
+  Py_BEGIN_ALLOW_THREADS
+  ret = _rnum(self);
+  Py_END_ALLOW_THREADS
+  return PyLong_FromUnsignedLongLong(ret);
+}
+
+static PyObject *tc_MemCache_msiz(tc_MemCache *self) {
+  uint64_t ret;
+  Py_BEGIN_ALLOW_THREADS
+  ret = _msiz(self);
+  Py_END_ALLOW_THREADS
+  return PyLong_FromUnsignedLongLong(ret);
+}
+
+/* Snapshot of all keys, in order for the ordered variant */
+static PyObject *tc_MemCache_keys(tc_MemCache *self) {
+  log_trace("ENTER");
+  PyObject *ret, *key;
+  TCLIST *keys = tclistnew();
+  const char *kbuf;
+  int i, n, ksiz;
+
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->iterlock, WAIT_LOCK);
+  {
+    void *buf;
+    if (self->mdb) {
+      tcmdbiterinit(self->mdb);
+      while ((buf = tcmdbiternext(self->mdb, &ksiz))) {
+        tclistpush(keys, buf, ksiz);
+        free(buf);
+      }
+    } else {
+      tcndbiterinit(self->ndb);
+      while ((buf = tcndbiternext(self->ndb, &ksiz))) {
+        tclistpush(keys, buf, ksiz);
+        free(buf);
+      }
+    }
+  }
+  PyThread_release_lock(self->iterlock);
+  Py_END_ALLOW_THREADS
+
+  if ((ret = PyList_New(n = tclistnum(keys)))) {
+    for (i = 0; i < n; i++) {
+      kbuf = tclistval(keys, i, &ksiz);
+      if (!(key = PyBytes_FromStringAndSize(kbuf, ksiz))) {
+        Py_CLEAR(ret);
+        break;
+      }
+      PyList_SET_ITEM(ret, i, key);
+    }
+  }
+  tclistdel(keys);
+  return ret;
+}
+
+static PyObject *tc_MemCache_GetIter(tc_MemCache *self) {
+  log_trace("ENTER");
+  PyObject *list, *ret;
+
+  if (!(list = tc_MemCache_keys(self))) {
+    return NULL;
+  }
+  ret = PyObject_GetIter(list);
+  Py_DECREF(list);
+  return ret;
+}
+
+/* for dict like interface */
+static int tc_MemCache_Contains(tc_MemCache *self, PyObject *_key) {
+  char *key;
+  int key_len, value_len;
+
+  if (_key_parse(_key, &key, &key_len) != 0) {
+    return -1;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  value_len = _vsiz(self, key, key_len);
+  Py_END_ALLOW_THREADS
+  return (value_len != -1);
+}
+
+TC_XDB___contains__(tc_MemCache___contains__,tc_MemCache,tc_MemCache_Contains);
+
+static PyObject *tc_MemCache_subscript(tc_MemCache *self, PyObject *_key) {
+  char *key;
+  int key_len;
+
+  if (_key_parse(_key, &key, &key_len) != 0) {
+    return NULL;
+  }
+  return tc_MemCache_GetItem(self, key, key_len);
+}
+
+static Py_ssize_t tc_MemCache_length(tc_MemCache *self) {
+  return (Py_ssize_t)_rnum(self);
+}
+
+static int tc_MemCache_ass_sub(tc_MemCache *self, PyObject *_key, PyObject *_value) {
+  char *key;
+  int key_len;
+  tc_buffer_t value;
+  bool result = true;
+
+  if (_key_parse(_key, &key, &key_len) != 0) {
+    return -1;
+  }
+  if (_value) {
+    if (tc_Buffer_FromObject(_value, &value, "values") != 0) {
+      return -1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    _put(self, key, key_len, TC_BUFFER_BUF(value), TC_BUFFER_LEN(value));
+    _evict(self);
+    Py_END_ALLOW_THREADS
+    TC_BUFFER_RELEASE(value);
+  } else {
+    Py_BEGIN_ALLOW_THREADS
+    result = _out(self, key, key_len);
+    Py_END_ALLOW_THREADS
+  }
+  if (!result) {
+    PyErr_SetString(PyExc_KeyError, "no record found");
+    return -1;
+  }
+  return 0;
+}
+
+/* methods of classes */
+static PyMethodDef tc_MemCache_methods[] = {
+  {"put", (PyCFunction)tc_MemCache_put, METH_VARARGS | METH_KEYWORDS,
+    "Store a record into a cache."},
+  {"putkeep", (PyCFunction)tc_MemCache_putkeep, METH_VARARGS | METH_KEYWORDS,
+    "Store a new record into a cache. Returns whether the record was stored."},
+  {"putmany", (PyCFunction)tc_MemCache_putmany, METH_VARARGS | METH_KEYWORDS,
+    "Store records from a mapping or from (key, value) pairs into a cache.\n"
+   "Returns the number of records stored."},
+  {"get", (PyCFunction)tc_MemCache_get, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record in a cache."},
+  {"getmany", (PyCFunction)tc_MemCache_getmany, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve the records of several keys in a cache.\n"
+   "Returns a list of values in the order of the keys, missing records being replaced by default."},
+  {"out", (PyCFunction)tc_MemCache_out, METH_VARARGS | METH_KEYWORDS,
+    "Remove a record of a cache."},
+  {"vsiz", (PyCFunction)tc_MemCache_vsiz, METH_VARARGS | METH_KEYWORDS,
+    "Get the size of the value of a record in a cache."},
+  {"vanish", (PyCFunction)tc_MemCache_vanish, METH_NOARGS,
+    "Remove all records of a cache."},
+  {"rnum", (PyCFunction)tc_MemCache_rnum, METH_NOARGS,
+    "Get the number of records of a cache."},
+  {"msiz", (PyCFunction)tc_MemCache_msiz, METH_NOARGS,
+    "Get the total size of memory used in a cache."},
+  {"__contains__", (PyCFunction)tc_MemCache___contains__, METH_O | METH_COEXIST,
+    NULL},
+  {"__getitem__", (PyCFunction)tc_MemCache_subscript, METH_O | METH_COEXIST,
+    NULL},
+  {"has_key", (PyCFunction)tc_MemCache___contains__, METH_O,
+    NULL},
+  {"keys", (PyCFunction)tc_MemCache_keys, METH_NOARGS,
+    NULL},
+  {NULL, NULL, 0, NULL}
+};
+
+/* Hack to implement "key in dict" */
+static PySequenceMethods tc_MemCache_as_sequence = {
+  0,                                /* sq_length */
+  0,                                /* sq_concat */
+  0,                                /* sq_repeat */
+  0,                                /* sq_item */
+  0,                                /* sq_slice */
+  0,                                /* sq_ass_item */
+  0,                                /* sq_ass_slice */
+  (objobjproc)tc_MemCache_Contains, /* sq_contains */
+  0,                                /* sq_inplace_concat */
+  0,                                /* sq_inplace_repeat */
+};
+
+static PyMappingMethods tc_MemCache_as_mapping = {
+  (lenfunc)tc_MemCache_length, /* mp_length (inquiry/lenfunc )*/
+  (binaryfunc)tc_MemCache_subscript, /* mp_subscript */
+  (objobjargproc)tc_MemCache_ass_sub, /* mp_ass_subscript */
+};
+
+PyTypeObject tc_MemCacheType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.MemCache",                               /* tp_name */
+  sizeof(tc_MemCache),                         /* tp_basicsize */
+  0,                                           /* tp_itemsize */
+  (destructor)tc_MemCache_dealloc,             /* tp_dealloc */
+  0,                                           /* tp_print */
+  0,                                           /* tp_getattr */
+  0,                                           /* tp_setattr */
+  0,                                           /* tp_compare */
+  0,                                           /* tp_repr */
+  0,                                           /* tp_as_number */
+  &tc_MemCache_as_sequence,                    /* tp_as_sequence */
+  &tc_MemCache_as_mapping,                     /* tp_as_mapping */
+  tc_MemCache_Hash,                            /* tp_hash  */
+  0,                                           /* tp_call */
+  0,                                           /* tp_str */
+  0,                                           /* tp_getattro */
+  0,                                           /* tp_setattro */
+  0,                                           /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,    /* tp_flags */
+  "Tokyo Cabinet on-memory cache",             /* tp_doc */
+  0,                                           /* tp_traverse */
+  0,                                           /* tp_clear */
+  0,                                           /* tp_richcompare */
+  0,                                           /* tp_weaklistoffset */
+  (getiterfunc)tc_MemCache_GetIter,            /* tp_iter */
+  0,                                           /* tp_iternext */
+  tc_MemCache_methods,                         /* tp_methods */
+  0,                                           /* tp_members */
+  0,                                           /* tp_getset */
+  0,                                           /* tp_base */
+  0,                                           /* tp_dict */
+  0,                                           /* tp_descr_get */
+  0,                                           /* tp_descr_set */
+  0,                                           /* tp_dictoffset */
+  0,                                           /* tp_init */
+  0,                                           /* tp_alloc */
+  tc_MemCache_new,                             /* tp_new */
+};
+
+int tc_MemCache_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_MemCacheType) == 0)
+    return PyModule_AddObject(module, "MemCache", (PyObject *)&tc_MemCacheType);
+  return -1;
+}
@@ -0,0 +1,24 @@
+#ifndef PYTC_MEMCACHE_H
+#define PYTC_MEMCACHE_H
+
+#include "_base.h"
+#include <pythread.h>
+
+/* An on-memory cache with a record and/or byte capacity. The hash
+   variant sits on TCMDB, whose records are spread over stripes with a
+   lock each; the ordered variant sits on TCNDB. Either way, all access
+   happens without the GIL. */
+typedef struct {
+  PyObject_HEAD
+  TCMDB *mdb;
+  TCNDB *ndb;
+  PY_LONG_LONG capnum;
+  PY_LONG_LONG capsiz;
+  PyThread_type_lock iterlock; /* serializes use of tc's iterator */
+} tc_MemCache;
+
+extern PyTypeObject tc_MemCacheType;
+
+int tc_MemCache_register(PyObject *module);
+
+#endif
@@ -0,0 +1,317 @@
+#include "Stats.h"
+#include "util.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Private --------------------------------------------------------------- */
+
+static const char *_opnames[TC_OP_NUM] = {
+  "get", "put", "out", "getmany", "putmany", "iter", "cursor", "query"
+};
+
+static int _bucket(uint64_t ns) {
+  int exp;
+
+  if (ns < (1 << TC_STATS_SUBBITS)) {
+    return (int)ns;
+  }
+  exp = 63 - __builtin_clzll(ns);
+  if (exp > TC_STATS_MAXEXP) {
+    return TC_STATS_BUCKETS - 1;
+  }
+  return ((exp - TC_STATS_SUBBITS + 1) << TC_STATS_SUBBITS) +
+         (int)((ns >> (exp - TC_STATS_SUBBITS)) & ((1 << TC_STATS_SUBBITS) - 1));
+}
+
+/* Exclusive upper bound of a bucket in ns */
+static uint64_t _bucket_upper(int i) {
+  int group = i >> TC_STATS_SUBBITS, shift;
+
+  if (group == 0) {
+    return i + 1;
+  }
+  shift = group - 1;
+  return ((uint64_t)((1 << TC_STATS_SUBBITS) + (i & ((1 << TC_STATS_SUBBITS) - 1))) << shift) +
+         ((uint64_t)1 << shift);
+}
+
+/* Upper bound in seconds of the bucket holding quantile q */
+static double _quantile(const tc_OpStats *op, double q) {
+  uint64_t rank = (uint64_t)(q * op->calls + 0.5), seen = 0;
+  int i;
+
+  if (rank < 1) {
+    rank = 1;
+  }
+  for (i = 0; i < TC_STATS_BUCKETS; i++) {
+    seen += op->hist[i];
+    if (seen >= rank) {
+      return _bucket_upper(i) / 1e9;
+    }
+  }
+  return 0;
+}
+
+static int _set_double(PyObject *dict, const char *name, double value) {
+  PyObject *item;
+  int ret;
+
+  if (!(item = PyFloat_FromDouble(value))) {
+    return -1;
+  }
+  ret = PyDict_SetItemString(dict, name, item);
+  Py_DECREF(item);
+  return ret;
+}
+
+static PyObject *_op_dict(const tc_OpStats *op) {
+  PyObject *dict, *hist, *item;
+  int i;
+
+  if (!(dict = PyDict_New())) {
+    return NULL;
+  }
+  if (tc_Dict_SetLongLong(dict, "calls", op->calls) ||
+      tc_Dict_SetLongLong(dict, "errors", op->errors) ||
+      tc_Dict_SetLongLong(dict, "bytes_in", op->bytes_in) ||
+      tc_Dict_SetLongLong(dict, "bytes_out", op->bytes_out) ||
+      _set_double(dict, "tc_seconds", op->tc_ns / 1e9) ||
+      _set_double(dict, "gil_seconds", op->gil_ns / 1e9) ||
+      _set_double(dict, "p50", _quantile(op, 0.5)) ||
+      _set_double(dict, "p99", _quantile(op, 0.99)) ||
+      _set_double(dict, "p999", _quantile(op, 0.999))) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  /* (upper bound in ns, count) of every bucket used */
+  if (!(hist = PyList_New(0))) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  for (i = 0; i < TC_STATS_BUCKETS; i++) {
+    if (!op->hist[i]) {
+      continue;
+    }
+    if (!(item = Py_BuildValue("(KK)", (unsigned PY_LONG_LONG)_bucket_upper(i),
+                               (unsigned PY_LONG_LONG)op->hist[i])) ||
+        PyList_Append(hist, item)) {
+      Py_XDECREF(item);
+      Py_DECREF(hist);
+      Py_DECREF(dict);
+      return NULL;
+    }
+    Py_DECREF(item);
+  }
+  i = PyDict_SetItemString(dict, "histogram", hist);
+  Py_DECREF(hist);
+  if (i) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  return dict;
+}
+
+static void _printf(TCXSTR *xstr, const char *format, ...) {
+  char buf[512];
+  va_list ap;
+  int len;
+
+  va_start(ap, format);
+  len = vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  if (len < 0) {
+    return;
+  }
+  tcxstrcat(xstr, buf, min(len, (int)sizeof(buf) - 1));
+}
+
+static void _prometheus(tc_Stats *stats, const char *name, TCXSTR *xstr) {
+  static const struct {
+    const char *metric, *type, *help;
+    size_t offset;
+    double scale;
+  } counters[] = {
+    {"tc_calls_total", "counter", "Calls of tc.", offsetof(tc_OpStats, calls), 1},
+    {"tc_errors_total", "counter", "Failed calls of tc.", offsetof(tc_OpStats, errors), 1},
+    {"tc_bytes_in_total", "counter", "Bytes of keys and values handed to tc.",
+     offsetof(tc_OpStats, bytes_in), 1},
+    {"tc_bytes_out_total", "counter", "Bytes of values returned by tc.",
+     offsetof(tc_OpStats, bytes_out), 1},
+    {"tc_gil_wait_seconds_total", "counter", "Time waiting for the GIL after tc returned.",
+     offsetof(tc_OpStats, gil_ns), 1e-9},
+  };
+  const tc_OpStats *op;
+  uint64_t cumulative;
+  size_t c;
+  int o, e, i, end;
+
+  for (c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+    _printf(xstr, "# HELP %s %s\n# TYPE %s %s\n", counters[c].metric, counters[c].help,
+            counters[c].metric, counters[c].type);
+    for (o = 0; o < TC_OP_NUM; o++) {
+      op = &stats->ops[o];
+      if (!op->calls) {
+        continue;
+      }
+      _printf(xstr, "%s{db=\"%s\",op=\"%s\"} %.9g\n", counters[c].metric, name, _opnames[o],
+              *(const uint64_t *)((const char *)op + counters[c].offset) * counters[c].scale);
+    }
+  }
+  _printf(xstr, "# HELP tc_latency_seconds Time inside tc, including its lock.\n"
+                "# TYPE tc_latency_seconds histogram\n");
+  for (o = 0; o < TC_OP_NUM; o++) {
+    op = &stats->ops[o];
+    if (!op->calls) {
+      continue;
+    }
+    /* one bucket per power of two from about 1 us on */
+    cumulative = 0;
+    i = 0;
+    for (e = 10; e <= TC_STATS_MAXEXP; e++) {
+      for (end = _bucket((uint64_t)1 << e); i < end; i++) {
+        cumulative += op->hist[i];
+      }
+      _printf(xstr, "tc_latency_seconds_bucket{db=\"%s\",op=\"%s\",le=\"%.9g\"} %llu\n",
+              name, _opnames[o], ((uint64_t)1 << e) / 1e9, (unsigned long long)cumulative);
+    }
+    _printf(xstr, "tc_latency_seconds_bucket{db=\"%s\",op=\"%s\",le=\"+Inf\"} %llu\n"
+                  "tc_latency_seconds_sum{db=\"%s\",op=\"%s\"} %.9g\n"
+                  "tc_latency_seconds_count{db=\"%s\",op=\"%s\"} %llu\n",
+            name, _opnames[o], (unsigned long long)op->calls,
+            name, _opnames[o], op->tc_ns / 1e9,
+            name, _opnames[o], (unsigned long long)op->calls);
+  }
+}
+
+/* Replace path with the text, through a temporary file so that readers
+   never see a partial dump */
+static bool _write_file(const char *path, const char *text, int size) {
+  char *tmp;
+  FILE *f;
+  bool ok;
+
+  if (!(tmp = malloc(strlen(path) + 5))) {
+    return false;
+  }
+  sprintf(tmp, "%s.tmp", path);
+  if (!(f = fopen(tmp, "w"))) {
+    free(tmp);
+    return false;
+  }
+  ok = fwrite(text, 1, size, f) == (size_t)size;
+  ok = (fclose(f) == 0) && ok;
+  ok = ok && rename(tmp, path) == 0;
+  if (!ok) {
+    remove(tmp);
+  }
+  free(tmp);
+  return ok;
+}
+
+/* Public ---------------------------------------------------------------- */
+
+uint64_t tc_Stats_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+tc_Stats *tc_Stats_new(void) {
+  tc_Stats *stats;
+
+  if (!(stats = calloc(1, sizeof(tc_Stats)))) {
+    PyErr_NoMemory();
+  }
+  return stats;
+}
+
+void tc_Stats_del(tc_Stats *stats) {
+  free(stats);
+}
+
+/* Record a call timed with TC_STATS_CALL. Called right after the GIL is
+   taken back, so that the wait for it is included. */
+void tc_Stats_record(tc_Stats *stats, tc_op_t op, const tc_StatsTimer *timer,
+                     uint64_t bytes_in, uint64_t bytes_out, bool ok) {
+  tc_OpStats *s;
+  uint64_t now = tc_Stats_now(), elapsed = timer->end - timer->begin;
+
+  if (!stats) {
+    return;
+  }
+  s = &stats->ops[op];
+  s->calls++;
+  if (!ok) {
+    s->errors++;
+  }
+  s->bytes_in += bytes_in;
+  s->bytes_out += bytes_out;
+  s->tc_ns += elapsed;
+  s->gil_ns += now - timer->end;
+  s->hist[_bucket(elapsed)]++;
+}
+
+/* {op: {calls, errors, bytes_in, bytes_out, tc_seconds, gil_seconds, p50,
+   p99, p999, histogram}} of the operations used so far */
+PyObject *tc_Stats_AsDict(tc_Stats *stats, bool reset) {
+  PyObject *dict, *item;
+  int o;
+
+  if (!(dict = PyDict_New())) {
+    return NULL;
+  }
+  for (o = 0; o < TC_OP_NUM; o++) {
+    if (!stats->ops[o].calls) {
+      continue;
+    }
+    if (!(item = _op_dict(&stats->ops[o])) ||
+        PyDict_SetItemString(dict, _opnames[o], item)) {
+      Py_XDECREF(item);
+      Py_DECREF(dict);
+      return NULL;
+    }
+    Py_DECREF(item);
+  }
+  if (reset) {
+    memset(stats, 0, sizeof(tc_Stats));
+  }
+  return dict;
+}
+
+/* Implements the prometheus([path[, name]]) method of databases */
+PyObject *tc_Stats_Prometheus(tc_Stats *stats, PyObject *args, PyObject *keywds) {
+  PyObject *ret = NULL;
+  TCXSTR *xstr;
+  char *path = NULL, *name = "";
+  bool ok;
+  static char *kwlist[] = {"path", "name", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|zs:prometheus", kwlist,
+                                   &path, &name)) {
+    return NULL;
+  }
+  if (strpbrk(name, "\"\\\n")) {
+    PyErr_SetString(PyExc_ValueError, "name must not contain quotes, backslashes or newlines");
+    return NULL;
+  }
+  xstr = tcxstrnew();
+  _prometheus(stats, name, xstr);
+  if (!path) {
+    ret = PyBytes_FromStringAndSize(tcxstrptr(xstr), tcxstrsize(xstr));
+  } else {
+    Py_BEGIN_ALLOW_THREADS
+    ok = _write_file(path, tcxstrptr(xstr), tcxstrsize(xstr));
+    Py_END_ALLOW_THREADS
+    if (ok) {
+      Py_INCREF(Py_None);
+      ret = Py_None;
+    } else {
+      PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+    }
+  }
+  tcxstrdel(xstr);
+  return ret;
+}
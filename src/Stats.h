@@ -0,0 +1,64 @@
+#ifndef PYTC_STATS_H
+#define PYTC_STATS_H
+
+#include "_base.h"
+
+/* Operations counted separately */
+typedef enum {
+  TC_OP_GET,
+  TC_OP_PUT,
+  TC_OP_OUT,
+  TC_OP_GETMANY,
+  TC_OP_PUTMANY,
+  TC_OP_ITER,
+  TC_OP_CURSOR,
+  TC_OP_QUERY,
+  TC_OP_NUM
+} tc_op_t;
+
+/* Latencies are kept in log-linear buckets like HDR histograms: values
+   below 8 ns have a bucket each, then every power of two is split into 8
+   buckets, so a bucket is at most 12.5% wide. Values of 2^36 ns (about a
+   minute) and more share the last bucket. */
+#define TC_STATS_SUBBITS 3
+#define TC_STATS_MAXEXP 36
+#define TC_STATS_BUCKETS ((TC_STATS_MAXEXP - TC_STATS_SUBBITS + 2) << TC_STATS_SUBBITS)
+
+typedef struct {
+  uint64_t calls;
+  uint64_t errors;          /* failed calls, including missing keys */
+  uint64_t bytes_in;        /* keys and values handed to tc */
+  uint64_t bytes_out;       /* values returned by tc */
+  uint64_t tc_ns;           /* time inside tc, including its lock */
+  uint64_t gil_ns;          /* time waiting for the GIL after tc returned */
+  uint64_t hist[TC_STATS_BUCKETS]; /* time inside tc */
+} tc_OpStats;
+
+/* Statistics of a database handle. They are only updated while holding
+   the GIL, which makes plain increments safe. */
+typedef struct {
+  tc_OpStats ops[TC_OP_NUM];
+} tc_Stats;
+
+typedef struct {
+  uint64_t begin;
+  uint64_t end;
+} tc_StatsTimer;
+
+/* Time a tc call made without the GIL */
+#define TC_STATS_CALL(timer,call) \
+  do { \
+    (timer).begin = tc_Stats_now(); \
+    call; \
+    (timer).end = tc_Stats_now(); \
+  } while (0)
+
+uint64_t tc_Stats_now (void);
+tc_Stats *tc_Stats_new (void);
+void tc_Stats_del (tc_Stats *stats);
+void tc_Stats_record (tc_Stats *stats, tc_op_t op, const tc_StatsTimer *timer,
+                      uint64_t bytes_in, uint64_t bytes_out, bool ok);
+PyObject *tc_Stats_AsDict (tc_Stats *stats, bool reset);
+PyObject *tc_Stats_Prometheus (tc_Stats *stats, PyObject *args, PyObject *keywds);
+
+#endif
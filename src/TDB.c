@@ -1,10 +1,12 @@
 #include "TDB.h"
+#include "HDB.h"
 #include "TDBQuery.h"
+#include "Transaction.h"
 #include "util.h"
 
 /* Private --------------------------------------------------------------- */
 
-static void _set_tdb_error(TCTDB *db) {
+void tc_Error_SetTDB(TCTDB *db) {
   log_trace("ENTER");
   int ecode = tctdbecode(db);
   const char *msg = tctdberrmsg(ecode);
@@ -17,6 +19,51 @@ static void _set_tdb_error(TCTDB *db) {
 }
 
 
+/* Transpose a TCMAP of columns to a new PyDict. If names is not NULL, only
+   the columns listed in it are included. */
+PyObject *tc_PyDict_FromTCMAP(TCMAP *cols, TCLIST *names) {
+  PyObject *columns_dict, *key, *value;
+  const void *kptr, *vptr;
+  int ksiz, vsiz, i = 0;
+  
+  if ( (columns_dict = PyDict_New()) == NULL ) {
+    return NULL;
+  }
+  
+  if (names == NULL) {
+    tcmapiterinit(cols);
+  }
+  while (true) {
+    if (names == NULL) {
+      if ( (kptr = tcmapiternext(cols, &ksiz)) == NULL ) {
+        break;
+      }
+    } else {
+      if (i >= TCLISTNUM(names)) {
+        break;
+      }
+      kptr = tclistval(names, i++, &ksiz);
+    }
+    if ( (vptr = tcmapget(cols, kptr, ksiz, &vsiz)) == NULL ) {
+      continue; /* column not present in this record */
+    }
+    key = PyBytes_FromStringAndSize((const char *)kptr, (Py_ssize_t)ksiz);
+    value = PyBytes_FromStringAndSize((const char *)vptr, (Py_ssize_t)vsiz);
+    if (key == NULL || value == NULL || PyDict_SetItem(columns_dict, key, value) != 0) {
+      Py_XDECREF(key);
+      Py_XDECREF(value);
+      Py_DECREF(columns_dict);
+      return NULL;
+    }
+    /* PyDict_SetItem does not steal references */
+    Py_DECREF(key);
+    Py_DECREF(value);
+  }
+  
+  return columns_dict;
+}
+
+
 static bool _open(tc_TDB *self, PyObject *args, PyObject *keywds) {
   int omode = 0;
   char *path = NULL;
@@ -29,7 +76,7 @@ static bool _open(tc_TDB *self, PyObject *args, PyObject *keywds) {
       result = tctdbopen(self->db, path, omode);
       Py_END_ALLOW_THREADS
       if (!result) {
-        _set_tdb_error(self->db);
+        tc_Error_SetTDB(self->db);
         return false;
       }
     }
@@ -45,8 +92,15 @@ static bool _open(tc_TDB *self, PyObject *args, PyObject *keywds) {
 
 /* Public ---------------------------------------------------------------- */
 
-TC_XDB_OPEN(tc_TDB_open,tc_TDB,tc_TDB_new,tctdbopen,db,tc_TDB_dealloc,_set_tdb_error);
-TC_BOOL_NOARGS(tc_TDB_close,tc_TDB,tctdbclose,db,_set_tdb_error,db);
+TC_XDB_OPEN(tc_TDB_open,tc_TDB,tc_TDB_new,tctdbopen,db,tc_TDB_dealloc,tc_Error_SetTDB);
+TC_BOOL_NOARGS(tc_TDB_close,tc_TDB,tctdbclose,db,tc_Error_SetTDB,db);
+TC_BOOL_NOARGS(tc_TDB_setmutex,tc_TDB,tctdbsetmutex,db,tc_Error_SetTDB,db);
+TC_BOOL_NOARGS(tc_TDB_tranbegin,tc_TDB,tctdbtranbegin,db,tc_Error_SetTDB,db);
+TC_BOOL_NOARGS(tc_TDB_trancommit,tc_TDB,tctdbtrancommit,db,tc_Error_SetTDB,db);
+TC_BOOL_NOARGS(tc_TDB_tranabort,tc_TDB,tctdbtranabort,db,tc_Error_SetTDB,db);
+TC_XDB_transaction(tc_TDB_transaction,tc_TDB);
+TC_XDB_stats(tc_TDB_stats,tc_TDB);
+TC_XDB_prometheus(tc_TDB_prometheus,tc_TDB);
 
 static void tc_TDB_dealloc(tc_TDB *self) {
   log_trace("ENTER");
@@ -55,6 +109,10 @@ static void tc_TDB_dealloc(tc_TDB *self) {
     tctdbdel(self->db);
     Py_END_ALLOW_THREADS
   }
+  if (self->idxlock) {
+    PyThread_free_lock(self->idxlock);
+  }
+  tc_Stats_del(self->stats);
   PyObject_Del(self);
 }
 
@@ -69,6 +127,18 @@ static PyObject *tc_TDB_new(PyTypeObject *type, PyObject *args, PyObject *keywds
   }
   
   self->db = NULL;
+  self->idxlock = NULL;
+  
+  if (!(self->idxlock = PyThread_allocate_lock())) {
+    tc_TDB_dealloc(self);
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc index lock");
+    return NULL;
+  }
+  
+  if (!(self->stats = tc_Stats_new())) {
+    tc_TDB_dealloc(self);
+    return NULL;
+  }
   
   if ( !(self->db = tctdbnew()) ) {
     tc_TDB_dealloc(self);
@@ -98,12 +168,16 @@ static PyObject *tc_TDB_put(tc_TDB *self, PyObject *args, PyObject *keywds) {
   TCMAP *cols = NULL;
   uint32_t cols_count;
   PyObject *columns_dict = NULL, *key, *value, *retv = NULL;
-  PyObject *bkey = NULL, *bvalue = NULL;
+  PyObject *bkey = NULL;
+  tc_buffer_t vbuf;
   Py_ssize_t it_pos;
-  const void *kbuf, *vbuf;
+  const void *kbuf;
   const void *pkbuf;
-  int ksiz, vsiz;
+  int ksiz;
   Py_ssize_t pksiz;
+  bool result;
+  uint64_t bytes_in;
+  tc_StatsTimer timer;
   
   static char *kwlist[] = {"key", "columns", NULL};
   
@@ -117,6 +191,7 @@ static PyObject *tc_TDB_put(tc_TDB *self, PyObject *args, PyObject *keywds) {
   
   cols_count = (uint32_t)PyDict_Size(columns_dict);
   cols = tcmapnew2(cols_count);
+  bytes_in = pksiz;
   
   /* Build columns TCMAP */
   if (cols_count > 0) {
@@ -139,35 +214,28 @@ static PyObject *tc_TDB_put(tc_TDB *self, PyObject *args, PyObject *keywds) {
         goto error;
       }
       
-      /* Value */
-      if (PyBytes_Check(value)) {
-        vbuf = PyBytes_AS_STRING(value);
-        vsiz = PyBytes_GET_SIZE(value);
-      }
-      else if (PyUnicode_Check(value)) {
-        if ( (bvalue = PyUnicode_AsUTF8String(value)) == NULL ) {
-          goto error;
-        }
-        vbuf = PyBytes_AS_STRING(bvalue);
-        vsiz = PyBytes_GET_SIZE(bvalue);
-      }
-      else {
-        PyErr_Format(PyExc_TypeError, "column values must be bytes or strings");
+      /* Value (bytes, strings or any buffer) */
+      if (tc_Buffer_FromObject(value, &vbuf, "column values") != 0) {
         goto error;
       }
       
       /* Put cell (implies memcpy, thus it's safe to decref k and v after this call) */
-      tcmapput(cols, kbuf, ksiz, vbuf, vsiz);
+      tcmapput(cols, kbuf, ksiz, TC_BUFFER_BUF(vbuf), TC_BUFFER_LEN(vbuf));
+      bytes_in += ksiz + TC_BUFFER_LEN(vbuf);
+      TC_BUFFER_RELEASE(vbuf);
       
       /* if not NULL, decref and set to NULL */
       Py_CLEAR(bkey);
-      Py_CLEAR(bvalue);
     }
   }
   
   /* Put columns */
-  if(!tctdbput(self->db, pkbuf, (int)pksiz, cols)){
-    _set_tdb_error(self->db);
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, result = tctdbput(self->db, pkbuf, (int)pksiz, cols));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_PUT, &timer, bytes_in, 0, result);
+  if (!result) {
+    tc_Error_SetTDB(self->db);
     goto error;
   }
   
@@ -180,13 +248,81 @@ error:
     tcmapdel(cols);
   }
   Py_XDECREF(bkey);
-  Py_XDECREF(bvalue);
   return retv;
 }
 
-TC_XDB_SetItem(tc_TDB_SetItem,tc_TDB,tchdbput,db,_set_tdb_error);
 
 
+static PyObject *tc_TDB_setcache(tc_TDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  int rcnum, lcnum, ncnum;
+  bool result;
+  static char *kwlist[] = {"rcnum", "lcnum", "ncnum", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "iii:setcache", kwlist,
+                                   &rcnum, &lcnum, &ncnum)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  result = tctdbsetcache(self->db, rcnum, lcnum, ncnum);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    tc_Error_SetTDB(self->db);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_TDB_setinvcache(tc_TDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PY_LONG_LONG iccmax;
+  double iccsync;
+  bool result;
+  static char *kwlist[] = {"iccmax", "iccsync", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "Ld:setinvcache", kwlist,
+                                   &iccmax, &iccsync)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  result = tctdbsetinvcache(self->db, iccmax, iccsync);
+  Py_END_ALLOW_THREADS
+
+  if (!result) {
+    tc_Error_SetTDB(self->db);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+TC_BOOL_LONG_LONG_ARG(tc_TDB_setxmsiz,tc_TDB,setxmsiz,xmsiz,tctdbsetxmsiz,db,tc_Error_SetTDB);
+TC_BOOL_INT_ARG(tc_TDB_setdfunit,tc_TDB,setdfunit,dfunit,tctdbsetdfunit,db,tc_Error_SetTDB);
+TC_XDB_defrag(tc_TDB_defrag,tc_TDB,tctdbdefrag,db,tc_Error_SetTDB);
+
+static PyObject *tc_TDB_tuning(tc_TDB *self) {
+  log_trace("ENTER");
+  PyObject *dict, *iccsync;
+  TCTDB *tdb = self->db;
+
+  if (!(dict = tc_HDB_Tuning(tdb->hdb)) ||
+      tc_Dict_SetLongLong(dict, "opts", tdb->opts) ||
+      tc_Dict_SetLongLong(dict, "lcnum", tdb->lcnum) ||
+      tc_Dict_SetLongLong(dict, "ncnum", tdb->ncnum) ||
+      tc_Dict_SetLongLong(dict, "iccmax", tdb->iccmax)) {
+    Py_XDECREF(dict);
+    return NULL;
+  }
+  if (!(iccsync = PyFloat_FromDouble(tdb->iccsync)) ||
+      PyDict_SetItemString(dict, "iccsync", iccsync)) {
+    Py_XDECREF(iccsync);
+    Py_DECREF(dict);
+    return NULL;
+  }
+  Py_DECREF(iccsync);
+  return dict;
+}
+
 // bool tctdbtune(TCTDB *tdb, int64_t bnum, int8_t apow, int8_t fpow, uint8_t opts);
 static PyObject *tc_TDB_tune(tc_TDB *self, PyObject *args, PyObject *kwargs) {
 
@@ -209,7 +345,7 @@ static PyObject *tc_TDB_tune(tc_TDB *self, PyObject *args, PyObject *kwargs) {
   Py_END_ALLOW_THREADS
 
   if (!result){
-      _set_tdb_error(self->db);
+      tc_Error_SetTDB(self->db);
       return NULL;
   }
 
@@ -217,14 +353,27 @@ static PyObject *tc_TDB_tune(tc_TDB *self, PyObject *args, PyObject *kwargs) {
 
 }
 
+/* Total size of the names and values of columns */
+static uint64_t _cols_size(TCMAP *cols) {
+  const char *kbuf;
+  int ksiz, vsiz;
+  uint64_t size = 0;
+  
+  tcmapiterinit(cols);
+  while ((kbuf = tcmapiternext(cols, &ksiz))) {
+    tcmapiterval(kbuf, &vsiz);
+    size += ksiz + vsiz;
+  }
+  return size;
+}
+
 static PyObject *tc_TDB_get(tc_TDB *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
-  TCMAP *cols = NULL;
-  PyObject *columns_dict = NULL, *key, *value, *retv = NULL;
-  const void *kptr, *vptr;
-  int ksiz, vsiz;
+  TCMAP *cols;
+  PyObject *retv;
   const void *pkbuf;
   Py_ssize_t pksiz;
+  tc_StatsTimer timer;
   
   static char *kwlist[] = {"key", NULL};
   
@@ -233,52 +382,18 @@ static PyObject *tc_TDB_get(tc_TDB *self, PyObject *args, PyObject *keywds) {
   }
   
   /* Retrieve columns */
-  if ( (cols = tctdbget(self->db, pkbuf, pksiz)) == NULL ) {
-    _set_tdb_error(self->db);
-    return NULL;
-  }
-  
-  /* Alloc PyDict */
-  if ( (columns_dict = PyDict_New()) == NULL ) {
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, cols = tctdbget(self->db, pkbuf, pksiz));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_GET, &timer, pksiz,
+                  cols ? _cols_size(cols) : 0, cols != NULL);
+  if (cols == NULL) {
+    tc_Error_SetTDB(self->db);
     return NULL;
   }
   
-  /* Transponse TCMAP to PyDict */
-  tcmapiterinit(cols);
-  while((kptr = tcmapiternext(cols, &ksiz)) != NULL){
-    /* Key */
-    if ( (key = PyBytes_FromStringAndSize((const char *)kptr, (Py_ssize_t)ksiz)) == NULL ) {
-      goto error;
-    }
-    
-    /* Value */
-    if ( (vptr = tcmapget(cols, kptr, ksiz, &vsiz)) == NULL ) {
-      _set_tdb_error(self->db);
-      goto error;
-    }
-    if ( (value = PyBytes_FromStringAndSize((const char *)vptr, (Py_ssize_t)vsiz)) == NULL ) {
-      Py_DECREF(key);
-      goto error;
-    }
-    
-    /* This function "steals" (or take over) the references, thus no decrefs here */
-    if (PyDict_SetItem(columns_dict, key, value) != 0) {
-      Py_DECREF(key);
-      Py_DECREF(value);
-      goto error;
-    }
-  }
-  
-  /* No incref here as we are giving away our reference, created by PyDict_New */
-  retv = columns_dict;
-  
-error:
-  if (cols) {
-    tcmapdel(cols);
-  }
-  if (retv == NULL && columns_dict) {
-    Py_DECREF(columns_dict);
-  }
+  retv = tc_PyDict_FromTCMAP(cols, NULL);
+  tcmapdel(cols);
   return retv;
 }
 
@@ -287,6 +402,8 @@ static PyObject *tc_TDB_delete(tc_TDB *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
   const void *pkbuf;
   Py_ssize_t pksiz;
+  bool result;
+  tc_StatsTimer timer;
   
   static char *kwlist[] = {"key", NULL};
   
@@ -294,8 +411,38 @@ static PyObject *tc_TDB_delete(tc_TDB *self, PyObject *args, PyObject *keywds) {
     return NULL;
   }
   
-  if ( ! tctdbout(self->db, pkbuf, pksiz) ) {
-    _set_tdb_error(self->db);
+  Py_BEGIN_ALLOW_THREADS
+  TC_STATS_CALL(timer, result = tctdbout(self->db, pkbuf, pksiz));
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->stats, TC_OP_OUT, &timer, pksiz, 0, result);
+  if (!result) {
+    tc_Error_SetTDB(self->db);
+    return NULL;
+  }
+  
+  Py_RETURN_NONE;
+}
+
+
+static PyObject *tc_TDB_setindex(tc_TDB *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  const char *name;
+  int type;
+  bool result;
+  
+  static char *kwlist[] = {"name", "type", NULL};
+  
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "si:setindex", kwlist, &name, &type)) {
+    return NULL;
+  }
+  
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->idxlock, WAIT_LOCK);
+  result = tctdbsetindex(self->db, name, type);
+  PyThread_release_lock(self->idxlock);
+  Py_END_ALLOW_THREADS
+  if (!result) {
+    tc_Error_SetTDB(self->db);
     return NULL;
   }
   
@@ -303,9 +450,57 @@ static PyObject *tc_TDB_delete(tc_TDB *self, PyObject *args, PyObject *keywds) {
 }
 
 
+static PyObject *tc_TDB_indexes(tc_TDB *self) {
+  log_trace("ENTER");
+  PyObject *retv, *item;
+  TCLIST *names;
+  int *types, i, num, nsiz;
+  const char *name;
+  
+  /* TC has no accessor for the index list, so copy it off the handle the
+     same way tctdbsetindex walks it, under the lock setindex() holds while
+     tctdbsetindex grows or shrinks it. */
+  Py_BEGIN_ALLOW_THREADS
+  PyThread_acquire_lock(self->idxlock, WAIT_LOCK);
+  num = self->db->inum;
+  names = tclistnew2(num);
+  if ((types = (int *)malloc((num + 1) * sizeof(int)))) {
+    for (i = 0; i < num; i++) {
+      tclistpush2(names, self->db->idxs[i].name);
+      types[i] = self->db->idxs[i].type;
+    }
+  }
+  PyThread_release_lock(self->idxlock);
+  Py_END_ALLOW_THREADS
+  
+  if (!types) {
+    tclistdel(names);
+    return PyErr_NoMemory();
+  }
+  if ((retv = PyList_New(0))) {
+    for (i = 0; i < num; i++) {
+      name = tclistval(names, i, &nsiz);
+      if (!(item = Py_BuildValue("(s#i)", name, nsiz, types[i]))) {
+        Py_CLEAR(retv);
+        break;
+      }
+      if (PyList_Append(retv, item) != 0) {
+        Py_DECREF(item);
+        Py_CLEAR(retv);
+        break;
+      }
+      Py_DECREF(item);
+    }
+  }
+  free(types);
+  tclistdel(names);
+  return retv;
+}
+
+
 static PyObject *tc_TDB_query(tc_TDB *self) {
   log_trace("ENTER");
-  return (PyObject *)tc_TDBQuery_new_capi(self->db);
+  return (PyObject *)tc_TDBQuery_new_capi(self);
 }
 
 
@@ -324,12 +519,43 @@ static PyMethodDef tc_TDB_methods[] = {
     "Retrieve a record."},
   {"tune", (PyCFunction)tc_TDB_tune, METH_VARARGS | METH_KEYWORDS,
     "tune the database"},
+  {"setcache", (PyCFunction)tc_TDB_setcache, METH_VARARGS | METH_KEYWORDS,
+    "Set the caching parameters of a table database object."},
+  {"setxmsiz", (PyCFunction)tc_TDB_setxmsiz, METH_VARARGS | METH_KEYWORDS,
+    "Set the size of the extra mapped memory of a table database object."},
+  {"setdfunit", (PyCFunction)tc_TDB_setdfunit, METH_VARARGS | METH_KEYWORDS,
+    "Set the unit step number of auto defragmentation of a table database object."},
+  {"defrag", (PyCFunction)tc_TDB_defrag, METH_VARARGS | METH_KEYWORDS,
+    "Defragment step records of a table database object, or the whole file if step is 0."},
+  {"setinvcache", (PyCFunction)tc_TDB_setinvcache, METH_VARARGS | METH_KEYWORDS,
+    "Set the parameters of the inverted cache of a table database object."},
+  {"tuning", (PyCFunction)tc_TDB_tuning, METH_NOARGS,
+    "Get a dict of the tuning and cache parameters in effect of a table database object."},
+  {"setmutex", (PyCFunction)tc_TDB_setmutex, METH_NOARGS,
+    "Set mutual exclusion control of a table database object for threading."},
   {"delete", (PyCFunction)tc_TDB_delete, METH_VARARGS | METH_KEYWORDS,
     "Remove a record."},
   {"out", (PyCFunction)tc_TDB_delete, METH_VARARGS | METH_KEYWORDS,
     "Alias of delete()."},
+  {"setindex", (PyCFunction)tc_TDB_setindex, METH_VARARGS | METH_KEYWORDS,
+    "Set a column index of a table database object.\n"
+    "Pass TDBITVOID to remove an index and TDBITOPT to optimize it."},
+  {"indexes", (PyCFunction)tc_TDB_indexes, METH_NOARGS,
+    "Get a list of (column name, index type) tuples."},
   {"query", (PyCFunction)tc_TDB_query, METH_NOARGS,
     "Query the table."},
+  {"tranbegin", (PyCFunction)tc_TDB_tranbegin, METH_NOARGS,
+    "Begin the transaction of a table database object."},
+  {"trancommit", (PyCFunction)tc_TDB_trancommit, METH_NOARGS,
+    "Commit the transaction of a table database object."},
+  {"tranabort", (PyCFunction)tc_TDB_tranabort, METH_NOARGS,
+    "Abort the transaction of a table database object."},
+  {"transaction", (PyCFunction)tc_TDB_transaction, METH_NOARGS,
+    "Get a context manager running a block in a transaction of a table database object."},
+  {"stats", (PyCFunction)tc_TDB_stats, METH_VARARGS | METH_KEYWORDS,
+    "Get a dict of the operation counters and latencies of a table database object."},
+  {"prometheus", (PyCFunction)tc_TDB_prometheus, METH_VARARGS | METH_KEYWORDS,
+    "Dump the operation counters and latencies of a table database object in the Prometheus text format."},
 
   {NULL, NULL, 0, NULL}
 };
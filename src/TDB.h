@@ -2,17 +2,25 @@
 #define PYTC_TDB_H
 
 #include "_base.h"
+#include <pythread.h>
 #include <tctdb.h>
+#include "Stats.h"
 
 typedef struct {
   PyObject_HEAD
   TCTDB	*db;
+  PyThread_type_lock idxlock; /* guards the index list against setindex() */
+  tc_Stats *stats;
 } tc_TDB;
 
 extern PyTypeObject tc_TDBType;
 
 int tc_TDB_register(PyObject *module);
 
+/* utils */
+void tc_Error_SetTDB(TCTDB *db);
+PyObject *tc_PyDict_FromTCMAP(TCMAP *cols, TCLIST *names);
+
 #define tc_TDB_CheckExact(op) (Py_TYPE(op) == &tc_TDBType)
 #define tc_TDB_Check(op) \
   ((Py_TYPE(op) == &tc_TDBType) || PyObject_TypeCheck((PyObject *)(op), &tc_TDBType))
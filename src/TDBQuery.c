@@ -1,9 +1,175 @@
 #include "TDBQuery.h"
+#include "TDBQueryIterator.h"
 #include "TDB.h"
 #include "util.h"
 
 /* Private --------------------------------------------------------------- */
 
+/* tc keeps the hints and results of a search in the TDBQRY, so a query can
+   only be run by one thread at a time. Called with the GIL released. */
+#define _TDBQuery_LOCK(self) PyThread_acquire_lock((self)->lock, WAIT_LOCK)
+#define _TDBQuery_UNLOCK(self) PyThread_release_lock((self)->lock)
+
+static int _query_cmp(const void *a, const void *b) {
+  const tc_TDBQuery *qa = *(tc_TDBQuery * const *)a;
+  const tc_TDBQuery *qb = *(tc_TDBQuery * const *)b;
+  return (qa > qb) - (qa < qb);
+}
+
+
+/* Build a list of primary keys from a search result. Does not free res. */
+static PyObject *_keys_from_result(TCLIST *res) {
+  PyObject *pylist, *key;
+  const char *pkbuf;
+  int pksiz, i;
+  
+  if ( (pylist = PyList_New( (Py_ssize_t)TCLISTNUM(res) )) == NULL ) {
+    return NULL;
+  }
+  
+  for(i = 0; i < TCLISTNUM(res); i++){
+    pkbuf = tclistval(res, i, &pksiz);
+    if ( (key = PyBytes_FromStringAndSize(pkbuf, pksiz)) == NULL ) {
+      Py_CLEAR(pylist);
+      break;
+    }
+    PyList_SET_ITEM(pylist, i, key);
+  }
+  
+  return pylist;
+}
+
+
+/* Column changes applied by update(). Increments are stored in incr as
+   _update_incr structs keyed by column name. */
+typedef struct {
+  bool isint;
+  PY_LONG_LONG i;
+  double d;
+} _update_incr;
+
+typedef struct {
+  TCMAP *set;
+  TCLIST *unset;
+  TCMAP *incr;
+  long count;
+} _update_op;
+
+
+/* Whether a column value reads as an integer, so that adding an integer to
+   it need not go through a double. Leading and trailing blanks are allowed,
+   as tcatoi skips them. */
+static bool _is_integer(const char *str) {
+  while (*str > '\0' && *str <= ' ') str++;
+  if (*str == '-' || *str == '+') str++;
+  if (*str < '0' || *str > '9') return false;
+  while (*str >= '0' && *str <= '9') str++;
+  while (*str > '\0' && *str <= ' ') str++;
+  return *str == '\0';
+}
+
+
+static int _update_proc(const void *pkbuf, int pksiz, TCMAP *cols, void *op) {
+  _update_op *uop = (_update_op *)op;
+  const char *kbuf, *vbuf;
+  const _update_incr *inc;
+  char nbuf[64];
+  int ksiz, vsiz, i, len;
+  
+  tcmapiterinit(uop->set);
+  while ( (kbuf = tcmapiternext(uop->set, &ksiz)) != NULL ) {
+    vbuf = tcmapget(uop->set, kbuf, ksiz, &vsiz);
+    tcmapput(cols, kbuf, ksiz, vbuf, vsiz);
+  }
+  for (i = 0; i < TCLISTNUM(uop->unset); i++) {
+    kbuf = tclistval(uop->unset, i, &ksiz);
+    tcmapout(cols, kbuf, ksiz);
+  }
+  tcmapiterinit(uop->incr);
+  while ( (kbuf = tcmapiternext(uop->incr, &ksiz)) != NULL ) {
+    inc = (const _update_incr *)tcmapget(uop->incr, kbuf, ksiz, &vsiz);
+    /* a missing column counts as zero; values are NUL terminated by tc */
+    vbuf = tcmapget(cols, kbuf, ksiz, &vsiz);
+    if (inc->isint && (!vbuf || _is_integer(vbuf))) {
+      len = sprintf(nbuf, "%lld", (long long)((vbuf ? tcatoi(vbuf) : 0) + inc->i));
+    } else {
+      /* an integer added to a column holding a fraction keeps the fraction */
+      double d = (vbuf ? tcatof(vbuf) : 0.0) + (inc->isint ? (double)inc->i : inc->d);
+      /* shortest form that reads back as the same double */
+      len = sprintf(nbuf, "%.15g", d);
+      if (strtod(nbuf, NULL) != d) {
+        len = sprintf(nbuf, "%.17g", d);
+      }
+    }
+    tcmapput(cols, kbuf, ksiz, nbuf, len);
+  }
+  
+  uop->count++;
+  return TDBQPPUT;
+}
+
+
+/* Fill op from the set and incr dicts of update(). Returns false with an
+   exception set on error. */
+static bool _update_op_fill(_update_op *uop, PyObject *set, PyObject *incr) {
+  PyObject *key, *value, *bkey;
+  tc_buffer_t vbuf;
+  Py_ssize_t pos = 0;
+  _update_incr inc;
+  
+  if (set != Py_None) {
+    if (!PyDict_Check(set)) {
+      PyErr_SetString(PyExc_TypeError, "set must be a dictionary");
+      return false;
+    }
+    while (PyDict_Next(set, &pos, &key, &value)) {
+      if ( (bkey = tc_AsBytes(key, "column names")) == NULL ) {
+        return false;
+      }
+      if (value == Py_None) {
+        tclistpush(uop->unset, PyBytes_AS_STRING(bkey), (int)PyBytes_GET_SIZE(bkey));
+      } else {
+        if (tc_Buffer_FromObject(value, &vbuf, "column values") != 0) {
+          Py_DECREF(bkey);
+          return false;
+        }
+        tcmapput(uop->set, PyBytes_AS_STRING(bkey), (int)PyBytes_GET_SIZE(bkey),
+                 TC_BUFFER_BUF(vbuf), TC_BUFFER_LEN(vbuf));
+        TC_BUFFER_RELEASE(vbuf);
+      }
+      Py_DECREF(bkey);
+    }
+  }
+  
+  if (incr != Py_None) {
+    if (!PyDict_Check(incr)) {
+      PyErr_SetString(PyExc_TypeError, "incr must be a dictionary");
+      return false;
+    }
+    pos = 0;
+    while (PyDict_Next(incr, &pos, &key, &value)) {
+      memset(&inc, 0, sizeof(inc));
+      if (PyFloat_Check(value)) {
+        inc.d = PyFloat_AsDouble(value);
+      } else if (NUMBER_Check(value) || PyLong_Check(value)) {
+        inc.isint = true;
+        inc.i = PyLong_AsLongLong(value);
+        if (inc.i == -1 && PyErr_Occurred()) {
+          return false;
+        }
+      } else {
+        PyErr_SetString(PyExc_TypeError, "incr values must be numbers");
+        return false;
+      }
+      if ( (bkey = tc_AsBytes(key, "column names")) == NULL ) {
+        return false;
+      }
+      tcmapput(uop->incr, PyBytes_AS_STRING(bkey), (int)PyBytes_GET_SIZE(bkey), &inc, sizeof(inc));
+      Py_DECREF(bkey);
+    }
+  }
+  return true;
+}
 
 
 /* Public ---------------------------------------------------------------- */
@@ -14,11 +180,15 @@ static void tc_TDBQuery_dealloc(tc_TDBQuery *self) {
   if (self->qry) {
     tctdbqrydel(self->qry);
   }
+  if (self->lock) {
+    PyThread_free_lock(self->lock);
+  }
+  Py_XDECREF(self->tdb);
   PyObject_Del(self);
 }
 
 
-tc_TDBQuery *tc_TDBQuery_new_capi(TCTDB *tdb) {
+tc_TDBQuery *tc_TDBQuery_new_capi(tc_TDB *tdb) {
   log_trace("ENTER");
   tc_TDBQuery *self;
   
@@ -27,7 +197,15 @@ tc_TDBQuery *tc_TDBQuery_new_capi(TCTDB *tdb) {
     return NULL;
   }
   
-  self->qry = tctdbqrynew(tdb);
+  /* keep the table alive for as long as the query */
+  Py_INCREF(tdb);
+  self->tdb = tdb;
+  if (!(self->lock = PyThread_allocate_lock())) {
+    tc_TDBQuery_dealloc(self);
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc query lock");
+    return NULL;
+  }
+  self->qry = tctdbqrynew(tdb->db);
   
   return self;
 }
@@ -45,6 +223,8 @@ static PyObject *tc_TDBQuery_new(PyTypeObject *type, PyObject *args, PyObject *k
   }
   
   self->qry = NULL;
+  self->tdb = NULL;
+  self->lock = NULL;
   
   if (!PyArg_ParseTupleAndKeywords(args, keywds, "O:__new__", kwlist, &tdb)) {
     tc_TDBQuery_dealloc(self);
@@ -57,6 +237,13 @@ static PyObject *tc_TDBQuery_new(PyTypeObject *type, PyObject *args, PyObject *k
     return NULL;
   }
   
+  Py_INCREF(tdb);
+  self->tdb = (tc_TDB *)tdb;
+  if (!(self->lock = PyThread_allocate_lock())) {
+    tc_TDBQuery_dealloc(self);
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc query lock");
+    return NULL;
+  }
   self->qry = tctdbqrynew( ((tc_TDB *)tdb)->db );
   
   return (PyObject *)self;
@@ -76,32 +263,254 @@ static long tc_TDBQuery_hash(PyObject *self) {
 static PyObject *tc_TDBQuery_keys(tc_TDBQuery *self) {
   log_trace("ENTER");
   TCLIST *res;
-  PyObject *pylist, *key;
-  const char *pkbuf;
-  int pksiz, i;
+  PyObject *pylist;
+  tc_StatsTimer timer;
   
-  res = tctdbqrysearch(self->qry);
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
+  TC_STATS_CALL(timer, res = tctdbqrysearch(self->qry));
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, true);
   
-  if ( (pylist = PyList_New( (Py_ssize_t)TCLISTNUM(res) )) == NULL ) {
-    tclistdel(res);
+  pylist = _keys_from_result(res);
+  tclistdel(res);
+  
+  return pylist;
+}
+
+
+/* Combine the results of this query and others with a set operation.
+   This query comes first, so its order and limit apply to the result. */
+static PyObject *tc_TDBQuery_metasearch(tc_TDBQuery *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *others, *seq, *pylist;
+  TDBQRY **qrys;
+  tc_TDBQuery **locked;
+  TCLIST *res;
+  Py_ssize_t i, num;
+  int type = TDBMSUNION;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"others", "type", NULL};
+  
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|i:metasearch", kwlist, &others, &type)) {
+    return NULL;
+  }
+  if ( (seq = PySequence_Fast(others, "others must be a sequence of tc.TDBQuery objects")) == NULL ) {
     return NULL;
   }
+  num = PySequence_Fast_GET_SIZE(seq);
+  qrys = (TDBQRY **)malloc((num + 1) * sizeof(TDBQRY *));
+  locked = (tc_TDBQuery **)malloc((num + 1) * sizeof(tc_TDBQuery *));
+  if (qrys == NULL || locked == NULL) {
+    PyErr_NoMemory();
+    goto error;
+  }
   
-  for(i = 0; i < TCLISTNUM(res); i++){
-    pkbuf = tclistval(res, i, &pksiz);
-    if ( (key = PyBytes_FromStringAndSize(pkbuf, pksiz)) == NULL ) {
-      Py_CLEAR(pylist);
-      break;
+  qrys[0] = self->qry;
+  locked[0] = self;
+  for (i = 0; i < num; i++) {
+    PyObject *other = PySequence_Fast_GET_ITEM(seq, i);
+    if (!PyObject_TypeCheck(other, &tc_TDBQueryType)) {
+      PyErr_SetString(PyExc_TypeError, "others must be a sequence of tc.TDBQuery objects");
+      goto error;
+    }
+    if (((tc_TDBQuery *)other)->tdb != self->tdb) {
+      PyErr_SetString(PyExc_ValueError, "all queries must be on the same table");
+      goto error;
+    }
+    qrys[i + 1] = ((tc_TDBQuery *)other)->qry;
+    locked[i + 1] = (tc_TDBQuery *)other;
+  }
+  /* lock every query once, in address order, so that concurrent
+     metasearches over the same queries cannot deadlock */
+  qsort(locked, num + 1, sizeof(tc_TDBQuery *), _query_cmp);
+  
+  Py_BEGIN_ALLOW_THREADS
+  for (i = 0; i <= num; i++) {
+    if (i == 0 || locked[i] != locked[i - 1]) {
+      _TDBQuery_LOCK(locked[i]);
     }
-    PyList_SET_ITEM(pylist, i, key);
   }
+  TC_STATS_CALL(timer, res = tctdbmetasearch(qrys, (int)num + 1, type));
+  for (i = 0; i <= num; i++) {
+    if (i == 0 || locked[i] != locked[i - 1]) {
+      _TDBQuery_UNLOCK(locked[i]);
+    }
+  }
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, true);
   
+  free(qrys);
+  free(locked);
+  Py_DECREF(seq);
+  pylist = _keys_from_result(res);
   tclistdel(res);
+  return pylist;
+  
+error:
+  free(qrys);
+  free(locked);
+  Py_DECREF(seq);
+  return NULL;
+}
+
+
+/* Run the query and fetch every matching record in one pass without the
+   GIL. Only the requested columns are converted to Python objects. Returns a
+   list of (primary key, columns dict) tuples. */
+static PyObject *tc_TDBQuery_records(tc_TDBQuery *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *columns = Py_None, *pylist = NULL;
+  TCLIST *names = NULL, *res;
+  TCMAP **rows;
+  const char *pkbuf;
+  int pksiz, i, n;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"columns", NULL};
+  
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|O:records", kwlist, &columns)) {
+    return NULL;
+  }
+  if (columns != Py_None && (names = tc_TCLIST_FromStrings(columns, "columns")) == NULL) {
+    return NULL;
+  }
   
+  Py_BEGIN_ALLOW_THREADS
+  timer.begin = tc_Stats_now();
+  _TDBQuery_LOCK(self);
+  res = tctdbqrysearch(self->qry);
+  _TDBQuery_UNLOCK(self);
+  n = TCLISTNUM(res);
+  if ( (rows = (TCMAP **)malloc((n + 1) * sizeof(TCMAP *))) != NULL ) {
+    for (i = 0; i < n; i++) {
+      pkbuf = tclistval(res, i, &pksiz);
+      /* NULL if the record was removed since the search */
+      rows[i] = tctdbget(self->tdb->db, pkbuf, pksiz);
+    }
+  }
+  timer.end = tc_Stats_now();
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, true);
+  
+  if (rows == NULL) {
+    PyErr_NoMemory();
+    goto exit;
+  }
+  if ( (pylist = PyList_New(0)) != NULL ) {
+    for (i = 0; i < n; i++) {
+      PyObject *rec;
+      if (rows[i] == NULL) {
+        continue;
+      }
+      pkbuf = tclistval(res, i, &pksiz);
+      rec = Py_BuildValue("(s#N)", pkbuf, pksiz, tc_PyDict_FromTCMAP(rows[i], names));
+      if (rec == NULL || PyList_Append(pylist, rec) != 0) {
+        Py_XDECREF(rec);
+        Py_CLEAR(pylist);
+        break;
+      }
+      Py_DECREF(rec);
+    }
+  }
+  for (i = 0; i < n; i++) {
+    if (rows[i]) {
+      tcmapdel(rows[i]);
+    }
+  }
+  free(rows);
+  
+exit:
+  tclistdel(res);
+  if (names) {
+    tclistdel(names);
+  }
   return pylist;
 }
 
 
+/* Remove every matching record */
+static PyObject *tc_TDBQuery_delete(tc_TDBQuery *self) {
+  log_trace("ENTER");
+  bool result;
+  tc_StatsTimer timer;
+  
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
+  TC_STATS_CALL(timer, result = tctdbqrysearchout(self->qry));
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, result);
+  if (!result) {
+    tc_Error_SetTDB(self->tdb->db);
+    return NULL;
+  }
+  
+  Py_RETURN_NONE;
+}
+
+
+/* Rewrite every matching record in place. Columns in set are stored (or
+   removed when the value is None), numeric columns in incr are increased.
+   Returns the number of records updated. */
+static PyObject *tc_TDBQuery_update(tc_TDBQuery *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *set = Py_None, *incr = Py_None, *retv = NULL;
+  _update_op uop;
+  bool result;
+  tc_StatsTimer timer;
+  static char *kwlist[] = {"set", "incr", NULL};
+  
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|OO:update", kwlist, &set, &incr)) {
+    return NULL;
+  }
+  
+  uop.set = tcmapnew();
+  uop.unset = tclistnew();
+  uop.incr = tcmapnew();
+  uop.count = 0;
+  if (!_update_op_fill(&uop, set, incr)) {
+    goto exit;
+  }
+  
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
+  TC_STATS_CALL(timer, result = tctdbqryproc(self->qry, _update_proc, &uop));
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, result);
+  if (!result) {
+    tc_Error_SetTDB(self->tdb->db);
+    goto exit;
+  }
+  retv = NUMBER_FromLong(uop.count);
+  
+exit:
+  tcmapdel(uop.set);
+  tclistdel(uop.unset);
+  tcmapdel(uop.incr);
+  return retv;
+}
+
+
+/* Run the query and return an iterator over the matching primary keys,
+   which owns the result */
+static PyObject *tc_TDBQuery_GetIter(tc_TDBQuery *self) {
+  log_trace("ENTER");
+  TCLIST *res;
+  tc_StatsTimer timer;
+  
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
+  TC_STATS_CALL(timer, res = tctdbqrysearch(self->qry));
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, true);
+  
+  return (PyObject *)tc_TDBQueryIterator_new_capi(res);
+}
+
+
 static PyObject *tc_TDBQuery_filter(tc_TDBQuery *self, PyObject *args, PyObject *keywds) {
   log_trace("ENTER");
   const char *column;
@@ -121,7 +530,11 @@ static PyObject *tc_TDBQuery_filter(tc_TDBQuery *self, PyObject *args, PyObject
     column = ""; /* primary key */
   }
   
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
   tctdbqryaddcond(self->qry, column, operation, expression);
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
   
   Py_INCREF(self);
   return (PyObject *)self;
@@ -143,6 +556,8 @@ static PyObject *tc_TDBQuery_order(tc_TDBQuery *self, PyObject *args, PyObject *
     column = ""; /* primary key */
   }
   
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
   if (type > -1) {
     tctdbqrysetorder(self->qry, column, type);
   }
@@ -152,12 +567,55 @@ static PyObject *tc_TDBQuery_order(tc_TDBQuery *self, PyObject *args, PyObject *
     self->qry->oname = NULL;
     self->qry->otype = TDBQOSTRASC;
   }
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
   
   Py_INCREF(self);
   return (PyObject *)self;
 }
 
 
+/* A negative max means no limit */
+static PyObject *tc_TDBQuery_limit(tc_TDBQuery *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  int max, skip = 0;
+  static char *kwlist[] = {"max", "skip", NULL};
+  
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "i|i:limit", kwlist, &max, &skip)) {
+    return NULL;
+  }
+  
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
+  tctdbqrysetlimit(self->qry, max, skip);
+  _TDBQuery_UNLOCK(self);
+  Py_END_ALLOW_THREADS
+  
+  Py_INCREF(self);
+  return (PyObject *)self;
+}
+
+
+/* Number of matching records. Honours limit(). */
+static PyObject *tc_TDBQuery_count(tc_TDBQuery *self) {
+  log_trace("ENTER");
+  TCLIST *res;
+  int count;
+  tc_StatsTimer timer;
+  
+  Py_BEGIN_ALLOW_THREADS
+  _TDBQuery_LOCK(self);
+  TC_STATS_CALL(timer, res = tctdbqrysearch(self->qry));
+  _TDBQuery_UNLOCK(self);
+  count = TCLISTNUM(res);
+  tclistdel(res);
+  Py_END_ALLOW_THREADS
+  tc_Stats_record(self->tdb->stats, TC_OP_QUERY, &timer, 0, 0, true);
+  
+  return NUMBER_FromLong((long)count);
+}
+
+
 /* Type ------------------------------------------------------------------ */
 
 
@@ -165,10 +623,24 @@ static PyObject *tc_TDBQuery_order(tc_TDBQuery *self, PyObject *args, PyObject *
 static PyMethodDef tc_TDBQuery_methods[] = {
   {"keys", (PyCFunction)tc_TDBQuery_keys, METH_NOARGS,
     "Retrieve primary keys."},
+  {"metasearch", (PyCFunction)tc_TDBQuery_metasearch, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve primary keys of the union (TDBMSUNION), intersection (TDBMSISECT) or\n"
+    "difference (TDBMSDIFF) of this query and a sequence of other queries."},
+  {"records", (PyCFunction)tc_TDBQuery_records, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve matching records as (primary key, columns) tuples, optionally limited to some columns."},
+  {"delete", (PyCFunction)tc_TDBQuery_delete, METH_NOARGS,
+    "Remove matching records."},
+  {"update", (PyCFunction)tc_TDBQuery_update, METH_VARARGS | METH_KEYWORDS,
+    "Store the columns in set and add the numbers in incr to matching records.\n"
+    "Returns the number of records updated."},
   {"filter", (PyCFunction)tc_TDBQuery_filter, METH_VARARGS | METH_KEYWORDS,
     "Filter by condition."},
   {"order", (PyCFunction)tc_TDBQuery_order, METH_VARARGS | METH_KEYWORDS,
     "Set order."},
+  {"limit", (PyCFunction)tc_TDBQuery_limit, METH_VARARGS | METH_KEYWORDS,
+    "Set the maximum number of records in the result and the number of records to skip."},
+  {"count", (PyCFunction)tc_TDBQuery_count, METH_NOARGS,
+    "Get the number of matching records."},
   {NULL, NULL, 0, NULL}
 };
 
@@ -204,8 +676,8 @@ PyTypeObject tc_TDBQueryType = {
   0,                                           /* tp_clear */
   0,                                           /* tp_richcompare */
   0,                                           /* tp_weaklistoffset */
-  (getiterfunc)0,                              /* tp_iter */
-  (iternextfunc)0,                             /* tp_iternext */
+  (getiterfunc)tc_TDBQuery_GetIter,            /* tp_iter */
+  0,                                           /* tp_iternext */
   tc_TDBQuery_methods,                         /* tp_methods */
   0,                                           /* tp_members */
   0,                                           /* tp_getset */
@@ -2,17 +2,21 @@
 #define PYTC_TDBQUERY_H
 
 #include "_base.h"
+#include <pythread.h>
 #include <tctdb.h>
+#include "TDB.h"
 
 typedef struct {
   PyObject_HEAD
+  tc_TDB *tdb;
   TDBQRY *qry;
+  PyThread_type_lock lock; /* serializes use of qry, which tc modifies while searching */
 } tc_TDBQuery;
 
 extern PyTypeObject tc_TDBQueryType;
 
 int tc_TDBQuery_register(PyObject *module);
 
-tc_TDBQuery *tc_TDBQuery_new_capi(TCTDB *tdb);
+tc_TDBQuery *tc_TDBQuery_new_capi(tc_TDB *tdb);
 
 #endif
@@ -0,0 +1,89 @@
+#include "TDBQueryIterator.h"
+
+/* Public ---------------------------------------------------------------- */
+
+/* Takes res over, deleting it on errors */
+tc_TDBQueryIterator *tc_TDBQueryIterator_new_capi(TCLIST *res) {
+  log_trace("ENTER");
+  tc_TDBQueryIterator *self;
+
+  if (!(self = (tc_TDBQueryIterator *)tc_TDBQueryIteratorType.tp_alloc(&tc_TDBQueryIteratorType, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_TDBQueryIterator instance");
+    tclistdel(res);
+    return NULL;
+  }
+  self->res = res;
+  return self;
+}
+
+static void tc_TDBQueryIterator_dealloc(tc_TDBQueryIterator *self) {
+  log_trace("ENTER");
+  if (self->res) {
+    tclistdel(self->res);
+  }
+  PyObject_Del(self);
+}
+
+static PyObject *tc_TDBQueryIterator_iternext(tc_TDBQueryIterator *self) {
+  log_trace("ENTER");
+  PyObject *key;
+  char *pkbuf;
+  int pksiz;
+
+  if (self->res == NULL) {
+    return NULL;
+  }
+  if (!(pkbuf = tclistshift(self->res, &pksiz))) {
+    tclistdel(self->res);
+    self->res = NULL;
+    return NULL;
+  }
+  key = PyBytes_FromStringAndSize(pkbuf, pksiz);
+  free(pkbuf);
+  return key;
+}
+
+/* Type ------------------------------------------------------------------ */
+
+PyTypeObject tc_TDBQueryIteratorType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.TDBQueryIterator",                    /* tp_name */
+  sizeof(tc_TDBQueryIterator),              /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)tc_TDBQueryIterator_dealloc,  /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  0,                                        /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash  */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,                       /* tp_flags */
+  "Tokyo Cabinet table database query iterator", /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  PyObject_SelfIter,                        /* tp_iter */
+  (iternextfunc)tc_TDBQueryIterator_iternext, /* tp_iternext */
+  0,                                        /* tp_methods */
+};
+
+int tc_TDBQueryIterator_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_TDBQueryIteratorType) == 0)
+    return PyModule_AddObject(module, "TDBQueryIterator", (PyObject *)&tc_TDBQueryIteratorType);
+  return -1;
+}
@@ -0,0 +1,22 @@
+#ifndef PYTC_TDBQUERYITERATOR_H
+#define PYTC_TDBQUERYITERATOR_H
+
+#include "_base.h"
+#include <tctdb.h>
+
+/* An iterator over the primary keys matching a query. Each iterator owns
+   the result of its own search, so several can be in use on one query at
+   the same time. Keys are moved out of the result one at a time, so only
+   the keys not yet consumed are held in memory. */
+typedef struct {
+  PyObject_HEAD
+  TCLIST *res;
+} tc_TDBQueryIterator;
+
+extern PyTypeObject tc_TDBQueryIteratorType;
+
+tc_TDBQueryIterator *tc_TDBQueryIterator_new_capi(TCLIST *res);
+
+int tc_TDBQueryIterator_register(PyObject *module);
+
+#endif
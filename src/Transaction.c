@@ -0,0 +1,141 @@
+#include "Transaction.h"
+
+/* Public ---------------------------------------------------------------- */
+
+static long tc_Transaction_Hash(PyObject *self) {
+  log_trace("ENTER");
+  PyErr_SetString(PyExc_TypeError, "Transaction objects are unhashable");
+  return -1L;
+}
+
+static void tc_Transaction_dealloc(tc_Transaction *self) {
+  log_trace("ENTER");
+  Py_XDECREF(self->db);
+  PyObject_Del(self);
+}
+
+PyObject *tc_Transaction_New(PyObject *db) {
+  log_trace("ENTER");
+  tc_Transaction *self;
+
+  if (!(self = PyObject_New(tc_Transaction, &tc_TransactionType))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_Transaction instance");
+    return NULL;
+  }
+  Py_INCREF(db);
+  self->db = db;
+  self->active = false;
+  return (PyObject *)self;
+}
+
+static PyObject *tc_Transaction_call(tc_Transaction *self, char *method) {
+  PyObject *ret;
+
+  if (!(ret = PyObject_CallMethod(self->db, method, NULL))) {
+    return NULL;
+  }
+  Py_DECREF(ret);
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_Transaction_enter(tc_Transaction *self) {
+  log_trace("ENTER");
+  PyObject *ret;
+
+  if (self->active) {
+    PyErr_SetString(PyExc_RuntimeError, "transaction already in progress");
+    return NULL;
+  }
+  if (!(ret = tc_Transaction_call(self, "tranbegin"))) {
+    return NULL;
+  }
+  Py_DECREF(ret);
+  self->active = true;
+  Py_INCREF(self->db);
+  return self->db;
+}
+
+static PyObject *tc_Transaction_exit(tc_Transaction *self, PyObject *args) {
+  log_trace("ENTER");
+  PyObject *type, *value, *traceback, *ret;
+
+  if (!PyArg_UnpackTuple(args, "__exit__", 3, 3, &type, &value, &traceback)) {
+    return NULL;
+  }
+  if (!self->active) {
+    PyErr_SetString(PyExc_RuntimeError, "no transaction in progress");
+    return NULL;
+  }
+  self->active = false;
+  if (type == Py_None) {
+    return tc_Transaction_call(self, "trancommit");
+  }
+  /* let the exception of the block propagate */
+  if (!(ret = tc_Transaction_call(self, "tranabort"))) {
+    return NULL;
+  }
+  Py_DECREF(ret);
+  Py_RETURN_FALSE;
+}
+
+/* methods of classes */
+static PyMethodDef tc_Transaction_methods[] = {
+  {"__enter__", (PyCFunction)tc_Transaction_enter, METH_NOARGS,
+    "Begin the transaction. Returns the database."},
+  {"__exit__", (PyCFunction)tc_Transaction_exit, METH_VARARGS,
+    "Commit the transaction, or abort it if an exception was raised."},
+  {NULL, NULL, 0, NULL}
+};
+
+PyTypeObject tc_TransactionType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.Transaction",                            /* tp_name */
+  sizeof(tc_Transaction),                      /* tp_basicsize */
+  0,                                           /* tp_itemsize */
+  (destructor)tc_Transaction_dealloc,          /* tp_dealloc */
+  0,                                           /* tp_print */
+  0,                                           /* tp_getattr */
+  0,                                           /* tp_setattr */
+  0,                                           /* tp_compare */
+  0,                                           /* tp_repr */
+  0,                                           /* tp_as_number */
+  0,                                           /* tp_as_sequence */
+  0,                                           /* tp_as_mapping */
+  tc_Transaction_Hash,                         /* tp_hash  */
+  0,                                           /* tp_call */
+  0,                                           /* tp_str */
+  0,                                           /* tp_getattro */
+  0,                                           /* tp_setattro */
+  0,                                           /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,                          /* tp_flags */
+  "Transaction of a database",                 /* tp_doc */
+  0,                                           /* tp_traverse */
+  0,                                           /* tp_clear */
+  0,                                           /* tp_richcompare */
+  0,                                           /* tp_weaklistoffset */
+  0,                                           /* tp_iter */
+  0,                                           /* tp_iternext */
+  tc_Transaction_methods,                      /* tp_methods */
+  0,                                           /* tp_members */
+  0,                                           /* tp_getset */
+  0,                                           /* tp_base */
+  0,                                           /* tp_dict */
+  0,                                           /* tp_descr_get */
+  0,                                           /* tp_descr_set */
+  0,                                           /* tp_dictoffset */
+  0,                                           /* tp_init */
+  0,                                           /* tp_alloc */
+  0,                                           /* tp_new */
+};
+
+int tc_Transaction_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_TransactionType) == 0)
+    return PyModule_AddObject(module, "Transaction", (PyObject *)&tc_TransactionType);
+  return -1;
+}
@@ -0,0 +1,20 @@
+#ifndef PYTC_TRANSACTION_H
+#define PYTC_TRANSACTION_H
+
+#include "_base.h"
+
+/* Context manager returned by the transaction() method of databases. It
+   calls tranbegin() of db on enter and trancommit() or, if the block
+   raised, tranabort() on exit. */
+typedef struct {
+  PyObject_HEAD
+  PyObject *db;
+  bool active;
+} tc_Transaction;
+
+extern PyTypeObject tc_TransactionType;
+
+PyObject *tc_Transaction_New(PyObject *db);
+int tc_Transaction_register(PyObject *module);
+
+#endif
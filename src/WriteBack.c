@@ -0,0 +1,614 @@
+#include "WriteBack.h"
+#include "HDB.h"
+#include "BDB.h"
+#include "util.h"
+#include <errno.h>
+#include <sys/time.h>
+
+/* Private --------------------------------------------------------------- */
+
+#define TC_WRITEBACK_OPS(name,type,prefix) \
+  static bool name ## _put(void *db, const void *kbuf, int ksiz, const void *vbuf, int vsiz) { \
+    return prefix ## put((type *)db, kbuf, ksiz, vbuf, vsiz); \
+  } \
+  static bool name ## _out(void *db, const void *kbuf, int ksiz) { \
+    return prefix ## out((type *)db, kbuf, ksiz); \
+  } \
+  static void *name ## _get(void *db, const void *kbuf, int ksiz, int *sp) { \
+    return prefix ## get((type *)db, kbuf, ksiz, sp); \
+  } \
+  static bool name ## _tranbegin(void *db) { \
+    return prefix ## tranbegin((type *)db); \
+  } \
+  static bool name ## _trancommit(void *db) { \
+    return prefix ## trancommit((type *)db); \
+  } \
+  static bool name ## _tranabort(void *db) { \
+    return prefix ## tranabort((type *)db); \
+  } \
+  static bool name ## _sync(void *db) { \
+    return prefix ## sync((type *)db); \
+  } \
+  static int name ## _ecode(void *db) { \
+    return prefix ## ecode((type *)db); \
+  } \
+  static const tc_WriteBackOps name = { \
+    name ## _put, name ## _out, name ## _get, name ## _tranbegin, \
+    name ## _trancommit, name ## _tranabort, name ## _sync, name ## _ecode, \
+    prefix ## errmsg \
+  };
+
+TC_WRITEBACK_OPS(_hdb_ops, TCHDB, tchdb);
+TC_WRITEBACK_OPS(_bdb_ops, TCBDB, tcbdb);
+
+static void _deadline(struct timespec *ts, double interval) {
+  struct timeval now;
+  double secs;
+
+  gettimeofday(&now, NULL);
+  secs = now.tv_sec + now.tv_usec / 1e6 + interval;
+  ts->tv_sec = (time_t)secs;
+  ts->tv_nsec = (long)((secs - ts->tv_sec) * 1e9);
+}
+
+/* Write a memtable to the database in one transaction. Called without the
+   mutex; readers may look into the memtable at the same time, nobody
+   changes it. Returns an error code, TCESUCCESS if all went well. The
+   transaction is the one of the handle: tranbegin waits for one begun by
+   a user to end, and direct writes to the handle meanwhile join it. */
+static int _write(tc_WriteBack *self, TCMAP *map) {
+  void *db = self->handle;
+  const tc_WriteBackOps *ops = self->ops;
+  const char *kbuf, *vbuf;
+  int ksiz, vsiz, ecode;
+  bool ok = true;
+
+  if (!ops->tranbegin(db)) {
+    return ops->ecode(db);
+  }
+  tcmapiterinit(map);
+  while (ok && (kbuf = tcmapiternext(map, &ksiz))) {
+    vbuf = tcmapiterval(kbuf, &vsiz);
+    if (*vbuf == TC_WRITEBACK_PUT) {
+      ok = ops->put(db, kbuf, ksiz, vbuf + 1, vsiz - 1);
+    } else {
+      ok = ops->out(db, kbuf, ksiz) || ops->ecode(db) == TCENOREC;
+    }
+  }
+  if (ok) {
+    return ops->trancommit(db) ? TCESUCCESS : ops->ecode(db);
+  }
+  ecode = ops->ecode(db);
+  ops->tranabort(db);
+  return ecode;
+}
+
+/* Move the active memtable to the database. Called with the mutex held,
+   which is released while writing. */
+static void _flush(tc_WriteBack *self) {
+  TCMAP *map;
+  uint64_t seq;
+  int ecode;
+
+  if (tcmaprnum(self->active) > 0) {
+    map = self->flushing = self->active;
+    self->active = tcmapnew();
+    seq = self->seq;
+    pthread_mutex_unlock(&self->mutex);
+    ecode = _write(self, map);
+    pthread_mutex_lock(&self->mutex);
+    if (ecode == TCESUCCESS) {
+      self->flushing = NULL;
+      tcmapdel(map);
+      self->flushed = seq;
+    } else {
+      /* the records stay readable in the flushing memtable */
+      self->ecode = ecode;
+    }
+  } else {
+    self->flushed = self->seq;
+  }
+  self->flushreq = false;
+  pthread_cond_broadcast(&self->done);
+}
+
+static void *_flusher(void *arg) {
+  tc_WriteBack *self = (tc_WriteBack *)arg;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&self->mutex);
+  _deadline(&deadline, self->interval);
+  while (!self->stop) {
+    if (self->ecode) {
+      pthread_cond_wait(&self->wake, &self->mutex);
+      continue;
+    }
+    if (!self->flushreq && (int64_t)tcmapmsiz(self->active) < self->bufsiz &&
+        pthread_cond_timedwait(&self->wake, &self->mutex, &deadline) != ETIMEDOUT) {
+      continue;
+    }
+    _flush(self);
+    _deadline(&deadline, self->interval);
+  }
+  if (!self->ecode) {
+    _flush(self);
+  }
+  pthread_cond_broadcast(&self->done);
+  pthread_mutex_unlock(&self->mutex);
+  return NULL;
+}
+
+/* Error of the layer, or 0. Called with the mutex held. */
+static int _status(tc_WriteBack *self) {
+  if (self->ecode) {
+    return self->ecode;
+  }
+  if (self->stop) {
+    return TCEINVALID;
+  }
+  return TCESUCCESS;
+}
+
+static void _set_error(tc_WriteBack *self, int ecode) {
+  tc_Error_SetCodeAndString(ecode, self->ops->errmsg(ecode));
+}
+
+/* Add a record to the active memtable, waiting while it is full. Must be
+   called without the GIL. */
+static int _store(tc_WriteBack *self, const char *kbuf, int ksiz, char flag,
+                  const char *vbuf, int vsiz) {
+  char *rec;
+  int ecode;
+
+  if (!(rec = malloc(vsiz + 1))) {
+    return TCEMISC;
+  }
+  rec[0] = flag;
+  memcpy(rec + 1, vbuf, vsiz);
+  pthread_mutex_lock(&self->mutex);
+  while (!(ecode = _status(self)) && (int64_t)tcmapmsiz(self->active) >= self->maxsiz) {
+    pthread_cond_signal(&self->wake);
+    pthread_cond_wait(&self->done, &self->mutex);
+  }
+  if (!ecode) {
+    tcmapput(self->active, kbuf, ksiz, rec, vsiz + 1);
+    self->seq++;
+    if ((int64_t)tcmapmsiz(self->active) >= self->bufsiz) {
+      pthread_cond_signal(&self->wake);
+    }
+  }
+  pthread_mutex_unlock(&self->mutex);
+  free(rec);
+  return ecode;
+}
+
+/* Look a key up in the memtables, newest first. Must be called without the
+   GIL. Returns 1 with a copy of the value, 0 if the record was removed and
+   -1 if the database has to be asked. */
+static int _lookup(tc_WriteBack *self, const char *kbuf, int ksiz, char **vp, int *sp) {
+  const char *rec = NULL;
+  int size, ret = -1;
+
+  pthread_mutex_lock(&self->mutex);
+  if (!(rec = tcmapget(self->active, kbuf, ksiz, &size)) && self->flushing) {
+    rec = tcmapget(self->flushing, kbuf, ksiz, &size);
+  }
+  if (rec) {
+    if (*rec == TC_WRITEBACK_PUT) {
+      *sp = size - 1;
+      if ((*vp = malloc(size))) {
+        memcpy(*vp, rec + 1, size - 1);
+        ret = 1;
+      }
+    } else {
+      ret = 0;
+    }
+  }
+  pthread_mutex_unlock(&self->mutex);
+  return ret;
+}
+
+/* Stop the flusher after a last flush. Must be called without the GIL. */
+static void _stop(tc_WriteBack *self) {
+  pthread_mutex_lock(&self->mutex);
+  self->stop = true;
+  pthread_cond_signal(&self->wake);
+  pthread_mutex_unlock(&self->mutex);
+  if (self->started) {
+    pthread_join(self->thread, NULL);
+    self->started = false;
+  }
+}
+
+/* Public ---------------------------------------------------------------- */
+
+static long tc_WriteBack_Hash(PyObject *self) {
+  log_trace("ENTER");
+  PyErr_SetString(PyExc_TypeError, "WriteBack objects are unhashable");
+  return -1L;
+}
+
+static void tc_WriteBack_dealloc(tc_WriteBack *self) {
+  log_trace("ENTER");
+  Py_BEGIN_ALLOW_THREADS
+  _stop(self);
+  Py_END_ALLOW_THREADS
+  if (self->active) {
+    tcmapdel(self->active);
+  }
+  if (self->flushing) {
+    tcmapdel(self->flushing);
+  }
+  pthread_cond_destroy(&self->done);
+  pthread_cond_destroy(&self->wake);
+  pthread_mutex_destroy(&self->mutex);
+  Py_XDECREF(self->db);
+  PyObject_Del(self);
+}
+
+static PyObject *tc_WriteBack_new(PyTypeObject *type, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  tc_WriteBack *self;
+  PyObject *db;
+  void *handle, *mmtx;
+  tc_codec_t *codec;
+  const tc_WriteBackOps *ops;
+  double interval = 1.0;
+  PY_LONG_LONG bufsiz = 1 << 22, maxsiz = 0;
+  static char *kwlist[] = {"db", "interval", "bufsiz", "maxsiz", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|dLL:WriteBack", kwlist,
+                                   &db, &interval, &bufsiz, &maxsiz)) {
+    return NULL;
+  }
+  if (PyObject_TypeCheck(db, &tc_HDBType)) {
+    handle = ((tc_HDB *)db)->hdb;
+    codec = &((tc_HDB *)db)->codec;
+    mmtx = ((TCHDB *)handle)->mmtx;
+    ops = &_hdb_ops;
+  } else if (PyObject_TypeCheck(db, &tc_BDBType)) {
+    handle = ((tc_BDB *)db)->bdb;
+    codec = &((tc_BDB *)db)->codec;
+    mmtx = ((TCBDB *)handle)->mmtx;
+    ops = &_bdb_ops;
+  } else {
+    PyErr_SetString(PyExc_TypeError, "db must be an HDB or BDB object");
+    return NULL;
+  }
+  /* the flusher uses the database from a thread of its own */
+  if (!mmtx) {
+    PyErr_SetString(PyExc_ValueError, "setmutex() must be called on db before it is opened");
+    return NULL;
+  }
+  if (interval <= 0 || bufsiz <= 0) {
+    PyErr_SetString(PyExc_ValueError, "interval and bufsiz must be positive");
+    return NULL;
+  }
+  if (!(self = (tc_WriteBack *)type->tp_alloc(type, 0))) {
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc tc_WriteBack instance");
+    return NULL;
+  }
+  Py_INCREF(db);
+  self->db = db;
+  self->handle = handle;
+  self->codec = codec;
+  self->ops = ops;
+  self->interval = interval;
+  self->bufsiz = bufsiz;
+  self->maxsiz = max(maxsiz > 0 ? maxsiz : bufsiz * 4, bufsiz);
+  pthread_mutex_init(&self->mutex, NULL);
+  pthread_cond_init(&self->wake, NULL);
+  pthread_cond_init(&self->done, NULL);
+  self->active = tcmapnew();
+  if (pthread_create(&self->thread, NULL, _flusher, self) != 0) {
+    PyErr_SetString(PyExc_RuntimeError, "Cannot start flusher thread");
+    Py_DECREF(self);
+    return NULL;
+  }
+  self->started = true;
+  return (PyObject *)self;
+}
+
+static PyObject *tc_WriteBack_store(tc_WriteBack *self, const char *key, int key_len,
+                                    char flag, const char *value, int value_len) {
+  int ecode;
+
+  Py_BEGIN_ALLOW_THREADS
+  ecode = _store(self, key, key_len, flag, value, value_len);
+  Py_END_ALLOW_THREADS
+
+  if (ecode) {
+    _set_error(self, ecode);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_WriteBack_put(tc_WriteBack *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *ret, *_value;
+  char *key;
+  int key_len;
+  tc_buffer_t value;
+  static char *kwlist[] = {"key", "value", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#O:put", kwlist,
+                                   &key, &key_len, &_value) ||
+      tc_Codec_Buffer(*self->codec, _value, &value, "values") != 0) {
+    return NULL;
+  }
+  ret = tc_WriteBack_store(self, key, key_len, TC_WRITEBACK_PUT,
+                           TC_BUFFER_BUF(value), TC_BUFFER_LEN(value));
+  TC_BUFFER_RELEASE(value);
+  return ret;
+}
+
+static PyObject *tc_WriteBack_out(tc_WriteBack *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
+  static char *kwlist[] = {"key", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:out", kwlist, &key, &key_len)) {
+    return NULL;
+  }
+  return tc_WriteBack_store(self, key, key_len, TC_WRITEBACK_OUT, "", 0);
+}
+
+static PyObject *tc_WriteBack_GetItem(tc_WriteBack *self, const char *key, int key_len) {
+  PyObject *ret;
+  char *value = NULL;
+  int value_len = 0, found, ecode = TCESUCCESS;
+
+  Py_BEGIN_ALLOW_THREADS
+  if ((found = _lookup(self, key, key_len, &value, &value_len)) == -1) {
+    if ((value = self->ops->get(self->handle, key, key_len, &value_len))) {
+      found = 1;
+    } else {
+      ecode = self->ops->ecode(self->handle);
+    }
+  }
+  Py_END_ALLOW_THREADS
+
+  if (found != 1) {
+    if (found == 0 || ecode == TCENOREC) {
+      PyErr_SetString(PyExc_KeyError, self->ops->errmsg(TCENOREC));
+    } else {
+      _set_error(self, ecode);
+    }
+    return NULL;
+  }
+  ret = tc_Codec_Value(*self->codec, value, value_len);
+  free(value);
+  return ret;
+}
+
+static PyObject *tc_WriteBack_get(tc_WriteBack *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  char *key;
+  int key_len;
+  static char *kwlist[] = {"key", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:get", kwlist, &key, &key_len)) {
+    return NULL;
+  }
+  return tc_WriteBack_GetItem(self, key, key_len);
+}
+
+/* Wait until every write made before the call is in the database */
+static PyObject *tc_WriteBack_flush(tc_WriteBack *self, PyObject *args, PyObject *keywds) {
+  log_trace("ENTER");
+  PyObject *sync = NULL;
+  uint64_t target;
+  int ecode, dosync = 0;
+  bool synced = true;
+  static char *kwlist[] = {"sync", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(args, keywds, "|O:flush", kwlist, &sync) ||
+      (sync && (dosync = PyObject_IsTrue(sync)) < 0)) {
+    return NULL;
+  }
+  Py_BEGIN_ALLOW_THREADS
+  pthread_mutex_lock(&self->mutex);
+  target = self->seq;
+  while (!(ecode = _status(self)) && self->flushed < target) {
+    self->flushreq = true;
+    pthread_cond_signal(&self->wake);
+    pthread_cond_wait(&self->done, &self->mutex);
+  }
+  pthread_mutex_unlock(&self->mutex);
+  if (!ecode && dosync) {
+    if (!(synced = self->ops->sync(self->handle))) {
+      ecode = self->ops->ecode(self->handle);
+    }
+  }
+  Py_END_ALLOW_THREADS
+
+  if (ecode || !synced) {
+    _set_error(self, ecode);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *tc_WriteBack_close(tc_WriteBack *self) {
+  log_trace("ENTER");
+  int ecode;
+
+  Py_BEGIN_ALLOW_THREADS
+  _stop(self);
+  ecode = self->ecode;
+  Py_END_ALLOW_THREADS
+
+  if (ecode) {
+    _set_error(self, ecode);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+/* Number of records not yet written to the database */
+static PyObject *tc_WriteBack_pending(tc_WriteBack *self) {
+  log_trace("ENTER");
+  uint64_t num;
+
+  pthread_mutex_lock(&self->mutex);
+  num = tcmaprnum(self->active) + (self->flushing ? tcmaprnum(self->flushing) : 0);
+  pthread_mutex_unlock(&self->mutex);
+  return PyLong_FromUnsignedLongLong(num);
+}
+
+
+/* for dict like interface. Keys are parsed with "s#" like put() and get(),
+   and like the database the records are flushed into. */
+static PyObject *tc_WriteBack_subscript(tc_WriteBack *self, PyObject *_key) {
+  char *key;
+  int key_len;
+
+  if (!PyArg_Parse(_key, "s#", &key, &key_len)) {
+    return NULL;
+  }
+  return tc_WriteBack_GetItem(self, key, key_len);
+}
+
+static int tc_WriteBack_Contains(tc_WriteBack *self, PyObject *_key) {
+  PyObject *value;
+
+  if ((value = tc_WriteBack_subscript(self, _key))) {
+    Py_DECREF(value);
+    return 1;
+  }
+  if (PyErr_ExceptionMatches(PyExc_KeyError)) {
+    PyErr_Clear();
+    return 0;
+  }
+  return -1;
+}
+
+TC_XDB___contains__(tc_WriteBack___contains__,tc_WriteBack,tc_WriteBack_Contains);
+
+static int tc_WriteBack_ass_sub(tc_WriteBack *self, PyObject *_key, PyObject *_value) {
+  char *key;
+  int key_len, ecode;
+  tc_buffer_t value;
+
+  if (!PyArg_Parse(_key, "s#", &key, &key_len)) {
+    return -1;
+  }
+  if (_value) {
+    if (tc_Codec_Buffer(*self->codec, _value, &value, "values") != 0) {
+      return -1;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    ecode = _store(self, key, key_len, TC_WRITEBACK_PUT,
+                   TC_BUFFER_BUF(value), TC_BUFFER_LEN(value));
+    Py_END_ALLOW_THREADS
+    TC_BUFFER_RELEASE(value);
+  } else {
+    Py_BEGIN_ALLOW_THREADS
+    ecode = _store(self, key, key_len, TC_WRITEBACK_OUT, "", 0);
+    Py_END_ALLOW_THREADS
+  }
+  if (ecode) {
+    _set_error(self, ecode);
+    return -1;
+  }
+  return 0;
+}
+
+/* methods of classes */
+static PyMethodDef tc_WriteBack_methods[] = {
+  {"put", (PyCFunction)tc_WriteBack_put, METH_VARARGS | METH_KEYWORDS,
+    "Store a record. It is written to the database by the flusher thread."},
+  {"out", (PyCFunction)tc_WriteBack_out, METH_VARARGS | METH_KEYWORDS,
+    "Remove a record. A missing record is not an error."},
+  {"get", (PyCFunction)tc_WriteBack_get, METH_VARARGS | METH_KEYWORDS,
+    "Retrieve a record, looking into the memtables before the database."},
+  {"flush", (PyCFunction)tc_WriteBack_flush, METH_VARARGS | METH_KEYWORDS,
+    "Wait until all records stored so far are written to the database.\n"
+   "If sync is true, the database is synchronized with the device afterwards."},
+  {"close", (PyCFunction)tc_WriteBack_close, METH_NOARGS,
+    "Flush all records and stop the flusher thread."},
+  {"pending", (PyCFunction)tc_WriteBack_pending, METH_NOARGS,
+    "Get the number of records not yet written to the database."},
+  {"__contains__", (PyCFunction)tc_WriteBack___contains__, METH_O | METH_COEXIST,
+    NULL},
+  {"__getitem__", (PyCFunction)tc_WriteBack_subscript, METH_O | METH_COEXIST,
+    NULL},
+  {"has_key", (PyCFunction)tc_WriteBack___contains__, METH_O,
+    NULL},
+  {NULL, NULL, 0, NULL}
+};
+
+/* Hack to implement "key in dict" */
+static PySequenceMethods tc_WriteBack_as_sequence = {
+  0,                                 /* sq_length */
+  0,                                 /* sq_concat */
+  0,                                 /* sq_repeat */
+  0,                                 /* sq_item */
+  0,                                 /* sq_slice */
+  0,                                 /* sq_ass_item */
+  0,                                 /* sq_ass_slice */
+  (objobjproc)tc_WriteBack_Contains, /* sq_contains */
+  0,                                 /* sq_inplace_concat */
+  0,                                 /* sq_inplace_repeat */
+};
+
+static PyMappingMethods tc_WriteBack_as_mapping = {
+  0,                                   /* mp_length (inquiry/lenfunc )*/
+  (binaryfunc)tc_WriteBack_subscript,  /* mp_subscript */
+  (objobjargproc)tc_WriteBack_ass_sub, /* mp_ass_subscript */
+};
+
+PyTypeObject tc_WriteBackType = {
+  #if (PY_VERSION_HEX < 0x03000000)
+    PyObject_HEAD_INIT(NULL)
+    0,                  /*ob_size*/
+  #else
+    PyVarObject_HEAD_INIT(NULL, 0)
+  #endif
+  "tc.WriteBack",                              /* tp_name */
+  sizeof(tc_WriteBack),                        /* tp_basicsize */
+  0,                                           /* tp_itemsize */
+  (destructor)tc_WriteBack_dealloc,            /* tp_dealloc */
+  0,                                           /* tp_print */
+  0,                                           /* tp_getattr */
+  0,                                           /* tp_setattr */
+  0,                                           /* tp_compare */
+  0,                                           /* tp_repr */
+  0,                                           /* tp_as_number */
+  &tc_WriteBack_as_sequence,                   /* tp_as_sequence */
+  &tc_WriteBack_as_mapping,                    /* tp_as_mapping */
+  tc_WriteBack_Hash,                           /* tp_hash  */
+  0,                                           /* tp_call */
+  0,                                           /* tp_str */
+  0,                                           /* tp_getattro */
+  0,                                           /* tp_setattro */
+  0,                                           /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,    /* tp_flags */
+  "Write-back layer in front of an HDB or BDB", /* tp_doc */
+  0,                                           /* tp_traverse */
+  0,                                           /* tp_clear */
+  0,                                           /* tp_richcompare */
+  0,                                           /* tp_weaklistoffset */
+  0,                                           /* tp_iter */
+  0,                                           /* tp_iternext */
+  tc_WriteBack_methods,                        /* tp_methods */
+  0,                                           /* tp_members */
+  0,                                           /* tp_getset */
+  0,                                           /* tp_base */
+  0,                                           /* tp_dict */
+  0,                                           /* tp_descr_get */
+  0,                                           /* tp_descr_set */
+  0,                                           /* tp_dictoffset */
+  0,                                           /* tp_init */
+  0,                                           /* tp_alloc */
+  tc_WriteBack_new,                            /* tp_new */
+};
+
+int tc_WriteBack_register(PyObject *module) {
+  log_trace("ENTER");
+  if (PyType_Ready(&tc_WriteBackType) == 0)
+    return PyModule_AddObject(module, "WriteBack", (PyObject *)&tc_WriteBackType);
+  return -1;
+}
@@ -0,0 +1,57 @@
+#ifndef PYTC_WRITEBACK_H
+#define PYTC_WRITEBACK_H
+
+#include "_base.h"
+#include <pthread.h>
+#include "Codec.h"
+
+/* Operations of the database a write-back layer sits in front of */
+typedef struct {
+  bool (*put)(void *db, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+  bool (*out)(void *db, const void *kbuf, int ksiz);
+  void *(*get)(void *db, const void *kbuf, int ksiz, int *sp);
+  bool (*tranbegin)(void *db);
+  bool (*trancommit)(void *db);
+  bool (*tranabort)(void *db);
+  bool (*sync)(void *db);
+  int (*ecode)(void *db);
+  const char *(*errmsg)(int ecode);
+} tc_WriteBackOps;
+
+/* Writes land in the active memtable and are moved to the database by a
+   native flusher thread, one transaction per memtable. While a memtable
+   is written it stays readable as the flushing one. Every record of a
+   memtable starts with a flag byte, TC_WRITEBACK_PUT followed by the value
+   or TC_WRITEBACK_OUT for a removed record. All fields below db are
+   guarded by mutex. */
+typedef struct {
+  PyObject_HEAD
+  PyObject *db;             /* the HDB or BDB object, kept alive */
+  void *handle;             /* its TCHDB or TCBDB */
+  tc_codec_t *codec;        /* its codec, which setcodec() may change */
+  const tc_WriteBackOps *ops;
+  double interval;          /* seconds between flushes */
+  int64_t bufsiz;           /* memtable size that triggers a flush */
+  int64_t maxsiz;           /* memtable size at which writers wait */
+  bool started;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;      /* wakes the flusher */
+  pthread_cond_t done;      /* signalled after every flush */
+  TCMAP *active;
+  TCMAP *flushing;
+  uint64_t seq;             /* number of writes so far */
+  uint64_t flushed;         /* number of writes in the database */
+  bool flushreq;
+  bool stop;
+  int ecode;                /* error of a failed flush, stops the layer */
+} tc_WriteBack;
+
+#define TC_WRITEBACK_PUT 'P'
+#define TC_WRITEBACK_OUT 'D'
+
+extern PyTypeObject tc_WriteBackType;
+
+int tc_WriteBack_register(PyObject *module);
+
+#endif
@@ -6,10 +6,20 @@
 #include <tctdb.h>
 
 #include "HDB.h"
+#include "HDBIterator.h"
 #include "BDB.h"
 #include "BDBCursor.h"
 #include "TDB.h"
 #include "TDBQuery.h"
+#include "TDBQueryIterator.h"
+#include "FDB.h"
+#include "FDBIterator.h"
+#include "ADB.h"
+#include "MemCache.h"
+#include "WriteBack.h"
+#include "Transaction.h"
+#include "Defrag.h"
+#include "Codec.h"
 
 PyObject *tc_module;
 PyObject *tc_Error;
@@ -19,6 +29,10 @@ PyObject *tc_Error;
  * Module functions
  */
 static PyMethodDef tc_functions[] = {
+  {"encode", (PyCFunction)tc_Codec_encode, METH_O,
+    "Encode an object as the values of handles opened with codec='tc' are stored."},
+  {"decode", (PyCFunction)tc_Codec_decode, METH_O,
+    "Decode a value encoded by encode(). Values without the codec header are returned as they are."},
   {NULL, NULL}
 };
 
@@ -72,10 +86,19 @@ PyMODINIT_FUNC  PyInit__tc(void)
       goto exit; \
     }
   R(tc_HDB_register, != 0)
+  R(tc_HDBIterator_register, != 0)
   R(tc_BDB_register, != 0)
   R(tc_BDBCursor_register, != 0)
   R(tc_TDB_register, != 0)
   R(tc_TDBQuery_register, != 0)
+  R(tc_TDBQueryIterator_register, != 0)
+  R(tc_FDB_register, != 0)
+  R(tc_FDBIterator_register, != 0)
+  R(tc_ADB_register, != 0)
+  R(tc_MemCache_register, != 0)
+  R(tc_WriteBack_register, != 0)
+  R(tc_Transaction_register, != 0)
+  R(tc_Defrag_register, != 0)
   #undef R
 
   /* Register consts */
@@ -171,6 +194,8 @@ PyMODINIT_FUNC  PyInit__tc(void)
   /* TDB: index types */
   ADD_INT(tc_module, TDBITLEXICAL); /* lexical string */
   ADD_INT(tc_module, TDBITDECIMAL); /* decimal string */
+  ADD_INT(tc_module, TDBITTOKEN);   /* token inverted index */
+  ADD_INT(tc_module, TDBITQGRAM);   /* q-gram inverted index */
   ADD_INT(tc_module, TDBITOPT);     /* optimize */
   ADD_INT(tc_module, TDBITVOID);    /* void */
   ADD_INT(tc_module, TDBITKEEP);    /* keep existing index */
@@ -205,6 +230,33 @@ PyMODINIT_FUNC  PyInit__tc(void)
   ADD_INT(tc_module, TDBQPOUT);     /* remove the record */
   ADD_INT(tc_module, TDBQPSTOP);    /* stop the iteration */
   
+  /* TDB: set operations of meta search */
+  ADD_INT(tc_module, TDBMSUNION);   /* union */
+  ADD_INT(tc_module, TDBMSISECT);   /* intersection */
+  ADD_INT(tc_module, TDBMSDIFF);    /* difference */
+  
+  /* FDB */
+  ADD_INT(tc_module, FDBFOPEN);
+  ADD_INT(tc_module, FDBFFATAL);
+
+  ADD_INT(tc_module, FDBOREADER);
+  ADD_INT(tc_module, FDBOWRITER);
+  ADD_INT(tc_module, FDBOCREAT);
+  ADD_INT(tc_module, FDBOTRUNC);
+  ADD_INT(tc_module, FDBONOLCK);
+  ADD_INT(tc_module, FDBOLCKNB);
+  ADD_INT(tc_module, FDBOTSYNC);
+
+  ADD_INT(tc_module, FDBIDMIN);     /* minimum ID */
+  ADD_INT(tc_module, FDBIDPREV);    /* ID before the minimum */
+  ADD_INT(tc_module, FDBIDMAX);     /* maximum ID */
+  ADD_INT(tc_module, FDBIDNEXT);    /* ID after the maximum */
+  /* end of FDB */
+
+  /* Codec */
+  ADD_INT(tc_module, TC_CODEC_VERSION);
+  /* end of Codec */
+
   #undef ADD_INT
   /* end adding constants */
 
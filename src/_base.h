@@ -65,6 +65,30 @@ typedef enum {
   #define NUMBER_FromLong PyInt_FromLong
 #endif
 
+/* Values are accepted from any object supporting the buffer protocol
+   (bytes, bytearray, memoryview, array, mmap...). Python < 2.6 has no
+   Py_buffer, there "s#" is used and obj only holds converted unicode. */
+#if (PY_VERSION_HEX >= 0x02060000)
+  typedef Py_buffer tc_buffer_t;
+  #define TC_BUFFER_FMT         "s*"
+  #define TC_WBUFFER_FMT        "w*"
+  #define TC_BUFFER_ARGS(b)     &(b)
+  #define TC_BUFFER_RELEASE(b)  PyBuffer_Release(&(b))
+#else
+  typedef struct {
+    void *buf;
+    int len;
+    PyObject *obj;
+  } tc_buffer_t;
+  #define TC_BUFFER_FMT         "s#"
+  #define TC_WBUFFER_FMT        "w#"
+  #define TC_BUFFER_ARGS(b)     (char **)&(b).buf, &(b).len
+  #define TC_BUFFER_RELEASE(b)  Py_CLEAR((b).obj)
+#endif
+#define TC_BUFFER_BUF(b)        ((char *)(b).buf)
+/* tc sizes are ints: buffers pass through tc_Buffer_Check first */
+#define TC_BUFFER_LEN(b)        ((int)(b).len)
+
 
 /* Get minimum value */
 #ifndef min
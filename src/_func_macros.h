@@ -77,12 +77,13 @@
   TC_NUM_NOARGS(func, type, unsigned PY_LONG_LONG, call, member, ecode, err, \
                 PyLong_FromUnsignedLongLong)
 
-#define TC_BOOL_KEYARGS(func,type,method,call,member,error,errmember) \
+#define TC_BOOL_KEYARGS(func,type,method,call,member,error,errmember,op) \
   static PyObject * \
   func(type *self, PyObject *args, PyObject *keywds) { \
     char *key; \
     int key_len; \
     bool result; \
+    tc_StatsTimer timer; \
     static char *kwlist[] = {"key", NULL}; \
   \
     if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:" #method, kwlist, \
@@ -90,8 +91,9 @@
       return NULL; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    result = call(self->member, key, key_len); \
+    TC_STATS_CALL(timer, result = call(self->member, key, key_len)); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, op, &timer, key_len, 0, result); \
   \
     if (!result) { \
       error(self->errmember); \
@@ -123,12 +125,13 @@
   }
 
 /* NOTE: this function dealloc pointer returned by tc */
-#define TC_STRINGL_KEYARGS(func,type,method,call,member,error) \
+#define TC_STRINGL_KEYARGS(func,type,method,call,member,error,op) \
   static PyObject * \
   func(type *self, PyObject *args, PyObject *keywds) { \
     PyObject *ret; \
     char *key, *value; \
     int key_len, value_len; \
+    tc_StatsTimer timer; \
     static char *kwlist[] = {"key", NULL}; \
   \
     if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#:" #method, kwlist, \
@@ -136,34 +139,129 @@
       return NULL; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    value = call(self->member, key, key_len, &value_len); \
+    TC_STATS_CALL(timer, value = call(self->member, key, key_len, &value_len)); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, op, &timer, key_len, value ? value_len : 0, \
+                    value != NULL); \
   \
     if (!value) { \
       error(self->member); \
       return NULL; \
     } \
-    ret = PyBytes_FromStringAndSize(value, value_len); \
+    ret = tc_Codec_Value(self->codec, value, value_len); \
     free(value); \
     return ret; \
   }
 
-#define TC_XDB_PUT(func,type,method,call,member,error) \
+/* Looks up every key of an iterable in one GIL-released pass. Missing keys
+   map to `default` instead of raising KeyError.
+   NOTE: this function dealloc pointers returned by tc */
+#define TC_XDB_getmany(func,type,method,call,ecode,member,error) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    PyObject *keys, *dflt = Py_None, *ret = NULL; \
+    TCLIST *klist; \
+    char **values; \
+    int *value_lens; \
+    int i, n; \
+    bool failed = false; \
+    uint64_t bytes_in = 0, bytes_out = 0; \
+    tc_StatsTimer timer; \
+    static char *kwlist[] = {"keys", "default", NULL}; \
+  \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|O:" #method, kwlist, \
+                                     &keys, &dflt) || \
+        !(klist = tc_TCLIST_FromKeys(keys))) { \
+      return NULL; \
+    } \
+    n = tclistnum(klist); \
+    values = (char **)calloc(n + 1, sizeof(char *)); \
+    value_lens = (int *)calloc(n + 1, sizeof(int)); \
+    if (!values || !value_lens) { \
+      PyErr_NoMemory(); \
+      goto exit; \
+    } \
+    Py_BEGIN_ALLOW_THREADS \
+    timer.begin = tc_Stats_now(); \
+    for (i = 0; i < n; i++) { \
+      int key_len; \
+      const char *key = tclistval(klist, i, &key_len); \
+      values[i] = call(self->member, key, key_len, &value_lens[i]); \
+      bytes_in += key_len; \
+      if (values[i]) { \
+        bytes_out += value_lens[i]; \
+      } else if (ecode(self->member) != TCENOREC) { \
+        failed = true; \
+        break; \
+      } \
+    } \
+    timer.end = tc_Stats_now(); \
+    Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_GETMANY, &timer, bytes_in, bytes_out, \
+                    !failed); \
+  \
+    if (failed) { \
+      error(self->member); \
+    } else if ((ret = PyList_New(n))) { \
+      for (i = 0; i < n; i++) { \
+        PyObject *value; \
+        if (values[i]) { \
+          if (!(value = tc_Codec_Value(self->codec, values[i], value_lens[i]))) { \
+            Py_CLEAR(ret); \
+            break; \
+          } \
+        } else { \
+          Py_INCREF(dflt); \
+          value = dflt; \
+        } \
+        PyList_SET_ITEM(ret, i, value); \
+      } \
+    } \
+  exit: \
+    if (values) { \
+      for (i = 0; i < n; i++) { \
+        if (values[i]) { free(values[i]); } \
+      } \
+      free(values); \
+    } \
+    if (value_lens) { free(value_lens); } \
+    tclistdel(klist); \
+    return ret; \
+  }
+
+/* value may be any object supporting the buffer protocol, or any object
+   the codec of the handle encodes. Concatenating encoded values would not
+   give a valid one, so with a codec, cat calls are refused. */
+#define TC_XDB_PUT(func,type,method,call,member,error,cat) \
   static PyObject * \
   func(type *self, PyObject *args, PyObject *keywds) { \
     bool result; \
-    char *key, *value; \
-    int key_len, value_len; \
+    char *key; \
+    int key_len; \
+    PyObject *_value; \
+    tc_buffer_t value; \
+    tc_StatsTimer timer; \
     static char *kwlist[] = {"key", "value", NULL}; \
   \
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#s#:" #method, kwlist, \
-                                     &key, &key_len, \
-                                     &value, &value_len)) { \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "s#O:" #method, kwlist, \
+                                     &key, &key_len, &_value)) { \
+      return NULL; \
+    } \
+    if (cat && self->codec != TC_CODEC_RAW) { \
+      PyErr_SetString(PyExc_ValueError, #method " can't be used with a codec"); \
+      return NULL; \
+    } \
+    if (tc_Codec_Buffer(self->codec, _value, &value, "values") != 0) { \
       return NULL; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    result = call(self->member, key, key_len, value, value_len); \
+    TC_STATS_CALL(timer, result = call(self->member, key, key_len, \
+                                       TC_BUFFER_BUF(value), \
+                                       TC_BUFFER_LEN(value))); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_PUT, &timer, \
+                    key_len + TC_BUFFER_LEN(value), 0, result); \
+    TC_BUFFER_RELEASE(value); \
   \
     if (!result) { \
       error(self->member); \
@@ -172,6 +270,101 @@
     Py_RETURN_NONE; \
   }
 
+/* Stores (key, value) pairs from a mapping or an iterable, TC_BATCH_SIZE
+   records per GIL release. With transaction, each batch is committed as one
+   transaction, unless one was begun by tranbegin(): tc would wait for it to
+   end before beginning another, so the records go into it instead. mode is
+   "put", "keep" (existing keys are skipped) or "cat". Returns the number of
+   records stored. On errors, chunks written before stay stored and their
+   number is set as the stored attribute of the exception. */
+#define TC_XDB_putmany(func,type,method,put,putkeep,putcat,tranbegin,trancommit,tranabort,ecode,member,error) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    PyObject *items, *iter; \
+    tc_KVBatch *batch; \
+    char *mode = "put"; \
+    int transaction = 1, n; \
+    long stored = 0; \
+    bool result = true; \
+    tc_StatsTimer timer; \
+    static char *kwlist[] = {"items", "mode", "transaction", NULL}; \
+  \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|si:" #method, kwlist, \
+                                     &items, &mode, &transaction)) { \
+      return NULL; \
+    } \
+    if (strcmp(mode, "put") && strcmp(mode, "keep") && strcmp(mode, "cat")) { \
+      PyErr_SetString(PyExc_ValueError, "mode must be 'put', 'keep' or 'cat'"); \
+      return NULL; \
+    } \
+    if (*mode == 'c' && self->codec != TC_CODEC_RAW) { \
+      PyErr_SetString(PyExc_ValueError, "mode 'cat' can't be used with a codec"); \
+      return NULL; \
+    } \
+    if (!(iter = tc_KVBatch_iter(items))) { \
+      return NULL; \
+    } \
+    if (!(batch = tc_KVBatch_new(self->codec))) { \
+      Py_DECREF(iter); \
+      return NULL; \
+    } \
+    while (result && (n = tc_KVBatch_fill(batch, iter)) > 0) { \
+      long batch_stored = 0; \
+      uint64_t bytes_in = 0; \
+      bool own = transaction && !self->intran; \
+      Py_BEGIN_ALLOW_THREADS \
+      timer.begin = tc_Stats_now(); \
+      if (!own || (result = tranbegin(self->member))) { \
+        int i; \
+        for (i = 0; i < n; i++) { \
+          bool ok; \
+          switch (*mode) { \
+            case 'k': \
+              ok = putkeep(self->member, batch->kbufs[i], batch->ksizs[i], \
+                           batch->vbufs[i], batch->vsizs[i]); \
+              break; \
+            case 'c': \
+              ok = putcat(self->member, batch->kbufs[i], batch->ksizs[i], \
+                          batch->vbufs[i], batch->vsizs[i]); \
+              break; \
+            default: \
+              ok = put(self->member, batch->kbufs[i], batch->ksizs[i], \
+                       batch->vbufs[i], batch->vsizs[i]); \
+          } \
+          bytes_in += batch->ksizs[i] + batch->vsizs[i]; \
+          if (ok) { \
+            batch_stored++; \
+          } else if (*mode != 'k' || ecode(self->member) != TCEKEEP) { \
+            result = false; \
+            break; \
+          } \
+        } \
+        if (own) { \
+          if (result) { \
+            result = trancommit(self->member); \
+          } else { \
+            tranabort(self->member); \
+            batch_stored = 0; \
+          } \
+        } \
+      } \
+      timer.end = tc_Stats_now(); \
+      Py_END_ALLOW_THREADS \
+      tc_Stats_record(self->stats, TC_OP_PUTMANY, &timer, bytes_in, 0, result); \
+      stored += batch_stored; \
+      if (!result) { \
+        error(self->member); \
+      } \
+    } \
+    tc_KVBatch_del(batch); \
+    Py_DECREF(iter); \
+    if (PyErr_Occurred()) { \
+      tc_Error_SetStored(stored); \
+      return NULL; \
+    } \
+    return NUMBER_FromLong(stored); \
+  }
+
 #define TC_XDB_OPEN(func,type,call_new,call_open,member,call_dealloc,error) \
   static PyObject * \
   func(type *self, PyObject *args, PyObject *keywds) { \
@@ -194,6 +387,61 @@
     Py_RETURN_NONE; \
   }
 
+/* Setter of one integer parameter, like setxmsiz(xmsiz). fmt is the
+   format of the parameter and ctype its C type: "L" and PY_LONG_LONG for
+   64-bit parameters, "i" and int for 32-bit ones, so that values out of
+   range raise OverflowError instead of being truncated. */
+#define TC_BOOL_NUMBER_ARG(func,type,method,arg,fmt,ctype,call,member,error) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    log_trace("ENTER"); \
+    bool result; \
+    ctype value; \
+    static char *kwlist[] = {#arg, NULL}; \
+  \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, fmt ":" #method, kwlist, &value)) { \
+      return NULL; \
+    } \
+    Py_BEGIN_ALLOW_THREADS \
+    result = call(self->member, value); \
+    Py_END_ALLOW_THREADS \
+  \
+    if (!result) { \
+      error(self->member); \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
+#define TC_BOOL_LONG_LONG_ARG(func,type,method,arg,call,member,error) \
+  TC_BOOL_NUMBER_ARG(func,type,method,arg,"L",PY_LONG_LONG,call,member,error)
+
+#define TC_BOOL_INT_ARG(func,type,method,arg,call,member,error) \
+  TC_BOOL_NUMBER_ARG(func,type,method,arg,"i",int,call,member,error)
+
+/* Defragment step records, or the whole file if step is not positive */
+#define TC_XDB_defrag(func,type,call,member,error) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    log_trace("ENTER"); \
+    bool result; \
+    PY_LONG_LONG step = 0; \
+    static char *kwlist[] = {"step", NULL}; \
+  \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "|L:defrag", kwlist, &step)) { \
+      return NULL; \
+    } \
+    Py_BEGIN_ALLOW_THREADS \
+    result = call(self->member, step); \
+    Py_END_ALLOW_THREADS \
+  \
+    if (!result) { \
+      error(self->member); \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
 #define TC_BOOL_PATHARGS(func,type,method,call,member,error) \
   static PyObject * \
   func(type *self, PyObject *args, PyObject *keywds) { \
@@ -240,6 +488,7 @@
     PyObject *ret; \
     char *key, *value; \
     int key_len, value_len; \
+    tc_StatsTimer timer; \
   \
     if (!PyBytes_Check(_key)) { \
       PyErr_SetString(PyExc_TypeError, "only string is allowed in []"); \
@@ -251,14 +500,16 @@
       return NULL; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    value = call(self->member, key, key_len, &value_len); \
+    TC_STATS_CALL(timer, value = call(self->member, key, key_len, &value_len)); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_GET, &timer, key_len, \
+                    value ? value_len : 0, value != NULL); \
   \
     if (!value) { \
       err(self->member); \
       return NULL; \
     } \
-    ret = PyBytes_FromStringAndSize(value, value_len); \
+    ret = tc_Codec_Value(self->codec, value, value_len); \
     free(value); \
     return ret; \
   } \
@@ -269,13 +520,15 @@
     bool result; \
     char *key = PyBytes_AsString(_key); \
     int key_len = PyBytes_GET_SIZE(_key); \
+    tc_StatsTimer timer; \
   \
     if (!key || !key_len) { \
       return -1; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    result = call(self->member, key, key_len); \
+    TC_STATS_CALL(timer, result = call(self->member, key, key_len)); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_OUT, &timer, key_len, 0, result); \
   \
     if (!result) { \
       err(self->member); \
@@ -288,15 +541,23 @@
   int \
   func(type *self, PyObject *_key, PyObject *_value) { \
     bool result; \
-    char *key = PyBytes_AsString(_key), *value = PyBytes_AsString(_value); \
-    int key_len = PyBytes_GET_SIZE(_key), value_len = PyBytes_GET_SIZE(_value); \
+    char *key = PyBytes_AsString(_key); \
+    int key_len = PyBytes_GET_SIZE(_key); \
+    tc_buffer_t value; \
+    tc_StatsTimer timer; \
   \
-    if (!key || !key_len || !value) { \
+    if (!key || !key_len || \
+        tc_Codec_Buffer(self->codec, _value, &value, "values") != 0) { \
       return -1; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    result = call(self->member, key, key_len, value, value_len); \
+    TC_STATS_CALL(timer, result = call(self->member, key, key_len, \
+                                       TC_BUFFER_BUF(value), \
+                                       TC_BUFFER_LEN(value))); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_PUT, &timer, \
+                    key_len + TC_BUFFER_LEN(value), 0, result); \
+    TC_BUFFER_RELEASE(value); \
   \
     if (!result) { \
       err(self->member); \
@@ -332,6 +593,77 @@
     return (value_len != -1); \
   }
 
+/* tranbegin(), trancommit() and tranabort() of handles that keep track of
+   the transaction begun through them in intran. tc ends the transaction
+   even if committing it fails. tc's tranbegin waits for the running
+   transaction to end, which nobody could do without a mutex. */
+#define TC_XDB_tran(func,type,call,member,error,begin) \
+  static PyObject * \
+  func(type *self) { \
+    log_trace("ENTER"); \
+    bool result; \
+  \
+    if (begin && self->intran && !self->member->mmtx) { \
+      PyErr_SetString(PyExc_RuntimeError, "transaction already in progress"); \
+      return NULL; \
+    } \
+    Py_BEGIN_ALLOW_THREADS \
+    result = call(self->member); \
+    Py_END_ALLOW_THREADS \
+  \
+    if (result || !begin) { \
+      self->intran = begin; \
+    } \
+    if (!result) { \
+      error(self->member); \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
+#define TC_XDB_transaction(func,type) \
+  static PyObject * \
+  func(type *self) { \
+    log_trace("ENTER"); \
+    return tc_Transaction_New((PyObject *)self); \
+  }
+
+#define TC_XDB_stats(func,type) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    int reset = 0; \
+    static char *kwlist[] = {"reset", NULL}; \
+  \
+    log_trace("ENTER"); \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "|i:stats", kwlist, \
+                                     &reset)) { \
+      return NULL; \
+    } \
+    return tc_Stats_AsDict(self->stats, reset); \
+  }
+
+#define TC_XDB_prometheus(func,type) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    log_trace("ENTER"); \
+    return tc_Stats_Prometheus(self->stats, args, keywds); \
+  }
+
+#define TC_XDB_setcodec(func,type) \
+  static PyObject * \
+  func(type *self, PyObject *args, PyObject *keywds) { \
+    PyObject *codec; \
+    static char *kwlist[] = {"codec", NULL}; \
+  \
+    log_trace("ENTER"); \
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O:setcodec", kwlist, \
+                                     &codec) || \
+        tc_Codec_FromObject(codec, &self->codec) != 0) { \
+      return NULL; \
+    } \
+    Py_RETURN_NONE; \
+  }
+
 #define TC_XDB___contains__(func,type,call) \
   static PyObject * \
   func(type *self, PyObject *_key) { \
@@ -344,19 +676,22 @@
     PyObject *ret; \
     char *key = PyBytes_AsString(_key), *value; \
     int key_len = PyBytes_GET_SIZE(_key), value_len; \
+    tc_StatsTimer timer; \
   \
     if (!key || !key_len) { \
       return NULL; \
     } \
     Py_BEGIN_ALLOW_THREADS \
-    value = call(self->member, key, key_len, &value_len); \
+    TC_STATS_CALL(timer, value = call(self->member, key, key_len, &value_len)); \
     Py_END_ALLOW_THREADS \
+    tc_Stats_record(self->stats, TC_OP_GET, &timer, key_len, \
+                    value ? value_len : 0, value != NULL); \
   \
     if (!value) { \
       err(self->member); \
       return NULL; \
     } \
-    ret = PyBytes_FromStringAndSize(value, value_len); \
+    ret = tc_Codec_Value(self->codec, value, value_len); \
     free(value); \
     return ret; \
   }
@@ -22,3 +22,319 @@ void tc_Error_SetCodeAndString(int ecode, const char *errmsg) {
   Py_DECREF(obj);
 }
 
+/* Tell how many records a bulk write stored before failing, as the stored
+   attribute of the pending exception */
+void tc_Error_SetStored(long stored) {
+  PyObject *type, *value, *tb, *num;
+
+  PyErr_Fetch(&type, &value, &tb);
+  PyErr_NormalizeException(&type, &value, &tb);
+  if (!value || !(num = NUMBER_FromLong(stored))) {
+    PyErr_Clear();
+  } else {
+    if (PyObject_SetAttrString(value, "stored", num) != 0) {
+      PyErr_Clear();
+    }
+    Py_DECREF(num);
+  }
+  PyErr_Restore(type, value, tb);
+}
+
+
+/* Copy every string yielded by the iterable `strings` into a new TCLIST, so
+   the list can be walked without holding the GIL. `what` names the items in
+   error messages. Returns NULL with an exception set on failure. */
+TCLIST *tc_TCLIST_FromStrings(PyObject *strings, const char *what) {
+  PyObject *iter, *key;
+  TCLIST *list;
+
+  if (!(iter = PyObject_GetIter(strings))) {
+    return NULL;
+  }
+  if (!(list = tclistnew())) {
+    Py_DECREF(iter);
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc TCLIST");
+    return NULL;
+  }
+  while ((key = PyIter_Next(iter))) {
+    if (PyBytes_Check(key)) {
+      tclistpush(list, PyBytes_AS_STRING(key), PyBytes_GET_SIZE(key));
+    } else if (PyUnicode_Check(key)) {
+      PyObject *bkey = PyUnicode_AsUTF8String(key);
+      if (!bkey) {
+        Py_DECREF(key);
+        break;
+      }
+      tclistpush(list, PyBytes_AS_STRING(bkey), PyBytes_GET_SIZE(bkey));
+      Py_DECREF(bkey);
+    } else {
+      PyErr_Format(PyExc_TypeError, "%s must be strings", what);
+      Py_DECREF(key);
+      break;
+    }
+    Py_DECREF(key);
+  }
+  Py_DECREF(iter);
+  if (PyErr_Occurred()) {
+    tclistdel(list);
+    return NULL;
+  }
+  return list;
+}
+
+/* Copy every key yielded by the iterable `keys` into a new TCLIST. Keys are
+   converted with "s#", as the single key methods do, so a key is looked up
+   the same way by get() and getmany(). Returns NULL with an exception set
+   on failure. */
+TCLIST *tc_TCLIST_FromKeys(PyObject *keys) {
+  PyObject *iter, *key;
+  TCLIST *list;
+  char *kbuf;
+  int kbuf_len;
+
+  if (!(iter = PyObject_GetIter(keys))) {
+    return NULL;
+  }
+  if (!(list = tclistnew())) {
+    Py_DECREF(iter);
+    PyErr_SetString(PyExc_MemoryError, "Cannot alloc TCLIST");
+    return NULL;
+  }
+  while ((key = PyIter_Next(iter))) {
+    if (!PyArg_Parse(key, "s#", &kbuf, &kbuf_len)) {
+      Py_DECREF(key);
+      break;
+    }
+    tclistpush(list, kbuf, kbuf_len);
+    Py_DECREF(key);
+  }
+  Py_DECREF(iter);
+  if (PyErr_Occurred()) {
+    tclistdel(list);
+    return NULL;
+  }
+  return list;
+}
+
+/* Set dict[name] to an integer. Returns -1 on error. */
+int tc_Dict_SetLongLong(PyObject *dict, const char *name, PY_LONG_LONG value) {
+  PyObject *item;
+  int ret;
+
+  if (!(item = PyLong_FromLongLong(value))) {
+    return -1;
+  }
+  ret = PyDict_SetItemString(dict, name, item);
+  Py_DECREF(item);
+  return ret;
+}
+
+/* Return a new reference to `obj` as bytes, encoding unicode as UTF-8 */
+PyObject *tc_AsBytes(PyObject *obj, const char *what) {
+  if (PyBytes_Check(obj)) {
+    Py_INCREF(obj);
+    return obj;
+  } else if (PyUnicode_Check(obj)) {
+    return PyUnicode_AsUTF8String(obj);
+  }
+  PyErr_Format(PyExc_TypeError, "%s must be strings", what);
+  return NULL;
+}
+
+/* Get a buffer of the bytes of a value. Unicode is UTF-8 encoded, anything
+   else must support the buffer protocol. Returns 0 on success, -1 with an
+   exception set otherwise. Release the buffer with TC_BUFFER_RELEASE. */
+int tc_Buffer_FromObject(PyObject *obj, tc_buffer_t *buf, const char *what) {
+  PyObject *bytes;
+  int ok;
+
+  if (PyUnicode_Check(obj)) {
+    if (!(bytes = PyUnicode_AsUTF8String(obj))) {
+      return -1;
+    }
+  } else {
+    Py_INCREF(obj);
+    bytes = obj;
+  }
+#if (PY_VERSION_HEX >= 0x02060000)
+  /* the buffer keeps its own reference to bytes */
+  ok = PyArg_Parse(bytes, TC_BUFFER_FMT, TC_BUFFER_ARGS(*buf));
+  Py_DECREF(bytes);
+#else
+  if ( (ok = PyArg_Parse(bytes, TC_BUFFER_FMT, TC_BUFFER_ARGS(*buf))) ) {
+    buf->obj = bytes;
+  } else {
+    Py_DECREF(bytes);
+  }
+#endif
+  if (!ok) {
+    PyErr_Format(PyExc_TypeError, "%s must be strings or buffers", what);
+    return -1;
+  }
+  return tc_Buffer_Check(buf);
+}
+
+/* Refuse a buffer too large for tc, whose sizes are ints, releasing it.
+   Returns -1 with OverflowError set in that case. */
+int tc_Buffer_Check(tc_buffer_t *buf) {
+  if (buf->len > INT_MAX) {
+    TC_BUFFER_RELEASE(*buf);
+    PyErr_SetString(PyExc_OverflowError, "buffers of 2 GB or more are not supported");
+    return -1;
+  }
+  return 0;
+}
+
+/* Return an iterator of (key, value) pairs: items of a mapping or the
+   iterable itself. */
+PyObject *tc_KVBatch_iter(PyObject *items) {
+  PyObject *pairs, *iter;
+  if (PyObject_HasAttrString(items, "iteritems")) {
+    pairs = PyObject_CallMethod(items, "iteritems", NULL);
+  } else if (PyObject_HasAttrString(items, "items")) {
+    pairs = PyObject_CallMethod(items, "items", NULL);
+  } else {
+    return PyObject_GetIter(items);
+  }
+  if (!pairs) {
+    return NULL;
+  }
+  iter = PyObject_GetIter(pairs);
+  Py_DECREF(pairs);
+  return iter;
+}
+
+tc_KVBatch *tc_KVBatch_new(tc_codec_t codec) {
+  tc_KVBatch *batch = (tc_KVBatch *)PyMem_Malloc(sizeof(tc_KVBatch));
+  if (!batch) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  batch->codec = codec;
+  batch->num = 0;
+  return batch;
+}
+
+/* Read up to TC_BATCH_SIZE pairs from `iter`. Returns the number of pairs
+   read, 0 when the iterator is exhausted or -1 with an exception set. */
+int tc_KVBatch_fill(tc_KVBatch *batch, PyObject *iter) {
+  PyObject *item, *key, *value;
+
+  tc_KVBatch_clear(batch);
+  while (batch->num < TC_BATCH_SIZE && (item = PyIter_Next(iter))) {
+    int i = batch->num;
+    if (!PySequence_Check(item) || PySequence_Size(item) != 2) {
+      Py_DECREF(item);
+      PyErr_SetString(PyExc_TypeError, "items must be (key, value) pairs");
+      return -1;
+    }
+    key = PySequence_GetItem(item, 0);
+    value = PySequence_GetItem(item, 1);
+    Py_DECREF(item);
+    batch->keys[i] = NULL;
+    /* "s#" as put() and get() use, the key object owning the string */
+    if (key && value && PyArg_Parse(key, "s#", &batch->kbufs[i], &batch->ksizs[i]) &&
+        tc_Codec_Buffer(batch->codec, value, &batch->values[i], "values") == 0) {
+      batch->keys[i] = key;
+      key = NULL;
+    }
+    Py_XDECREF(key);
+    Py_XDECREF(value);
+    if (!batch->keys[i]) {
+      return -1;
+    }
+    batch->vbufs[i] = TC_BUFFER_BUF(batch->values[i]);
+    batch->vsizs[i] = TC_BUFFER_LEN(batch->values[i]);
+    batch->num++;
+  }
+  return PyErr_Occurred() ? -1 : batch->num;
+}
+
+void tc_KVBatch_clear(tc_KVBatch *batch) {
+  int i;
+  for (i = 0; i < batch->num; i++) {
+    Py_DECREF(batch->keys[i]);
+    TC_BUFFER_RELEASE(batch->values[i]);
+  }
+  batch->num = 0;
+}
+
+void tc_KVBatch_del(tc_KVBatch *batch) {
+  tc_KVBatch_clear(batch);
+  PyMem_Free(batch);
+}
+
+tc_RecBuf *tc_RecBuf_new(int cap, tc_codec_t codec) {
+  tc_RecBuf *buf = (tc_RecBuf *)PyMem_Malloc(sizeof(tc_RecBuf));
+  if (!buf) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  buf->codec = codec;
+  buf->arena = tcxstrnew();
+  buf->num = buf->pos = 0;
+  buf->cap = cap;
+  buf->koffs = (int *)PyMem_Malloc(cap * 4 * sizeof(int));
+  if (!buf->koffs) {
+    tcxstrdel(buf->arena);
+    PyMem_Free(buf);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  buf->ksizs = buf->koffs + cap;
+  buf->voffs = buf->koffs + cap * 2;
+  buf->vsizs = buf->koffs + cap * 3;
+  return buf;
+}
+
+void tc_RecBuf_clear(tc_RecBuf *buf) {
+  tcxstrclear(buf->arena);
+  buf->num = buf->pos = 0;
+}
+
+bool tc_RecBuf_full(tc_RecBuf *buf) {
+  return buf->num >= buf->cap || tcxstrsize(buf->arena) >= TC_SCAN_MAXSIZ;
+}
+
+/* Copy a record into the arena. The caller checks tc_RecBuf_full first. */
+void tc_RecBuf_push(tc_RecBuf *buf, const void *kbuf, int ksiz, const void *vbuf, int vsiz) {
+  int i = buf->num++;
+  buf->koffs[i] = tcxstrsize(buf->arena);
+  buf->ksizs[i] = ksiz;
+  tcxstrcat(buf->arena, kbuf, ksiz);
+  buf->voffs[i] = tcxstrsize(buf->arena);
+  buf->vsizs[i] = vsiz;
+  if (vsiz > 0) {
+    tcxstrcat(buf->arena, vbuf, vsiz);
+  }
+}
+
+/* New reference to the key, the value or a (key, value) tuple of record i */
+PyObject *tc_RecBuf_get(tc_RecBuf *buf, int i, tc_itertype_t itype) {
+  const char *base = (const char *)tcxstrptr(buf->arena);
+  PyObject *key, *value, *item;
+
+  if (itype == tc_iter_key_t) {
+    return PyBytes_FromStringAndSize(base + buf->koffs[i], buf->ksizs[i]);
+  } else if (itype == tc_iter_value_t) {
+    return tc_Codec_Value(buf->codec, base + buf->voffs[i], buf->vsizs[i]);
+  }
+  if (!(item = PyTuple_New(2))) {
+    return NULL;
+  }
+  if (!(key = PyBytes_FromStringAndSize(base + buf->koffs[i], buf->ksizs[i])) ||
+      !(value = tc_Codec_Value(buf->codec, base + buf->voffs[i], buf->vsizs[i]))) {
+    Py_XDECREF(key);
+    Py_DECREF(item);
+    return NULL;
+  }
+  PyTuple_SET_ITEM(item, 0, key);
+  PyTuple_SET_ITEM(item, 1, value);
+  return item;
+}
+
+void tc_RecBuf_del(tc_RecBuf *buf) {
+  tcxstrdel(buf->arena);
+  PyMem_Free(buf->koffs);
+  PyMem_Free(buf);
+}
@@ -1,8 +1,79 @@
 #ifndef PYTC_UTIL_H
 #define PYTC_UTIL_H
 
+#include "_base.h"
+#include "Codec.h"
+
 int char_bounds (short x);
 
 void tc_Error_SetCodeAndString (int ecode, const char *errmsg);
 
+void tc_Error_SetStored (long stored);
+
+PyObject *tc_AsBytes (PyObject *obj, const char *what);
+
+int tc_Buffer_FromObject (PyObject *obj, tc_buffer_t *buf, const char *what);
+
+int tc_Buffer_Check (tc_buffer_t *buf);
+
+TCLIST *tc_TCLIST_FromStrings (PyObject *strings, const char *what);
+
+TCLIST *tc_TCLIST_FromKeys (PyObject *keys);
+
+int tc_Dict_SetLongLong (PyObject *dict, const char *name, PY_LONG_LONG value);
+
+/* Number of records handed to tc per GIL release by bulk operations */
+#define TC_BATCH_SIZE 1024
+
+/* A chunk of key/value pairs collected from Python. The batch holds a
+   reference to every key, which owns the string kbufs points to, and a
+   buffer of every value so that they stay valid while the GIL is
+   released. Values are encoded with codec. */
+typedef struct {
+  tc_codec_t codec;
+  int num;
+  PyObject *keys[TC_BATCH_SIZE];
+  tc_buffer_t values[TC_BATCH_SIZE];
+  const char *kbufs[TC_BATCH_SIZE];
+  int ksizs[TC_BATCH_SIZE];
+  const char *vbufs[TC_BATCH_SIZE];
+  int vsizs[TC_BATCH_SIZE];
+} tc_KVBatch;
+
+PyObject *tc_KVBatch_iter (PyObject *items);
+tc_KVBatch *tc_KVBatch_new (tc_codec_t codec);
+int tc_KVBatch_fill (tc_KVBatch *batch, PyObject *iter);
+void tc_KVBatch_clear (tc_KVBatch *batch);
+void tc_KVBatch_del (tc_KVBatch *batch);
+
+/* Records read ahead per GIL release by iterators */
+#define TC_ITER_PREFETCH 128
+
+/* Records fetched per GIL release by full scans, and the arena size after
+   which a chunk is cut short so that large values don't pile up */
+#define TC_SCAN_SIZE 4096
+#define TC_SCAN_MAXSIZ (1 << 22)
+
+/* A chunk of records copied out of tc. Keys and values are packed into one
+   arena that is reused from chunk to chunk; push does not need the GIL.
+   Values are decoded with codec. */
+typedef struct {
+  tc_codec_t codec;
+  TCXSTR *arena;
+  int num;
+  int cap;
+  int pos; /* next record to hand out */
+  int *koffs;
+  int *ksizs;
+  int *voffs;
+  int *vsizs;
+} tc_RecBuf;
+
+tc_RecBuf *tc_RecBuf_new (int cap, tc_codec_t codec);
+void tc_RecBuf_clear (tc_RecBuf *buf);
+bool tc_RecBuf_full (tc_RecBuf *buf);
+void tc_RecBuf_push (tc_RecBuf *buf, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+PyObject *tc_RecBuf_get (tc_RecBuf *buf, int i, tc_itertype_t itype);
+void tc_RecBuf_del (tc_RecBuf *buf);
+
 #endif